@@ -75,6 +75,15 @@ int _Actions::GetState(int Action) {
 	return !!(State & (1 << Action));
 }
 
+// Set the state of an action without going through an input mapping
+void _Actions::SetState(int Action, int Value) {
+	if(Action < 0 || Action >= COUNT)
+		return;
+
+	State &= ~(1 << Action);
+	State |= !!Value << Action;
+}
+
 // Add an input mapping
 void _Actions::AddInputMap(int InputType, int Input, int Action, bool IfNone) {
 	if(Action < 0 || Action >= COUNT || Input < 0 || Input >= ACTIONS_MAXINPUTS)
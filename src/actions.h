@@ -62,6 +62,7 @@ class _Actions {
 		// Actions
 		int GetState(int Action);
 		int GetState() { return State; }
+		void SetState(int Action, int Value);
 		const std::string &GetName(int Action) { return Names[Action]; }
 
 		// Maps
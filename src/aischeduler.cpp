@@ -0,0 +1,143 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <aischeduler.h>
+#include <objects/monster.h>
+#include <objects/player.h>
+#include <profiler.h>
+#include <jobs.h>
+#include <camera.h>
+#include <constants.h>
+#include <utils.h>
+#include <algorithm>
+#include <SDL_timer.h>
+
+static const char *TierZoneNames[AI_TIER_COUNT] = {
+	"AI::Near",
+	"AI::Mid",
+	"AI::Far",
+};
+
+static const int TierIntervals[AI_TIER_COUNT] = {
+	1,
+	AI_MIDINTERVAL,
+	AI_FARINTERVAL,
+};
+
+// Orders monsters that have waited longest first
+static bool CompareIdleTicks(const _Monster *Left, const _Monster *Right) {
+	return Left->GetIdleTicks() > Right->GetIdleTicks();
+}
+
+// Constructor
+_AIScheduler::_AIScheduler()
+:	Budget(AI_TICKBUDGET),
+	ThinkCost(0.0) {
+
+	for(int i = 0; i < AI_TIER_COUNT; i++)
+		Stats[i] = { 0, 0, 0, 0.0 };
+}
+
+// Update all monsters, thinking for as many as the tiers and budget allow
+void _AIScheduler::Update(const std::list<_Entity *> &Monsters, _Player *Player, const _Camera *Camera, double FrameTime) {
+
+	// Sort monsters into tiers
+	for(int i = 0; i < AI_TIER_COUNT; i++) {
+		Tiers[i].clear();
+		Stats[i] = { 0, 0, 0, 0.0 };
+	}
+
+	for(auto Iterator : Monsters) {
+		_Monster *Monster = (_Monster *)Iterator;
+		int Tier = GetTier(Monster, Player, Camera);
+		Tiers[Tier].push_back(Monster);
+		Stats[Tier].Count++;
+	}
+
+	// Near monsters think every tick, distant ones when their interval is up and the budget allows
+	double Remaining = Budget * 0.000001;
+	for(int i = 0; i < AI_TIER_COUNT; i++) {
+		_ProfilerScope Zone(TierZoneNames[i]);
+		uint64_t Timer = SDL_GetPerformanceCounter();
+
+		Thinkers.clear();
+		Coasting.clear();
+		for(auto Monster : Tiers[i]) {
+			if(Monster->GetIdleTicks() + 1 >= TierIntervals[i])
+				Thinkers.push_back(Monster);
+			else
+				Coasting.push_back(Monster);
+		}
+
+		// Drop the most recent thinkers that don't fit, except starving ones
+		if(i != AI_TIER_NEAR) {
+			std::stable_sort(Thinkers.begin(), Thinkers.end(), CompareIdleTicks);
+			if(Budget > 0.0 && ThinkCost > 0.0) {
+				size_t Allowed = (size_t)std::max(0.0, Remaining / ThinkCost);
+				while(Thinkers.size() > Allowed && Thinkers.back()->GetIdleTicks() + 1 < AI_MAXINTERVAL) {
+					Coasting.push_back(Thinkers.back());
+					Thinkers.pop_back();
+					Stats[i].Deferred++;
+				}
+			}
+		}
+
+		for(auto Monster : Coasting)
+			Monster->Update(FrameTime, Player, false);
+		Stats[i].Time = GetElapsedTime(Timer);
+
+		// Perceive in parallel, then act in order so attacks and random rolls stay deterministic
+		if(!Player->IsDying()) {
+			JobSystem.ParallelFor((int)Thinkers.size(), AI_PERCEPTIONBATCH, [this, Player](int Start, int End) {
+				for(int j = Start; j < End; j++)
+					Thinkers[j]->Perceive(Player);
+			});
+		}
+
+		for(auto Monster : Thinkers)
+			Monster->Update(FrameTime, Player, true);
+		Stats[i].Thinks = (int)Thinkers.size();
+
+		// Track the average cost of thinking to size the budget
+		double Elapsed = GetElapsedTime(Timer);
+		if(!Thinkers.empty()) {
+			double Cost = Elapsed / Thinkers.size();
+			ThinkCost = ThinkCost > 0.0 ? ThinkCost + (Cost - ThinkCost) * AI_THINKCOSTRATE : Cost;
+		}
+
+		Stats[i].Time += Elapsed;
+		if(i != AI_TIER_NEAR)
+			Remaining -= Stats[i].Time;
+	}
+}
+
+// Get the tier for a monster based on view and distance to the player
+int _AIScheduler::GetTier(const _Monster *Monster, _Player *Player, const _Camera *Camera) const {
+	const Vector2 &Position = Monster->GetPosition();
+	if(Camera->IsCircleInView(Position, Monster->GetScale()))
+		return AI_TIER_NEAR;
+
+	float DistanceSquared = (Player->GetPosition() - Position).MagnitudeSquared();
+	float ViewRangeSquared = Monster->GetViewRangeSquared();
+	if(DistanceSquared <= ViewRangeSquared)
+		return AI_TIER_NEAR;
+
+	if(DistanceSquared <= ViewRangeSquared * AI_MIDRANGEFACTOR * AI_MIDRANGEFACTOR)
+		return AI_TIER_MID;
+
+	return AI_TIER_FAR;
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+// Forward Declarations
+class _Entity;
+class _Monster;
+class _Player;
+class _Camera;
+
+// Level of detail tiers for monster AI
+enum AITierType {
+	AI_TIER_NEAR,
+	AI_TIER_MID,
+	AI_TIER_FAR,
+	AI_TIER_COUNT
+};
+
+// Per tier statistics from the last tick
+struct _AITierStats {
+	int Count;
+	int Thinks;
+	int Deferred;
+	double Time;
+};
+
+// Spreads monster perception and behavior across ticks
+class _AIScheduler {
+
+	public:
+
+		_AIScheduler();
+
+		void Update(const std::list<_Entity *> &Monsters, _Player *Player, const _Camera *Camera, double FrameTime);
+		void SetBudget(double Budget) { this->Budget = Budget; }
+		double GetBudget() const { return Budget; }
+
+		const _AITierStats &GetStats(int Tier) const { return Stats[Tier]; }
+
+	private:
+
+		int GetTier(const _Monster *Monster, _Player *Player, const _Camera *Camera) const;
+
+		std::vector<_Monster *> Tiers[AI_TIER_COUNT];
+		std::vector<_Monster *> Thinkers;
+		std::vector<_Monster *> Coasting;
+		_AITierStats Stats[AI_TIER_COUNT];
+
+		// Microseconds per tick for the mid and far tiers, 0 for unlimited
+		double Budget;
+		double ThinkCost;
+};
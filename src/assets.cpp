@@ -17,7 +17,10 @@
 *******************************************************************************/
 #include <assets.h>
 #include <font.h>
+#include <glyphatlas.h>
+#include <config.h>
 #include <texture.h>
+#include <atlas.h>
 #include <audio.h>
 #include <random.h>
 #include <utils.h>
@@ -29,7 +32,6 @@
 #include <ui/image.h>
 #include <ui/textbox.h>
 #include <objects/monster.h>
-#include <objects/particle.h>
 #include <objects/player.h>
 #include <objects/weapon.h>
 #include <objects/armor.h>
@@ -38,6 +40,7 @@
 #include <objects/ammo.h>
 #include <constants.h>
 #include <stdexcept>
+#include <algorithm>
 
 _Assets Assets;
 
@@ -143,8 +146,18 @@ void _Assets::LoadFonts(const std::string &Filename) {
 
 		InputFile.ignore(1024, '\n');
 
+		// Share one distance field atlas between sizes of a typeface
+		_GlyphAtlas *Atlas;
+		auto Iterator = GlyphAtlases.find(FontFile);
+		if(Iterator == GlyphAtlases.end()) {
+			Atlas = new _GlyphAtlas(AssetPath + ASSETS_FONTS + FontFile, Config.GetConfigPath() + FontFile + FONT_CACHEEXTENSION);
+			GlyphAtlases.insert(make_pair(FontFile, Atlas));
+		}
+		else
+			Atlas = Iterator->second;
+
 		// Load font
-		_Font *Font = new _Font(AssetPath + ASSETS_FONTS + FontFile, Size);
+		_Font *Font = new _Font(Atlas, Size);
 
 		// Check for duplicates
 		if(IsFontLoaded(Identifier)) {
@@ -337,14 +350,29 @@ void _Assets::LoadTextures(const std::string &Filename) {
 
 		std::string Identifier = GetTSVText(InputFile);
 		std::string TextureFile = GetTSVText(InputFile);
+		std::string AtlasName = GetTSVText(InputFile);
 		int Group;
 		bool Repeat, MipMaps;
 		InputFile >> Group >> Repeat >> MipMaps;
 		InputFile.ignore(1024, '\n');
 
-		// Load texture
+		// Load texture, or queue it for its atlas
 		std::string Path = AssetPath + ASSETS_TEXTURE_PATH + TextureFile;
-		_Texture *Texture = new _Texture(Path, Group, Repeat, MipMaps);
+		_Texture *Texture;
+		if(AtlasName != "") {
+			if(Repeat || MipMaps) {
+				throw std::runtime_error(std::string(__FUNCTION__) + " - Atlas textures cannot repeat or use mipmaps: " + Identifier);
+			}
+
+			_Atlas *&Atlas = Atlases[AtlasName];
+			if(!Atlas)
+				Atlas = new _Atlas(AtlasName);
+
+			Texture = Atlas->Add(Path, Group);
+		}
+		else
+			Texture = new _Texture(Path, Group, Repeat, MipMaps);
+
 		if(!Texture) {
 			throw std::runtime_error(std::string(__FUNCTION__) + " - Error loading: " + Path);
 		}
@@ -358,6 +386,10 @@ void _Assets::LoadTextures(const std::string &Filename) {
 	}
 
 	InputFile.close();
+
+	// Pack atlases
+	for(const auto &Atlas : Atlases)
+		Atlas.second->Build();
 }
 
 // Loads the sample table
@@ -448,8 +480,10 @@ void _Assets::LoadParticleTable(const std::string &Filename) {
 
 		InputFile 	>> Particle.Type >> Particle.Count >> Particle.Lifetime >> Particle.StartDirection[0] >> Particle.StartDirection[1] >> Particle.TurnSpeed[0]
 					>> Particle.TurnSpeed[1] >> Particle.VelocityScale[0] >> Particle.VelocityScale[1] >> Particle.AccelerationScale
-					>> Particle.Size[0] >> Particle.Size[1] >> Particle.ScaleAspect >> Particle.AlphaSpeed;
-		InputFile.ignore(1024, '\n');
+					>> Particle.Size[0] >> Particle.Size[1] >> Particle.ScaleAspect >> Particle.AlphaSpeed >> Particle.Priority
+					>> Particle.LightRadius >> Particle.LightDuration;
+		InputFile.ignore(1);
+		std::string LightColorIdentifier = GetTSVText(InputFile);
 
 		// Check for duplicates
 		if(IsParticleLoaded(Identifier)) {
@@ -463,6 +497,8 @@ void _Assets::LoadParticleTable(const std::string &Filename) {
 
 		// Set color
 		Particle.Color = GetColor(ColorIdentifier);
+		Particle.Priority = std::min(std::max(Particle.Priority, 0), PARTICLES_PRIORITIES - 1);
+		Particle.LightColor = GetColor(LightColorIdentifier);
 
 		ParticleTable.insert(make_pair(Identifier, Particle));
 	}
@@ -1447,7 +1483,11 @@ void _Assets::UnloadTextures() {
 	for(const auto &Texture : Textures)
 		delete Texture.second;
 
+	for(const auto &Atlas : Atlases)
+		delete Atlas.second;
+
 	Textures.clear();
+	Atlases.clear();
 }
 
 // Frees memory used by the monster set
@@ -1467,7 +1507,11 @@ void _Assets::UnloadFonts() {
 	for(const auto &Font : Fonts)
 		delete Font.second;
 
+	for(const auto &Atlas : GlyphAtlases)
+		delete Atlas.second;
+
 	Fonts.clear();
+	GlyphAtlases.clear();
 }
 
 // Returns the valid amount of experience
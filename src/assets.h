@@ -33,8 +33,9 @@ class _Image;
 class _Button;
 class _TextBox;
 class _Texture;
+class _Atlas;
+class _GlyphAtlas;
 class _Animation;
-class _Particle;
 class _Entity;
 class _Player;
 class _Monster;
@@ -277,11 +278,13 @@ class _Assets {
 		// Data
 		std::map<std::string, _Color> ColorTable;
 		std::map<std::string, _Texture *> Textures;
+		std::map<std::string, _Atlas *> Atlases;
 		std::map<std::string, _Reel> Reels;
 		std::map<std::string, _Animation *> Animations;
 		std::map<std::string, _Style *> Styles;
 		std::map<std::string, _Element *> Elements;
 		std::map<std::string, _Font *> Fonts;
+		std::map<std::string, _GlyphAtlas *> GlyphAtlases;
 		_WeaponParticleTemplate BlankWeaponParticle;
 };
 
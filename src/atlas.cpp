@@ -0,0 +1,162 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <atlas.h>
+#include <texture.h>
+#include <graphics.h>
+#include <constants.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <stdexcept>
+
+// Constructor
+_Atlas::_Atlas(const std::string &Name)
+:	Name(Name) {
+
+}
+
+// Destructor
+_Atlas::~_Atlas() {
+	for(const auto &Entry : Entries)
+		SDL_FreeSurface(Entry.Image);
+
+	for(const auto &Page : Pages)
+		delete Page;
+}
+
+// Load an image and queue it for packing
+_Texture *_Atlas::Add(const std::string &FilePath, int Group) {
+
+	// Open png file
+	SDL_Surface *Image = IMG_Load(FilePath.c_str());
+	if(!Image) {
+		throw std::runtime_error("Error loading image: " + FilePath + " with error: " + IMG_GetError());
+	}
+
+	if(Image->w + ATLAS_PADDING * 2 > ATLAS_SIZE || Image->h + ATLAS_PADDING * 2 > ATLAS_SIZE) {
+		SDL_FreeSurface(Image);
+		throw std::runtime_error("Image too large for atlas " + Name + ": " + FilePath);
+	}
+
+	_AtlasEntry Entry;
+	Entry.Texture = new _Texture(FilePath, Group, Image->w, Image->h);
+	Entry.Image = Image;
+	Entry.Page = Entry.X = Entry.Y = 0;
+	Entries.push_back(Entry);
+
+	return Entry.Texture;
+}
+
+// Pack the queued images into new pages and upload them
+void _Atlas::Build() {
+	if(Entries.empty())
+		return;
+
+	// Place tallest images first, filling shelves left to right
+	std::vector<size_t> Order(Entries.size());
+	for(size_t i = 0; i < Order.size(); i++)
+		Order[i] = i;
+	std::sort(Order.begin(), Order.end(), [this](size_t A, size_t B) {
+		const _Texture *TextureA = Entries[A].Texture;
+		const _Texture *TextureB = Entries[B].Texture;
+		if(TextureA->GetHeight() != TextureB->GetHeight())
+			return TextureA->GetHeight() > TextureB->GetHeight();
+		return TextureA->GetWidth() > TextureB->GetWidth();
+	});
+
+	std::vector<int> PageHeights(1, 0);
+	int X = 0, Y = 0, ShelfHeight = 0;
+	for(const auto &Index : Order) {
+		_AtlasEntry &Entry = Entries[Index];
+		int Width = Entry.Texture->GetWidth() + ATLAS_PADDING * 2;
+		int Height = Entry.Texture->GetHeight() + ATLAS_PADDING * 2;
+
+		// Start a new shelf, then a new page
+		if(X + Width > ATLAS_SIZE) {
+			X = 0;
+			Y += ShelfHeight;
+			ShelfHeight = 0;
+		}
+		if(Y + Height > ATLAS_SIZE) {
+			X = Y = ShelfHeight = 0;
+			PageHeights.push_back(0);
+		}
+
+		Entry.Page = (int)PageHeights.size() - 1;
+		Entry.X = X + ATLAS_PADDING;
+		Entry.Y = Y + ATLAS_PADDING;
+		X += Width;
+		ShelfHeight = std::max(ShelfHeight, Height);
+		PageHeights.back() = std::max(PageHeights.back(), Y + Height);
+	}
+
+	// Upload each page at the smallest power of two height that fits
+	for(size_t i = 0; i < PageHeights.size(); i++) {
+		int PageHeight = 1;
+		while(PageHeight < PageHeights[i])
+			PageHeight <<= 1;
+
+		_Texture *Page;
+		if(Graphics.IsEnabled()) {
+			std::vector<unsigned char> Data(ATLAS_SIZE * PageHeight * 4, 0);
+			for(const auto &Entry : Entries) {
+				if(Entry.Page == (int)i)
+					CopyImage(Entry, &Data[0], ATLAS_SIZE);
+			}
+
+			Page = new _Texture(&Data[0], ATLAS_SIZE, PageHeight, GL_RGBA8, GL_RGBA);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		else
+			Page = new _Texture(nullptr, ATLAS_SIZE, PageHeight, GL_RGBA8, GL_RGBA);
+
+		Pages.push_back(Page);
+	}
+
+	// Point textures at their regions and release the images
+	size_t FirstPage = Pages.size() - PageHeights.size();
+	for(const auto &Entry : Entries) {
+		Entry.Texture->SetRegion(Pages[FirstPage + Entry.Page], Entry.X, Entry.Y);
+		SDL_FreeSurface(Entry.Image);
+	}
+
+	Entries.clear();
+}
+
+// Copy an image into its page, extending the edge pixels into the padding
+void _Atlas::CopyImage(const _AtlasEntry &Entry, unsigned char *Data, int PageWidth) const {
+	const SDL_Surface *Image = Entry.Image;
+	int BytesPerPixel = Image->format->BitsPerPixel / 8;
+	const unsigned char *Pixels = (const unsigned char *)Image->pixels;
+
+	for(int j = -ATLAS_PADDING; j < Image->h + ATLAS_PADDING; j++) {
+		int SourceY = std::min(std::max(j, 0), Image->h - 1);
+		unsigned char *Destination = Data + ((Entry.Y + j) * PageWidth + Entry.X - ATLAS_PADDING) * 4;
+		for(int i = -ATLAS_PADDING; i < Image->w + ATLAS_PADDING; i++) {
+			int SourceX = std::min(std::max(i, 0), Image->w - 1);
+			const unsigned char *Source = Pixels + SourceY * Image->pitch + SourceX * BytesPerPixel;
+			Destination[0] = Source[0];
+			Destination[1] = Source[1];
+			Destination[2] = Source[2];
+			Destination[3] = BytesPerPixel == 4 ? Source[3] : 255;
+			Destination += 4;
+		}
+	}
+}
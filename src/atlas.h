@@ -0,0 +1,55 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <string>
+#include <vector>
+
+// Forward Declarations
+class _Texture;
+struct SDL_Surface;
+
+// Packs a group of small textures into shared pages
+class _Atlas {
+
+	public:
+
+		_Atlas(const std::string &Name);
+		~_Atlas();
+
+		_Texture *Add(const std::string &FilePath, int Group);
+		void Build();
+
+		const std::string &GetName() const { return Name; }
+		int GetPageCount() const { return (int)Pages.size(); }
+
+	private:
+
+		struct _AtlasEntry {
+			_Texture *Texture;
+			SDL_Surface *Image;
+			int Page, X, Y;
+		};
+
+		void CopyImage(const _AtlasEntry &Entry, unsigned char *Data, int PageWidth) const;
+
+		std::string Name;
+		std::vector<_AtlasEntry> Entries;
+		std::vector<_Texture *> Pages;
+};
@@ -175,6 +175,7 @@ void _Audio::FreeAllBuffers() {
 
 // Play an audio source and add it to the audio manager
 void _Audio::Play(_AudioSource *AudioSource, const Vector2 &Position) {
+	PlayCount++;
 	if(!Enabled) {
 		delete AudioSource;
 		return;
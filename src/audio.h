@@ -69,12 +69,13 @@ class _Audio {
 
 	public:
 
-		_Audio() { Enabled = false; }
+		_Audio() { Enabled = false; PlayCount = 0; }
 
 		void Init(bool Enabled);
 		void Close();
 
 		bool IsEnabled() { return Enabled; }
+		int GetPlayCount() const { return PlayCount; }
 
 		// Buffers
 		bool LoadBuffer(const std::string &Name, const std::string &File, float Volume=1.0f, int Limit=0);
@@ -95,6 +96,7 @@ class _Audio {
 
 		// State
 		bool Enabled;
+		int PlayCount;
 
 		// Buffers
 		std::map<std::string, _AudioBuffer> Buffers;
@@ -0,0 +1,341 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <framework.h>
+#include <config.h>
+#include <assets.h>
+#include <actions.h>
+#include <input.h>
+#include <audio.h>
+#include <graphics.h>
+#include <random.h>
+#include <filesystem.h>
+#include <particlekernel.h>
+#include <particles.h>
+#include <constants.h>
+#include <utils.h>
+#include <states/play.h>
+#include <objects/player.h>
+#include <objects/weapon.h>
+#include <objects/ammo.h>
+#include <SDL_timer.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+// Scripted input held for a number of ticks
+struct _BenchStep {
+	int Ticks;
+	int State;
+};
+
+// Replayed in a loop for the whole run
+const _BenchStep BenchScript[] = {
+	{ 90, 1 << _Actions::UP | 1 << _Actions::FIRE },
+	{ 60, 1 << _Actions::RIGHT | 1 << _Actions::FIRE | 1 << _Actions::AIM },
+	{ 30, 1 << _Actions::RELOAD },
+	{ 90, 1 << _Actions::DOWN | 1 << _Actions::SPRINT },
+	{ 60, 1 << _Actions::LEFT | 1 << _Actions::FIRE },
+	{ 30, 1 << _Actions::RELOAD },
+	{ 60, 1 << _Actions::UP | 1 << _Actions::LEFT | 1 << _Actions::AIM | 1 << _Actions::FIRE },
+	{ 30, 1 << _Actions::USE },
+	{ 60, 1 << _Actions::DOWN | 1 << _Actions::RIGHT | 1 << _Actions::FIRE },
+};
+
+const char *UpdateTimeNames[UPDATETIME_COUNT] = {
+	"player",
+	"monsters",
+	"particles",
+	"events",
+	"map",
+};
+
+const char *AITierNames[AI_TIER_COUNT] = {
+	"ai near",
+	"ai mid",
+	"ai far",
+};
+
+// Returns the action state for a tick
+static int GetScriptState(int Tick) {
+	int ScriptTicks = 0;
+	for(const auto &Step : BenchScript)
+		ScriptTicks += Step.Ticks;
+
+	Tick %= ScriptTicks;
+	for(const auto &Step : BenchScript) {
+		if(Tick < Step.Ticks)
+			return Step.State;
+
+		Tick -= Step.Ticks;
+	}
+
+	return 0;
+}
+
+// Apply script input for a tick and notify the play state of changes
+static void ApplyScript(int Tick, int &PreviousState) {
+	int State = GetScriptState(Tick);
+	for(int i = 0; i < _Actions::COUNT; i++) {
+		int Value = !!(State & (1 << i));
+		if(Value == !!(PreviousState & (1 << i)))
+			continue;
+
+		Actions.SetState(i, Value);
+		PlayState.HandleAction(_Input::KEYBOARD, i, Value);
+	}
+	PreviousState = State;
+
+	// Sweep the cursor around the player
+	double Angle = Tick * BENCH_CURSORSPEED;
+	Input.SetMouse(_Point(
+		Graphics.GetViewportWidth() / 2 + (int)(std::cos(Angle) * BENCH_CURSORRADIUS),
+		Graphics.GetViewportHeight() / 2 + (int)(std::sin(Angle) * BENCH_CURSORRADIUS)
+	));
+}
+
+// Run the script on one map and print the results
+static void RunMap(const std::string &MapFile, int Ticks, int Seed, const std::string &WeaponIdentifier, double AIBudget) {
+	Random.SetSeed(Seed);
+
+	// Create a player that doesn't touch the real save slots, freed even if the map throws
+	std::unique_ptr<_Player> Player(new _Player(Config.GetConfigPath() + "bench.save"));
+	_Weapon *Weapon = Assets.CreateWeapon(WeaponIdentifier, 1, ZERO_VECTOR, false);
+	Player->AddItem(Weapon);
+	if(Weapon->GetAmmoType() != AMMO_NONE) {
+		_Ammo *Ammo = Assets.CreateAmmoItem(Weapon->GetAmmoType());
+		Ammo->SetCount(BENCH_AMMO);
+		Player->AddItem(Ammo);
+	}
+
+	PlayState.SetPlayer(Player.get());
+	PlayState.SetLevel(MapFile);
+	PlayState.SetTestMode(false);
+	PlayState.GetAIScheduler().SetBudget(AIBudget);
+	PlayState.Init();
+
+	std::vector<double> TickTimes;
+	TickTimes.reserve(Ticks);
+	double SubsystemTimes[UPDATETIME_COUNT] = { 0 };
+	_AITierStats TierTotals[AI_TIER_COUNT] = { };
+	int AudioPlayCount = Audio.GetPlayCount();
+	int PreviousState = 0;
+	int ParticlePeak = 0;
+
+	// Run simulation
+	for(int i = 0; i < Ticks; i++) {
+		ApplyScript(i, PreviousState);
+
+		uint64_t Timer = SDL_GetPerformanceCounter();
+		PlayState.Update(GAME_TIMESTEP);
+		TickTimes.push_back(GetElapsedTime(Timer));
+
+		const double *UpdateTimes = PlayState.GetUpdateTimes();
+		for(int j = 0; j < UPDATETIME_COUNT; j++)
+			SubsystemTimes[j] += UpdateTimes[j];
+
+		for(int j = 0; j < AI_TIER_COUNT; j++) {
+			const _AITierStats &Stats = PlayState.GetAIScheduler().GetStats(j);
+			TierTotals[j].Count += Stats.Count;
+			TierTotals[j].Thinks += Stats.Thinks;
+			TierTotals[j].Deferred += Stats.Deferred;
+			TierTotals[j].Time += Stats.Time;
+		}
+
+		ParticlePeak = std::max(ParticlePeak, PlayState.GetParticles()->GetCount());
+	}
+
+	// Fingerprint the final state so runs can be compared between builds
+	uint32_t Checksum = Random.Generate(0xffffffff);
+	Checksum = Checksum * 31 + (uint32_t)(int)(Player->GetPosition().X * 1000.0f);
+	Checksum = Checksum * 31 + (uint32_t)(int)(Player->GetPosition().Y * 1000.0f);
+	Checksum = Checksum * 31 + (uint32_t)Player->GetHealth();
+	int ParticlesDropped = PlayState.GetParticles()->GetDroppedCount();
+	int ParticlesEvicted = PlayState.GetParticles()->GetEvictedCount();
+
+	PlayState.Close();
+	PlayState.SetPlayer(nullptr);
+	Player.reset();
+
+	// Get stats
+	double Total = 0.0;
+	for(auto Time : TickTimes)
+		Total += Time;
+
+	std::sort(TickTimes.begin(), TickTimes.end());
+	double P50 = TickTimes[TickTimes.size() * 50 / 100];
+	double P99 = TickTimes[TickTimes.size() * 99 / 100];
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << MapFile << ": " << Ticks << " ticks, " << std::setprecision(1) << Ticks / Total << " ticks/s, ";
+	std::cout << std::setprecision(4) << "p50 " << P50 * 1000.0 << " ms, p99 " << P99 * 1000.0 << " ms, ";
+	std::cout << Audio.GetPlayCount() - AudioPlayCount << " sounds, checksum " << std::hex << Checksum << std::dec << std::endl;
+	for(int i = 0; i < UPDATETIME_COUNT; i++) {
+		std::cout << "  " << std::left << std::setw(10) << UpdateTimeNames[i] << std::right;
+		std::cout << std::setprecision(4) << std::setw(9) << SubsystemTimes[i] / Ticks * 1000.0 << " ms";
+		std::cout << std::setprecision(1) << std::setw(7) << SubsystemTimes[i] / Total * 100.0 << "%" << std::endl;
+	}
+	for(int i = 0; i < AI_TIER_COUNT; i++) {
+		std::cout << "  " << std::left << std::setw(10) << AITierNames[i] << std::right;
+		std::cout << std::setprecision(4) << std::setw(9) << TierTotals[i].Time / Ticks * 1000.0 << " ms";
+		std::cout << std::setprecision(1) << std::setw(7) << (double)TierTotals[i].Count / Ticks << " monsters";
+		std::cout << std::setw(7) << (double)TierTotals[i].Thinks / Ticks << " thinks";
+		std::cout << std::setw(7) << (double)TierTotals[i].Deferred / Ticks << " deferred" << std::endl;
+	}
+	std::cout << "  particles " << ParticlePeak << " peak, " << ParticlesDropped << " dropped, " << ParticlesEvicted << " evicted" << std::endl;
+}
+
+// Time each particle kernel and compare its results to the scalar reference
+static void RunKernels(int Iterations) {
+	const int Count = BENCH_KERNELPARTICLES;
+	const int FieldCount = sizeof(_ParticleArrays) / sizeof(float *);
+	const int LifetimeField = offsetof(_ParticleArrays, Lifetime) / sizeof(float *);
+
+	// Random particles, with lifetimes that run out partway through
+	Random.SetSeed(BENCH_SEED);
+	std::vector<float> Initial(FieldCount * Count);
+	for(auto &Value : Initial)
+		Value = (float)Random.GenerateRange(-1.0, 1.0);
+	for(int i = 0; i < Count; i++)
+		Initial[LifetimeField * Count + i] = (float)Random.GenerateRange(0.0, Iterations * GAME_TIMESTEP * 2.0);
+
+	std::vector<float> Reference;
+	std::vector<uint32_t> ReferenceExpired;
+	double ReferenceTime = 0.0;
+	std::cout << std::fixed;
+	for(int i = 0; i < PARTICLEKERNEL_COUNT; i++) {
+		_ParticleKernel Kernel = GetParticleKernel(i);
+		if(!Kernel) {
+			std::cout << ParticleKernelNames[i] << ": unsupported" << std::endl;
+			continue;
+		}
+
+		std::vector<float> Data(Initial);
+		_ParticleArrays Arrays;
+		float **Fields = (float **)&Arrays;
+		for(int j = 0; j < FieldCount; j++)
+			Fields[j] = &Data[j * Count];
+
+		std::vector<uint32_t> Expired(Count / 32);
+		uint64_t Timer = SDL_GetPerformanceCounter();
+		for(int j = 0; j < Iterations; j++)
+			Kernel(Arrays, Count, (float)GAME_TIMESTEP, Expired.data());
+		double Time = GetElapsedTime(Timer);
+
+		bool Match = true;
+		if(i == PARTICLEKERNEL_SCALAR) {
+			Reference = Data;
+			ReferenceExpired = Expired;
+			ReferenceTime = Time;
+		}
+		else
+			Match = (Data == Reference && Expired == ReferenceExpired);
+
+		std::cout << ParticleKernelNames[i] << ": " << std::setprecision(3) << Time * 1e9 / ((double)Count * Iterations) << " ns/particle, ";
+		std::cout << std::setprecision(2) << ReferenceTime / Time << "x, " << (Match ? "matches scalar" : "MISMATCH") << std::endl;
+	}
+}
+
+int main(int ArgumentCount, char **Arguments) {
+	int Ticks = BENCH_TICKS;
+	int Seed = BENCH_SEED;
+	std::string WeaponIdentifier = BENCH_WEAPON;
+	double AIBudget = 0.0;
+	bool Kernels = false;
+	std::vector<std::string> Maps;
+
+	// Process arguments
+	std::string Token;
+	int TokensRemaining;
+	for(int i = 1; i < ArgumentCount; i++) {
+		Token = std::string(Arguments[i]);
+		TokensRemaining = ArgumentCount - i - 1;
+
+		if(Token == "-ticks" && TokensRemaining > 0) {
+			Ticks = atoi(Arguments[++i]);
+		}
+		else if(Token == "-seed" && TokensRemaining > 0) {
+			Seed = atoi(Arguments[++i]);
+		}
+		else if(Token == "-weapon" && TokensRemaining > 0) {
+			WeaponIdentifier = Arguments[++i];
+		}
+		else if(Token == "-aibudget" && TokensRemaining > 0) {
+			AIBudget = atof(Arguments[++i]);
+		}
+		else if(Token == "-kernels") {
+			Kernels = true;
+		}
+		else if(Token[0] != '-') {
+			Maps.push_back(Token);
+		}
+	}
+
+	if(Ticks <= 0) {
+		std::cerr << "Bad tick count" << std::endl;
+		return 1;
+	}
+
+	// Particle kernel microbenchmark
+	if(Kernels) {
+		RunKernels(Ticks);
+		return 0;
+	}
+
+	// Init config system
+	Config.Init("settings.cfg");
+
+	// Init framework without a window or audio device
+	char HeadlessArgument[] = "-headless";
+	char *FrameworkArguments[] = { Arguments[0], HeadlessArgument };
+	Framework.Init(2, FrameworkArguments);
+
+	// Default to every map that ships
+	if(Maps.empty()) {
+		std::vector<std::string> Files;
+		_FileSystem::GetFiles(Assets.GetAssetPath() + ASSETS_MAPS, Files);
+		for(const auto &File : Files) {
+			if(File.size() > 4 && File.substr(File.size() - 4) == ".map")
+				Maps.push_back(File);
+		}
+		std::sort(Maps.begin(), Maps.end());
+	}
+
+	// Run maps
+	int Status = 0;
+	for(const auto &Map : Maps) {
+		try {
+			RunMap(Map, Ticks, Seed, WeaponIdentifier, AIBudget);
+		}
+		catch(std::exception &Error) {
+			std::cerr << Map << ": " << Error.what() << std::endl;
+			Status = 1;
+		}
+	}
+
+	// Shutdown
+	Framework.Close();
+	Config.Close();
+
+	return Status;
+}
@@ -0,0 +1,111 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <blockindex.h>
+#include <constants.h>
+#include <algorithm>
+#include <cmath>
+
+// Remove all blocks and size the buckets for a map
+void _BlockIndex::Clear(int Width, int Height) {
+	BucketsX = (Width + MAP_BLOCKBUCKETSIZE - 1) / MAP_BLOCKBUCKETSIZE;
+	BucketsY = (Height + MAP_BLOCKBUCKETSIZE - 1) / MAP_BLOCKBUCKETSIZE;
+
+	Buckets.clear();
+	Buckets.resize(BucketsX * BucketsY);
+	Rects.clear();
+	AlwaysVisible.clear();
+	Stamps.clear();
+	Stamp = 0;
+	Dirty = false;
+}
+
+// Add the next block to every bucket it overlaps
+void _BlockIndex::Add(const _Coord &Start, const _Coord &End, bool AlwaysVisible) {
+	int Index = (int)Rects.size();
+
+	_Rect Rect;
+	Rect.Start = Start;
+	Rect.End = End;
+	Rects.push_back(Rect);
+	Stamps.push_back(0);
+
+	if(AlwaysVisible)
+		this->AlwaysVisible.push_back(Index);
+
+	int StartX = std::max(Start.X / MAP_BLOCKBUCKETSIZE, 0);
+	int StartY = std::max(Start.Y / MAP_BLOCKBUCKETSIZE, 0);
+	int EndX = std::min(End.X / MAP_BLOCKBUCKETSIZE, BucketsX - 1);
+	int EndY = std::min(End.Y / MAP_BLOCKBUCKETSIZE, BucketsY - 1);
+	for(int j = StartY; j <= EndY; j++) {
+		for(int i = StartX; i <= EndX; i++)
+			Buckets[j * BucketsX + i].push_back(Index);
+	}
+}
+
+// Get blocks in buckets touching the bounds, in block order
+void _BlockIndex::Query(const float *Bounds, std::vector<int> &Indices) {
+	Indices.clear();
+
+	// Reset stamps on wrap
+	if(++Stamp == 0) {
+		std::fill(Stamps.begin(), Stamps.end(), 0);
+		Stamp = 1;
+	}
+
+	for(size_t i = 0; i < AlwaysVisible.size(); i++) {
+		Stamps[AlwaysVisible[i]] = Stamp;
+		Indices.push_back(AlwaysVisible[i]);
+	}
+
+	// Block bounds extend to End + 1, so include the tile left of the bounds
+	int StartX = std::max(((int)std::floor(Bounds[0]) - 1) / MAP_BLOCKBUCKETSIZE, 0);
+	int StartY = std::max(((int)std::floor(Bounds[1]) - 1) / MAP_BLOCKBUCKETSIZE, 0);
+	int EndX = std::min((int)std::floor(Bounds[2]) / MAP_BLOCKBUCKETSIZE, BucketsX - 1);
+	int EndY = std::min((int)std::floor(Bounds[3]) / MAP_BLOCKBUCKETSIZE, BucketsY - 1);
+	for(int j = StartY; j <= EndY; j++) {
+		for(int i = StartX; i <= EndX; i++) {
+			const std::vector<int> &Bucket = Buckets[j * BucketsX + i];
+			for(size_t k = 0; k < Bucket.size(); k++) {
+				if(Stamps[Bucket[k]] != Stamp) {
+					Stamps[Bucket[k]] = Stamp;
+					Indices.push_back(Bucket[k]);
+				}
+			}
+		}
+	}
+
+	// Keep draw order stable
+	std::sort(Indices.begin(), Indices.end());
+}
+
+// Return the last block containing a tile
+int _BlockIndex::GetBlockAt(const _Coord &Coord) const {
+	int X = Coord.X / MAP_BLOCKBUCKETSIZE;
+	int Y = Coord.Y / MAP_BLOCKBUCKETSIZE;
+	if(Coord.X < 0 || Coord.Y < 0 || X >= BucketsX || Y >= BucketsY)
+		return -1;
+
+	const std::vector<int> &Bucket = Buckets[Y * BucketsX + X];
+	for(int i = (int)Bucket.size() - 1; i >= 0; i--) {
+		const _Rect &Rect = Rects[Bucket[i]];
+		if(Coord.X >= Rect.Start.X && Coord.Y >= Rect.Start.Y && Coord.X <= Rect.End.X && Coord.Y <= Rect.End.Y)
+			return Bucket[i];
+	}
+
+	return -1;
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <vector2.h>
+#include <coord.h>
+#include <vector>
+#include <stdint.h>
+
+// Uniform bucket grid over the block rectangles of one map layer
+class _BlockIndex {
+
+	public:
+
+		_BlockIndex() : Dirty(true), BucketsX(0), BucketsY(0), Stamp(0) { }
+
+		void Clear(int Width, int Height);
+		void Add(const _Coord &Start, const _Coord &End, bool AlwaysVisible);
+		void Query(const float *Bounds, std::vector<int> &Indices);
+		int GetBlockAt(const _Coord &Coord) const;
+
+		void Invalidate() { Dirty = true; }
+		bool IsDirty() const { return Dirty; }
+
+	private:
+
+		// Rectangle of an indexed block
+		struct _Rect {
+			_Coord Start;
+			_Coord End;
+		};
+
+		bool Dirty;
+
+		// Buckets
+		int BucketsX, BucketsY;
+		std::vector<std::vector<int> > Buckets;
+
+		// Blocks
+		std::vector<_Rect> Rects;
+		std::vector<int> AlwaysVisible;
+
+		// Duplicate removal during queries
+		std::vector<uint32_t> Stamps;
+		uint32_t Stamp;
+};
@@ -18,7 +18,6 @@
 #include <camera.h>
 #include <graphics.h>
 #include <constants.h>
-#include <opengl.h>
 #include <ui/ui.h>
 
 // Initialize
@@ -53,14 +52,7 @@ void _Camera::Set3DProjection(double BlendFactor) const {
 	Vector2 DrawPosition(Position * BlendFactor + LastPosition * (1.0f - BlendFactor));
 	float DrawDistance = Distance * BlendFactor + LastDistance * (1.0f - BlendFactor);
 
-	// Set projection matrix and frustum
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glFrustum(-Frustum[0], Frustum[0], Frustum[1], -Frustum[1], Near, Far);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glTranslatef(-DrawPosition.X, -DrawPosition.Y, -DrawDistance);
+	Graphics.Setup3DProjection(Frustum, Near, Far, DrawPosition, DrawDistance);
 }
 
 // Converts screen space to world space
@@ -56,3 +56,4 @@ const _Color COLOR_BLUE     = _Color(0.0f, 0.0f, 1.0f, 1.0f);
 const _Color COLOR_YELLOW   = _Color(1.0f, 1.0f, 0.0f, 1.0f);
 const _Color COLOR_MAGENTA  = _Color(1.0f, 0.0f, 1.0f, 1.0f);
 const _Color COLOR_CYAN     = _Color(0.0f, 1.0f, 1.0f, 1.0f);
+const _Color COLOR_TRANSPARENT = _Color(0.0f, 0.0f, 0.0f, 0.0f);
@@ -64,11 +64,15 @@ void _Config::SetDefaults() {
 	Fullscreen = DEFAULT_FULLSCREEN;
 	Vsync = DEFAULT_VSYNC;
 	MaxFPS = DEFAULT_MAXFPS;
+	ParticleBudget = DEFAULT_PARTICLEBUDGET;
+	GraphicsBackend = DEFAULT_GRAPHICSBACKEND;
 	AudioEnabled = DEFAULT_AUDIOENABLED;
 
 	SoundVolume = 1.0f;
 	MusicVolume = 1.0f;
 
+	WorkerThreads = DEFAULT_WORKERTHREADS;
+
 	LoadDefaultInputBindings();
 }
 
@@ -143,9 +147,12 @@ void _Config::Load() {
 	GetValue("max_fps", MaxFPS);
 	GetValue("aniso", Aniso);
 	GetValue("msaa", MSAA);
+	GetValue("particle_budget", ParticleBudget);
+	GetValue("graphics_backend", GraphicsBackend);
 	GetValue("audio_enabled", AudioEnabled);
 	GetValue("sound_volume", SoundVolume);
 	GetValue("music_volume", MusicVolume);
+	GetValue("worker_threads", WorkerThreads);
 
 	// Load bindings
 	for(int i = 0; i < _Actions::COUNT; i++) {
@@ -189,9 +196,12 @@ void _Config::Save() {
 	Out << "max_fps=" << MaxFPS << std::endl;
 	Out << "msaa=" << MSAA << std::endl;
 	Out << "aniso=" << Aniso << std::endl;
+	Out << "particle_budget=" << ParticleBudget << std::endl;
+	Out << "graphics_backend=" << GraphicsBackend << std::endl;
 	Out << "audio_enabled=" << AudioEnabled << std::endl;
 	Out << "sound_volume=" << SoundVolume << std::endl;
 	Out << "music_volume=" << MusicVolume << std::endl;
+	Out << "worker_threads=" << WorkerThreads << std::endl;
 
 	// Write out input map
 	for(int i = 0; i < _Actions::COUNT; i++) {
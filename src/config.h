@@ -47,12 +47,17 @@ class _Config {
 		int MSAA;
 		int Aniso;
 		int Fullscreen;
+		int ParticleBudget;
+		int GraphicsBackend;
 
 		// Audio
 		int AudioEnabled;
 		float SoundVolume;
 		float MusicVolume;
 
+		// System
+		int WorkerThreads;
+
 	private:
 
 		template <typename Type>
@@ -29,6 +29,9 @@ const  int          DEFAULT_FULLSCREEN             =  1;
 const  int          DEFAULT_AUDIOENABLED           =  1;
 const  int          DEFAULT_VSYNC                  =  1;
 const  double       DEFAULT_MAXFPS                 =  180.0;
+const  int          DEFAULT_WORKERTHREADS          =  -1;
+const  int          DEFAULT_PARTICLEBUDGET         =  4096;
+const  int          DEFAULT_GRAPHICSBACKEND        =  1;
 const  int          DEFAULT_KEYUP                  =  SDL_SCANCODE_E;
 const  int          DEFAULT_KEYDOWN                =  SDL_SCANCODE_D;
 const  int          DEFAULT_KEYLEFT                =  SDL_SCANCODE_S;
@@ -65,6 +68,13 @@ const  float        CAMERA_NEAR                    =  0.1f;
 const  float        CAMERA_FAR                     =  500.0f;
 //     Graphics
 const  int          GRAPHICS_CIRCLE_VERTICES       =  32;
+const  int          GRAPHICS_VERTEXSIZE            =  8;
+const  int          GRAPHICS_STREAMSIZE            =  1 << 20;
+const  int          GRAPHICS_STREAMREGIONS         =  3;
+const  int          GRAPHICS_FENCETIMEOUT          =  1000000000;
+//     Render queue
+const  float        RENDERQUEUE_DEPTHMIN           =  -1.0f;
+const  float        RENDERQUEUE_DEPTHMAX           =  3.0f;
 //     Weapons
 const  double       WEAPON_MINFIREPERIOD           =  0.017;
 //     Audio
@@ -103,6 +113,8 @@ const  int          ITEM_MEDKIT_HEALTH             =  50;
 const  float        OBJECT_Z                       =  0.3f;
 //     Map
 const  int          MAP_FILEVERSION                =  1;
+const  int          MAP_BINARYVERSION              =  1;
+const  char         MAP_BINARYMAGIC[]              =  "ECMB";
 const  std::string  MAP_DEFAULTMONSTERSET          =  "tutorial0";
 const  float        MAP_MINZ                       =  0.0f;
 const  float        MAP_FLATZ                      =  1.0f;
@@ -112,6 +124,48 @@ const  float        MAP_LAYEROFFSET                =  0.01f;
 const  int          MAP_WIDTH                      =  100;
 const  int          MAP_HEIGHT                     =  100;
 const  float        MAP_EPSILON                    =  0.0001f;
+const  int          MAP_GRIDNODES                  =  1024;
+const  int          MAP_BLOCKBUCKETSIZE            =  8;
+const  int          MAP_CHUNKSIZE                  =  16;
+//     Pathfinding
+const  int          PATH_MAXNODES                  =  4096;
+const  int          PATH_TICKBUDGET                =  2048;
+const  size_t       PATH_CACHESIZE                 =  512;
+const  float        PATH_FLOWFIELDRANGE            =  40.0f;
+//     AI
+const  double       AI_TICKBUDGET                  =  500.0;
+const  int          AI_MIDINTERVAL                 =  2;
+const  int          AI_FARINTERVAL                 =  8;
+const  int          AI_MAXINTERVAL                 =  30;
+const  float        AI_MIDRANGEFACTOR              =  2.0f;
+const  double       AI_THINKCOSTRATE               =  0.1;
+const  int          AI_PERCEPTIONBATCH             =  16;
+//     Particles
+const  int          PARTICLES_CAPACITY             =  16384;
+const  int          PARTICLES_PRIORITIES           =  4;
+const  float        PARTICLES_LODRANGE             =  4.0f;
+//     Decals
+const  int          DECALS_RESOLUTION              =  512;
+const  int          DECALS_BUDGET                  =  64 << 20;
+const  float        DECALS_BAKELIFETIME            =  1.0f;
+const  double       DECALS_REFRESHPERIOD           =  0.1;
+//     Lights
+const  int          LIGHTS_CAPACITY                =  4096;
+const  int          LIGHTS_DOWNSAMPLE              =  4;
+const  int          LIGHTS_TILESIZE                =  16;
+const  int          LIGHTS_TILEMAX                 =  8;
+const  float        LIGHTS_PADDING                 =  1.0f;
+//     Atlas
+const  int          ATLAS_SIZE                     =  1024;
+const  int          ATLAS_PADDING                  =  2;
+//     Text cache
+const  int          TEXTCACHE_SIZE                 =  1024;
+//     Fonts
+const  int          FONT_SDFSIZE                   =  32;
+const  int          FONT_SDFSPREAD                 =  4;
+const  int          FONT_ATLASSIZE                 =  512;
+const  int          FONT_CACHEVERSION              =  1;
+const  std::string  FONT_CACHEEXTENSION            =  ".sdf";
 //     Editor
 const  std::string  EDITOR_TESTLEVEL               =  "test.map";
 const  float        EDITOR_OBJECTRADIUS            =  0.4f;
@@ -175,3 +229,18 @@ const  std::string  ASSETS_LABELS                  =  "tables/ui/labels.tsv";
 const  std::string  ASSETS_IMAGES                  =  "tables/ui/images.tsv";
 const  std::string  ASSETS_BUTTONS                 =  "tables/ui/buttons.tsv";
 const  std::string  ASSETS_TEXTBOXES               =  "tables/ui/textboxes.tsv";
+//     Benchmark
+const  int          BENCH_TICKS                    =  3600;
+const  int          BENCH_SEED                     =  1;
+const  std::string  BENCH_WEAPON                   =  "special_rifle0";
+const  int          BENCH_AMMO                     =  5000;
+const  int          BENCH_CURSORRADIUS             =  200;
+const  double       BENCH_CURSORSPEED              =  0.02;
+const  int          BENCH_KERNELPARTICLES          =  PARTICLES_CAPACITY;
+//     Profiler
+const  int          PROFILER_FRAMES                =  300;
+const  int          PROFILER_ZONES                 =  64;
+const  std::string  PROFILER_FONT                  =  "hud_tiny";
+const  std::string  PROFILER_DUMPNAME              =  "profile";
+const  int          PROFILER_X                     =  10;
+const  int          PROFILER_Y                     =  40;
@@ -0,0 +1,289 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <decals.h>
+#include <profiler.h>
+#include <renderqueue.h>
+#include <camera.h>
+#include <constants.h>
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+_Decals::_Decals(int Width, int Height)
+:	ChunksX((Width + MAP_CHUNKSIZE - 1) / MAP_CHUNKSIZE),
+	ChunksY((Height + MAP_CHUNKSIZE - 1) / MAP_CHUNKSIZE),
+	MaxTargets(std::max(DECALS_BUDGET / (DECALS_RESOLUTION * DECALS_RESOLUTION * 4), 1)),
+	Frame(0),
+	Time(0.0) {
+
+	for(int i = 0; i < DECAL_COUNT; i++)
+		ChunkTargets[i].assign(ChunksX * ChunksY, -1);
+}
+
+// Destructor
+_Decals::~_Decals() {
+	for(const auto &Target : Targets)
+		Graphics.DeleteRenderTarget(Target.Framebuffer, Target.Texture);
+}
+
+// Expire decals and mark chunks whose decals have faded since their last bake
+void _Decals::Update(double FrameTime) {
+	Time += FrameTime;
+
+	for(int i = 0; i < (int)Targets.size(); i++) {
+		_DecalTarget &Target = Targets[i];
+		if(Target.Layer < 0)
+			continue;
+
+		// Drop expired decals
+		bool Fading = false;
+		size_t Kept = 0;
+		for(size_t j = 0; j < Target.Records.size(); j++) {
+			if(Target.Records[j].End <= Time)
+				continue;
+
+			Fading |= Target.Records[j].AlphaRate != 0.0f;
+			Target.Records[Kept++] = Target.Records[j];
+		}
+
+		if(Kept == 0) {
+			FreeTarget(i);
+			continue;
+		}
+
+		if(Kept < Target.Records.size()) {
+			Target.Records.resize(Kept);
+			Target.Dirty = true;
+		}
+		else if(Fading && Time >= Target.NextRefresh)
+			Target.Dirty = true;
+	}
+}
+
+// Draw quads of six vertices each into the chunks they overlap
+void _Decals::Bake(int Layer, const std::vector<_DecalQuad> &Quads) {
+	_ProfilerScope Zone("Decals::Bake");
+
+	// Find the chunks touched by each quad
+	ChunkQuads.clear();
+	for(size_t Quad = 0; Quad < Quads.size(); Quad++) {
+		const _StreamVertex *Vertex = Quads[Quad].Vertices;
+		float Bounds[4] = { Vertex->X, Vertex->Y, Vertex->X, Vertex->Y };
+		for(int i = 1; i < 6; i++) {
+			Bounds[0] = std::min(Bounds[0], Vertex[i].X);
+			Bounds[1] = std::min(Bounds[1], Vertex[i].Y);
+			Bounds[2] = std::max(Bounds[2], Vertex[i].X);
+			Bounds[3] = std::max(Bounds[3], Vertex[i].Y);
+		}
+
+		int StartX = std::max((int)std::floor(Bounds[0] / MAP_CHUNKSIZE), 0);
+		int StartY = std::max((int)std::floor(Bounds[1] / MAP_CHUNKSIZE), 0);
+		int EndX = std::min((int)std::floor(Bounds[2] / MAP_CHUNKSIZE), ChunksX - 1);
+		int EndY = std::min((int)std::floor(Bounds[3] / MAP_CHUNKSIZE), ChunksY - 1);
+		for(int Y = StartY; Y <= EndY; Y++) {
+			for(int X = StartX; X <= EndX; X++)
+				ChunkQuads.push_back(std::make_pair(Y * ChunksX + X, (int)Quad));
+		}
+	}
+	if(ChunkQuads.empty())
+		return;
+
+	// Group by chunk, keeping the original order inside each
+	std::sort(ChunkQuads.begin(), ChunkQuads.end());
+
+	Graphics.DisableDepthTest();
+	Graphics.EnableBakeBlending();
+	for(size_t Start = 0; Start < ChunkQuads.size(); ) {
+		int Chunk = ChunkQuads[Start].first;
+
+		// Get render target
+		bool Fresh;
+		_DecalTarget &Target = Targets[GetTarget(Layer, Chunk, Fresh)];
+		Target.LastSeen = Frame;
+
+		// Keep the quads for this chunk so it can be re-baked
+		size_t First = Target.Records.size();
+		size_t End = Start;
+		for(; End < ChunkQuads.size() && ChunkQuads[End].first == Chunk; End++) {
+			const _DecalQuad &Quad = Quads[ChunkQuads[End].second];
+			_DecalRecord Record;
+			std::copy(Quad.Vertices, Quad.Vertices + 6, Record.Vertices);
+			Record.Texture = Quad.Texture;
+			Record.Alpha = Quad.Vertices[0].Alpha / 255.0f;
+			Record.AlphaRate = Quad.AlphaRate;
+			Record.Start = Time;
+			Record.End = Time + Quad.Lifetime;
+			Target.Records.push_back(Record);
+
+			Target.Z = Fresh && End == Start ? Quad.Vertices[0].Z : std::max(Target.Z, Quad.Vertices[0].Z);
+		}
+		Start = End;
+
+		// Add the new quads on top, or redraw everything when the chunk is stale
+		if(Fresh || Target.Dirty)
+			DrawRecords(Target, 0, true);
+		else
+			DrawRecords(Target, First, false);
+	}
+	Graphics.DisableParticleBlending();
+}
+
+// Re-bake visible chunks that changed since their last bake
+void _Decals::Refresh(const _Camera *Camera) {
+	_ProfilerScope Zone("Decals::Refresh");
+
+	bool Started = false;
+	for(auto &Target : Targets) {
+		if(Target.Layer < 0 || !Target.Dirty)
+			continue;
+
+		float Bounds[4];
+		GetChunkBounds(Target.Chunk, Bounds);
+		if(!Camera->IsAABBInView(Bounds))
+			continue;
+
+		if(!Started) {
+			Graphics.DisableDepthTest();
+			Graphics.EnableBakeBlending();
+			Started = true;
+		}
+
+		DrawRecords(Target, 0, true);
+	}
+
+	if(Started)
+		Graphics.DisableParticleBlending();
+}
+
+// Queue the baked chunks of a layer that are in view
+void _Decals::Render(int Layer, const _Camera *Camera) {
+	_ProfilerScope Zone("Decals::Render");
+
+	Frame++;
+	if(Layer == DECAL_FLOOR)
+		Profiler.SetCounter("Decal chunks", (double)(Targets.size() - FreeTargets.size()));
+
+	for(auto &Target : Targets) {
+		if(Target.Layer != Layer)
+			continue;
+
+		float Bounds[4];
+		GetChunkBounds(Target.Chunk, Bounds);
+		if(!Camera->IsAABBInView(Bounds))
+			continue;
+
+		Target.LastSeen = Frame;
+
+		// Targets hold premultiplied color, and texture rows start at the chunk's top edge, matching the bake projection
+		_StreamVertex *Vertices = RenderQueue.AddVertices(Target.Texture, 6, RENDERBLEND_PREMULTIPLIED);
+		Graphics.BuildQuad(Vertices, Bounds[0], Bounds[1], Bounds[2], Bounds[3], 0.0f, 0.0f, 1.0f, 1.0f, COLOR_WHITE, Target.Z);
+	}
+}
+
+// Draw a target's decals from First on at their current alpha, clearing it first for a full re-bake
+void _Decals::DrawRecords(_DecalTarget &Target, size_t First, bool Clear) {
+	ChunkVertices.clear();
+	ChunkTextures.clear();
+	for(size_t i = First; i < Target.Records.size(); i++) {
+		const _DecalRecord &Record = Target.Records[i];
+		uint8_t Alpha = GetColorByte(Record.Alpha + Record.AlphaRate * (float)(Time - Record.Start));
+		for(int j = 0; j < 6; j++) {
+			ChunkVertices.push_back(Record.Vertices[j]);
+			ChunkVertices.back().Alpha = Alpha;
+		}
+		ChunkTextures.push_back(Record.Texture);
+	}
+
+	if(Clear) {
+		Target.Dirty = false;
+		Target.NextRefresh = Time + DECALS_REFRESHPERIOD;
+	}
+
+	float Bounds[4];
+	GetChunkBounds(Target.Chunk, Bounds);
+
+	// Draw each run of the same texture
+	Graphics.UploadStream(ChunkVertices);
+	Graphics.BeginRenderTarget(Target.Framebuffer, DECALS_RESOLUTION, DECALS_RESOLUTION, Bounds, Clear);
+	Graphics.EnableVBO(VBO_STREAM);
+	size_t Run = 0;
+	for(size_t i = 1; i <= ChunkTextures.size(); i++) {
+		if(i == ChunkTextures.size() || ChunkTextures[i] != ChunkTextures[Run]) {
+			Graphics.DrawMesh(ChunkTextures[Run], (GLint)(Run * 6), (GLsizei)((i - Run) * 6), false);
+			Run = i;
+		}
+	}
+	Graphics.DisableVBO(VBO_STREAM);
+	Graphics.EndRenderTarget();
+}
+
+// Get the render target for a chunk, reusing a free one or taking the least recently seen one when over budget
+int _Decals::GetTarget(int Layer, int Chunk, bool &Fresh) {
+	int &Index = ChunkTargets[Layer][Chunk];
+	Fresh = Index < 0;
+	if(!Fresh)
+		return Index;
+
+	if(!FreeTargets.empty()) {
+		Index = FreeTargets.back();
+		FreeTargets.pop_back();
+	}
+	else if((int)Targets.size() < MaxTargets) {
+		_DecalTarget Target;
+		Target.Framebuffer = Graphics.CreateRenderTarget(DECALS_RESOLUTION, DECALS_RESOLUTION, Target.Texture);
+		Targets.push_back(Target);
+		Index = (int)Targets.size() - 1;
+	}
+	else {
+		int Oldest = 0;
+		for(int i = 1; i < (int)Targets.size(); i++) {
+			if(Targets[i].LastSeen < Targets[Oldest].LastSeen)
+				Oldest = i;
+		}
+
+		// Evicted decals are lost
+		ChunkTargets[Targets[Oldest].Layer][Targets[Oldest].Chunk] = -1;
+		Index = Oldest;
+	}
+
+	_DecalTarget &Target = Targets[Index];
+	Target.Layer = Layer;
+	Target.Chunk = Chunk;
+	Target.Records.clear();
+	Target.Dirty = false;
+	Target.NextRefresh = Time + DECALS_REFRESHPERIOD;
+
+	return Index;
+}
+
+// Return a target whose decals have all expired to the free list
+void _Decals::FreeTarget(int Index) {
+	_DecalTarget &Target = Targets[Index];
+	ChunkTargets[Target.Layer][Target.Chunk] = -1;
+	Target.Layer = -1;
+	Target.Records.clear();
+	FreeTargets.push_back(Index);
+}
+
+// Get the world rectangle covered by a chunk
+void _Decals::GetChunkBounds(int Chunk, float *Bounds) const {
+	Bounds[0] = (float)(Chunk % ChunksX * MAP_CHUNKSIZE);
+	Bounds[1] = (float)(Chunk / ChunksX * MAP_CHUNKSIZE);
+	Bounds[2] = Bounds[0] + MAP_CHUNKSIZE;
+	Bounds[3] = Bounds[1] + MAP_CHUNKSIZE;
+}
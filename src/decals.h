@@ -0,0 +1,103 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <graphics.h>
+#include <vector>
+#include <stdint.h>
+
+// Forward Declarations
+class _Camera;
+
+// Layers of baked decals
+enum DecalLayerType {
+	DECAL_FLOOR,
+	DECAL_WALL,
+	DECAL_COUNT
+};
+
+// Settled decal handed over for baking, with its fade in alpha per second and seconds left to live
+struct _DecalQuad {
+	_StreamVertex Vertices[6];
+	GLuint Texture;
+	float AlphaRate;
+	float Lifetime;
+};
+
+// Decal kept with its chunk so the chunk can be re-baked as it fades or expires
+struct _DecalRecord {
+	_StreamVertex Vertices[6];
+	GLuint Texture;
+	float Alpha;
+	float AlphaRate;
+	double Start;
+	double End;
+};
+
+// Render target holding the baked decals of one map chunk
+struct _DecalTarget {
+	GLuint Framebuffer;
+	GLuint Texture;
+	int Layer;
+	int Chunk;
+	float Z;
+	uint64_t LastSeen;
+	std::vector<_DecalRecord> Records;
+	double NextRefresh;
+	bool Dirty;
+};
+
+// Bakes settled decals into per-chunk textures within a fixed memory budget
+class _Decals {
+
+	public:
+
+		_Decals(int Width, int Height);
+		~_Decals();
+
+		void Update(double FrameTime);
+		void Bake(int Layer, const std::vector<_DecalQuad> &Quads);
+		void Refresh(const _Camera *Camera);
+		void Render(int Layer, const _Camera *Camera);
+
+		int GetTargetCount() const { return (int)Targets.size(); }
+		int GetMaxTargets() const { return MaxTargets; }
+
+	private:
+
+		int GetTarget(int Layer, int Chunk, bool &Fresh);
+		void FreeTarget(int Index);
+		void DrawRecords(_DecalTarget &Target, size_t First, bool Clear);
+		void GetChunkBounds(int Chunk, float *Bounds) const;
+
+		int ChunksX, ChunksY;
+		int MaxTargets;
+		uint64_t Frame;
+		double Time;
+
+		// Targets and the index of each chunk's target per layer, with unused targets on a free list
+		std::vector<_DecalTarget> Targets;
+		std::vector<int> ChunkTargets[DECAL_COUNT];
+		std::vector<int> FreeTargets;
+
+		// Scratch
+		std::vector<std::pair<int, int>> ChunkQuads;
+		std::vector<_StreamVertex> ChunkVertices;
+		std::vector<GLuint> ChunkTextures;
+};
@@ -23,6 +23,9 @@
 	#include <windows.h>
 #else
 	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
 	#include <dirent.h>
 #endif
 
@@ -67,3 +70,65 @@ void _FileSystem::GetFiles(const std::string &Path, std::vector<std::string> &Co
 
 	#endif
 }
+
+// Map a file into memory, leaving Data null on failure
+_MappedFile::_MappedFile(const std::string &Path) :
+	Data(nullptr),
+	Size(0) {
+
+	#ifdef _WIN32
+
+		MappingHandle = nullptr;
+		FileHandle = CreateFile(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(FileHandle == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER FileSize;
+		if(!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart == 0)
+			return;
+
+		MappingHandle = CreateFileMapping(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(!MappingHandle)
+			return;
+
+		Data = (const char *)MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if(Data)
+			Size = (size_t)FileSize.QuadPart;
+	#else
+
+		FileDescriptor = open(Path.c_str(), O_RDONLY);
+		if(FileDescriptor == -1)
+			return;
+
+		struct stat FileStat;
+		if(fstat(FileDescriptor, &FileStat) == -1 || FileStat.st_size == 0)
+			return;
+
+		void *Memory = mmap(nullptr, FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+		if(Memory == MAP_FAILED)
+			return;
+
+		Data = (const char *)Memory;
+		Size = FileStat.st_size;
+	#endif
+}
+
+// Unmap file
+_MappedFile::~_MappedFile() {
+
+	#ifdef _WIN32
+
+		if(Data)
+			UnmapViewOfFile(Data);
+		if(MappingHandle)
+			CloseHandle(MappingHandle);
+		if(FileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(FileHandle);
+	#else
+
+		if(Data)
+			munmap((void *)Data, Size);
+		if(FileDescriptor != -1)
+			close(FileDescriptor);
+	#endif
+}
@@ -20,6 +20,7 @@
 // Libraries
 #include <string>
 #include <vector>
+#include <cstddef>
 
 // Class for managing file systems
 class _FileSystem {
@@ -31,3 +32,26 @@ class _FileSystem {
 	private:
 
 };
+
+// Read-only memory mapped file
+class _MappedFile {
+
+	public:
+
+		_MappedFile(const std::string &Path);
+		~_MappedFile();
+
+		const char *GetData() const { return Data; }
+		size_t GetSize() const { return Size; }
+
+	private:
+
+		const char *Data;
+		size_t Size;
+		#ifdef _WIN32
+			void *FileHandle;
+			void *MappingHandle;
+		#else
+			int FileDescriptor;
+		#endif
+};
@@ -0,0 +1,119 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <flowfield.h>
+#include <constants.h>
+#include <algorithm>
+
+// Allocate distance grid for a map
+void _FlowField::Init(const _Map *Map, int Width, int Height) {
+	Grid.Init(Map, Width, Height);
+
+	Distance.assign(Width * Height, 0.0f);
+	Reached.assign(Width * Height, 0);
+	Open.clear();
+	Generation = 0;
+	Target = _Coord(-1, -1);
+	Dirty = false;
+}
+
+// Move the target, marking the field stale if it changed tiles
+void _FlowField::SetTarget(const _Coord &Target) {
+	if(Target != this->Target) {
+		this->Target = Target;
+		Dirty = true;
+	}
+}
+
+// Run one Dijkstra sweep out from the target when stale
+void _FlowField::Update() {
+	if(!Dirty || !Grid.GetMap())
+		return;
+
+	Dirty = false;
+
+	// Reset distances on wrap
+	if(++Generation == 0) {
+		std::fill(Reached.begin(), Reached.end(), 0);
+		Generation = 1;
+	}
+
+	if(!Grid.IsWalkable(Target.X, Target.Y))
+		return;
+
+	int Start = Target.Y * Grid.GetWidth() + Target.X;
+	Distance[Start] = 0.0f;
+	Reached[Start] = Generation;
+	Open.clear();
+	Open.push_back({ 0.0f, Start });
+
+	_PathNeighbor Neighbors[8];
+	while(!Open.empty()) {
+		std::pop_heap(Open.begin(), Open.end(), ComparePathNodes);
+		_PathNode Node = Open.back();
+		Open.pop_back();
+
+		// Skip stale entries
+		if(Node.F > Distance[Node.Index])
+			continue;
+
+		int NeighborCount = Grid.GetNeighbors(Node.Index, Neighbors);
+		for(int i = 0; i < NeighborCount; i++) {
+			float Cost = Node.F + Neighbors[i].Cost;
+			if(Cost > PATH_FLOWFIELDRANGE)
+				continue;
+
+			int Neighbor = Neighbors[i].Index;
+			if(!IsReached(Neighbor) || Cost < Distance[Neighbor]) {
+				Reached[Neighbor] = Generation;
+				Distance[Neighbor] = Cost;
+				Open.push_back({ Cost, Neighbor });
+				std::push_heap(Open.begin(), Open.end(), ComparePathNodes);
+			}
+		}
+	}
+}
+
+// Get the direction toward the neighboring tile closest to the target
+bool _FlowField::GetDirection(const Vector2 &Position, Vector2 &Direction) const {
+	int Width = Grid.GetWidth();
+	int X = (int)Position.X;
+	int Y = (int)Position.Y;
+	if(X < 0 || Y < 0 || X >= Width || Y >= Grid.GetHeight() || !IsReached(Y * Width + X) || (X == Target.X && Y == Target.Y))
+		return false;
+
+	_PathNeighbor Neighbors[8];
+	int NeighborCount = Grid.GetNeighbors(Y * Width + X, Neighbors);
+	int Best = -1;
+	float BestDistance = Distance[Y * Width + X];
+	for(int i = 0; i < NeighborCount; i++) {
+		int Neighbor = Neighbors[i].Index;
+		if(IsReached(Neighbor) && Distance[Neighbor] < BestDistance) {
+			Best = Neighbor;
+			BestDistance = Distance[Neighbor];
+		}
+	}
+
+	if(Best == -1)
+		return false;
+
+	Direction = Vector2(Best % Width + 0.5f, Best / Width + 0.5f) - Position;
+	if(Direction[0] != 0 || Direction[1] != 0)
+		Direction = Direction.UnitVector();
+
+	return true;
+}
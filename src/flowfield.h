@@ -0,0 +1,52 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <pathgrid.h>
+#include <vector2.h>
+#include <coord.h>
+#include <vector>
+
+// Distances from every nearby walkable tile to a target tile
+class _FlowField {
+
+	public:
+
+		_FlowField() : Target(-1, -1), Dirty(false), Generation(0) { }
+
+		void Init(const _Map *Map, int Width, int Height);
+		void SetTarget(const _Coord &Target);
+		void Invalidate() { Dirty = true; }
+		void Update();
+
+		bool GetDirection(const Vector2 &Position, Vector2 &Direction) const;
+
+	private:
+
+		bool IsReached(int Index) const { return Reached[Index] == Generation; }
+
+		_PathGrid Grid;
+		_Coord Target;
+		bool Dirty;
+
+		std::vector<float> Distance;
+		std::vector<uint32_t> Reached;
+		std::vector<_PathNode> Open;
+		uint32_t Generation;
+};
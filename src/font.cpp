@@ -16,238 +16,76 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <font.h>
+#include <glyphatlas.h>
+#include <textcache.h>
 #include <texture.h>
-#include <queue>
-#include <stdexcept>
 #include <graphics.h>
-
-// Get next power of two
-inline unsigned int GetNextPowerOf2(unsigned int Value) {
-	--Value;
-	Value |= Value >> 1;
-	Value |= Value >> 2;
-	Value |= Value >> 4;
-	Value |= Value >> 8;
-	Value |= Value >> 16;
-	return ++Value;
-}
-
-// Struct used when sorting glyphs by height
-struct CharacterSortStruct {
-	FT_UInt Character;
-	int Height;
-};
-
-// Comparison operator for priority queue
-bool operator>(const CharacterSortStruct &A, const CharacterSortStruct &B) {
-	return A.Height < B.Height;
-}
+#include <constants.h>
 
 // Constructor
-_Font::_Font() {
-	Texture = nullptr;
-}
-
-// Load a font file
-_Font::_Font(const std::string &FontFile, int FontSize, int TextureWidth) {
-	Texture = nullptr;
-	HasKerning = false;
-	MaxHeight = 0.0f;
-
-	// Zero out glyphs
-	for(int i = 0; i < 256; i++) {
-		Glyphs[i].Left = 0.0f;
-		Glyphs[i].Top = 0.0f;
-		Glyphs[i].Right = 0.0f;
-		Glyphs[i].Bottom = 0.0f;
-		Glyphs[i].Width = 0.0f;
-		Glyphs[i].Height = 0.0f;
-		Glyphs[i].Advance = 0.0f;
-		Glyphs[i].OffsetX = 0.0f;
-		Glyphs[i].OffsetY = 0.0f;
-	}
-
-	// Initialize library
-	if(FT_Init_FreeType(&Library) != 0) {
-		throw std::runtime_error("Error initializing FreeType");
-	}
-
-	// Load the font
-	if(FT_New_Face(Library, FontFile.c_str(), 0, &Face) != 0) {
-		throw std::runtime_error("Error loading font file: " + FontFile);
-	}
-
-	// Set font size
-	if(FT_Set_Pixel_Sizes(Face, 0, FontSize)) {
-		throw std::runtime_error("Error setting pixel size");
-	}
+_Font::_Font(_GlyphAtlas *Atlas, int FontSize)
+:	Atlas(Atlas),
+	Scale((float)FontSize / FONT_SDFSIZE),
+	MaxHeight(Atlas->GetMaxHeight() * Scale) {
 
-	HasKerning = !!FT_HAS_KERNING(Face);
-	LoadFlags = FT_LOAD_RENDER;
-
-	// Characters to create
-	std::string Characters;
-	for(int i = 32; i < 127; i++)
-		Characters.push_back(char(i));
-
-	// Sort characters by size
-	std::string SortedCharacters;
-	SortCharacters(Face, Characters, SortedCharacters);
-
-	// Create the OpenGL texture and populate GlyphUVs
-	CreateFontTexture(SortedCharacters, TextureWidth);
 }
 
 // Destructor
 _Font::~_Font() {
-
-	// Close face
-	FT_Done_Face(Face);
-
-	// Close freetype
-	FT_Done_FreeType(Library);
-
-	// Free OpenGL texture
-	delete Texture;
+	TextCache.Remove(this);
 }
 
-// Sorts characters by vertical size
-void _Font::SortCharacters(FT_Face &Face, const std::string &Characters, std::string &SortedCharacters) {
-
-	// Build queue
-	std::priority_queue<int, std::vector<CharacterSortStruct>, std::greater<CharacterSortStruct> > CharacterList;
-	CharacterSortStruct Character;
-	for(size_t i = 0; i < Characters.size(); i++) {
-
-		// Load a character
-		FT_Load_Char(Face, Characters[i], LoadFlags);
-		FT_GlyphSlot &Glyph = Face->glyph;
-
-		// Add character to the list
-		Character.Character = Characters[i];
-		Character.Height = Glyph->bitmap.rows;
-		CharacterList.push(Character);
+// Decode the UTF-8 character at Index and move past it
+uint32_t _Font::GetCodepoint(const std::string &Text, size_t &Index) {
+	uint8_t Byte = (uint8_t)Text[Index++];
+	if(Byte < 0x80)
+		return Byte;
+
+	// Get length from the lead byte, treating stray bytes as Latin-1
+	int Length;
+	uint32_t Codepoint;
+	if((Byte & 0xE0) == 0xC0) {
+		Length = 1;
+		Codepoint = Byte & 0x1F;
 	}
-
-	// Build sorted string
-	while(!CharacterList.empty()) {
-		const CharacterSortStruct &Character = CharacterList.top();
-		if(Character.Height > MaxHeight)
-			MaxHeight = Character.Height;
-		SortedCharacters.push_back(Character.Character);
-		CharacterList.pop();
+	else if((Byte & 0xF0) == 0xE0) {
+		Length = 2;
+		Codepoint = Byte & 0x0F;
 	}
-}
-
-// Renders all the glyphs to a texture
-void _Font::CreateFontTexture(std::string SortedCharacters, int TextureWidth) {
-	int X = 0;
-	int Y = 0;
-	int SpacingX = 1;
-	int SpacingY = 1;
-	int MaxRows = 0;
-
-	// Determine Glyph UVs and texture height given a texture width
-	for(size_t i = 0; i < SortedCharacters.size(); i++) {
-
-		// Load a character
-		FT_Load_Char(Face, SortedCharacters[i], LoadFlags);
-
-		// Get glyph
-		FT_GlyphSlot &GlyphSlot = Face->glyph;
-		FT_Bitmap *Bitmap = &GlyphSlot->bitmap;
-
-		// Get width and height of glyph
-		int Width = Bitmap->width + SpacingX;
-		int Rows = Bitmap->rows;
-
-		// Start a new line if no room left
-		if(X + Width > TextureWidth) {
-			X = 0;
-			Y += MaxRows + SpacingY;
-			MaxRows = 0;
-		}
-
-		// Check max values
-		if(Rows > MaxRows)
-			MaxRows = Rows;
-
-		// Add character to list
-		GlyphStruct Glyph;
-		Glyph.Left = (float)X;
-		Glyph.Top = (float)Y;
-		Glyph.Right = (float)X + Bitmap->width;
-		Glyph.Bottom = (float)Y + Bitmap->rows;
-		Glyph.Width = (float)Bitmap->width;
-		Glyph.Height = (float)Bitmap->rows;
-		Glyph.Advance = (float)(GlyphSlot->advance.x >> 6);
-		Glyph.OffsetX = (float)GlyphSlot->bitmap_left;
-		Glyph.OffsetY = (float)GlyphSlot->bitmap_top;
-		Glyphs[(FT_Byte)SortedCharacters[i]] = Glyph;
-
-		// Update draw position
-		X += Width;
+	else if((Byte & 0xF8) == 0xF0) {
+		Length = 3;
+		Codepoint = Byte & 0x07;
 	}
+	else
+		return Byte;
 
-	// Add last line
-	Y += MaxRows;
-
-	// Round to next power of 2
-	int TextureHeight = (int)GetNextPowerOf2(Y);
+	for(int i = 0; i < Length; i++) {
+		if(Index >= Text.size() || ((uint8_t)Text[Index] & 0xC0) != 0x80)
+			return Byte;
 
-	// Create image buffer
-	int TextureSize = TextureWidth * TextureHeight;
-	unsigned char *Image = new unsigned char[TextureSize];
-	memset(Image, 0, TextureSize);
-
-	// Render each glyph to the texture
-	for(size_t i = 0; i < SortedCharacters.size(); i++) {
-		GlyphStruct &Glyph = Glyphs[(FT_Byte)SortedCharacters[i]];
-
-		// Load a character
-		FT_Load_Char(Face, SortedCharacters[i], LoadFlags);
-
-		// Get glyph
-		FT_GlyphSlot &GlyphSlot = Face->glyph;
-		FT_Bitmap *Bitmap = &GlyphSlot->bitmap;
-
-		// Write character bitmap data
-		for(FT_UInt y = 0; y < Bitmap->rows; y++) {
-
-			int DrawY = (int)Glyph.Top + y;
-			for(FT_UInt x = 0; x < Bitmap->width; x++) {
-				int DrawX = (int)Glyph.Left + x;
-				int Destination = DrawX + DrawY * TextureWidth;
-				int Source = x + y * Bitmap->pitch;
-
-				// Copy to texture
-				Image[Destination] = Bitmap->buffer[Source];
-			}
-		}
-
-		// Convert Glyph bounding box to UV coords
-		Glyph.Left /= (float)TextureWidth;
-		Glyph.Top /= (float)TextureHeight;
-		Glyph.Right /= (float)TextureWidth;
-		Glyph.Bottom /= (float)TextureHeight;
+		Codepoint = (Codepoint << 6) | ((uint8_t)Text[Index++] & 0x3F);
 	}
 
-	// Load texture
-	Texture = new _Texture(Image, TextureWidth, TextureHeight, GL_ALPHA8, GL_ALPHA);
-
-	delete[] Image;
+	return Codepoint;
 }
 
-// Draws a string
+// Draws a string, laying it out only when it isn't cached
 void _Font::DrawText(const std::string &Text, float X, float Y, const _Color &Color, const _Alignment &Alignment) const {
-	Graphics.SetTextureEnabled(true);
-	Graphics.SetColor(Color);
-	Graphics.SetTextureID(Texture->GetID());
+	int AlignmentKey = Alignment.Horizontal | (Alignment.Vertical << 8);
+	const _TextLayout *Layout = TextCache.Find(this, Text, AlignmentKey, 0.0f);
+	if(!Layout) {
+		_TextLayout &NewLayout = TextCache.Insert(this, Text, AlignmentKey, 0.0f);
+		LayoutText(Text, Alignment, NewLayout.Vertices);
+		Layout = &NewLayout;
+	}
+
+	Graphics.SubmitVertices(Atlas->GetTexture()->GetID(), Layout->Vertices, X, Y, Color, true);
+}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+// Build white glyph quads for a string drawn at the origin
+void _Font::LayoutText(const std::string &Text, const _Alignment &Alignment, std::vector<_StreamVertex> &Vertices) const {
+	float X = 0.0f;
+	float Y = 0.0f;
 
 	// Adjust for alignment
 	_TextBounds TextBounds;
@@ -276,77 +114,38 @@ void _Font::DrawText(const std::string &Text, float X, float Y, const _Color &Co
 		break;
 	}
 
-	// Draw string
-	float DrawX, DrawY;
-	FT_UInt PreviousGlyphIndex = 0;
-	for(size_t i = 0; i < Text.size(); i++) {
-		FT_UInt GlyphIndex = FT_Get_Char_Index(Face, Text[i]);
+	// Quads cover the distance field padding around each glyph
+	float Padding = FONT_SDFSPREAD * Scale;
+
+	// Build quads
+	Vertices.clear();
+	Vertices.reserve(Text.size() * 6);
+	uint32_t Previous = 0;
+	for(size_t i = 0; i < Text.size(); ) {
+		uint32_t Codepoint = GetCodepoint(Text, i);
 
 		// Handle kerning
-		if(HasKerning && i) {
-			FT_Vector Delta;
-			FT_Get_Kerning(Face, PreviousGlyphIndex, GlyphIndex, FT_KERNING_DEFAULT, &Delta);
-			X += (float)(Delta.x >> 6);
-		}
-		PreviousGlyphIndex = GlyphIndex;
+		X += Atlas->GetKerning(Previous, Codepoint) * Scale;
+		Previous = Codepoint;
 
 		// Get glyph data
-		const GlyphStruct &Glyph = Glyphs[(FT_Byte)Text[i]];
-		DrawX = X + Glyph.OffsetX;
-		DrawY = Y - Glyph.OffsetY;
-
-		glBegin(GL_QUADS);
-
-			// Top left
-			glTexCoord2f(Glyph.Left, Glyph.Top);
-			glVertex2f(DrawX, DrawY);
-
-			// Top right
-			glTexCoord2f(Glyph.Right, Glyph.Top);
-			glVertex2f(DrawX + Glyph.Width, DrawY);
+		const _Glyph &Glyph = Atlas->GetGlyph(Codepoint);
+		if(Glyph.Width > 0.0f) {
+			float DrawX = X + Glyph.OffsetX * Scale - Padding;
+			float DrawY = Y - Glyph.OffsetY * Scale - Padding;
 
-			// Bottom right
-			glTexCoord2f(Glyph.Right, Glyph.Bottom);
-			glVertex2f(DrawX + Glyph.Width, DrawY + Glyph.Height);
-
-			// Bottom left
-			glTexCoord2f(Glyph.Left, Glyph.Bottom);
-			glVertex2f(DrawX, DrawY + Glyph.Height);
-
-		glEnd();
+			Vertices.resize(Vertices.size() + 6);
+			Graphics.BuildQuad(&Vertices[Vertices.size() - 6], DrawX, DrawY, DrawX + Glyph.Width * Scale + Padding * 2, DrawY + Glyph.Height * Scale + Padding * 2, Glyph.Left, Glyph.Top, Glyph.Right, Glyph.Bottom, COLOR_WHITE);
+		}
 
-		X += Glyph.Advance;
+		X += Glyph.Advance * Scale;
 	}
 }
 
 // Draws the font texture
 void _Font::DrawFont(float X, float Y) {
-	Graphics.SetTextureEnabled(true);
-	Graphics.SetTextureID(Texture->GetID());
-	Graphics.SetColor(COLOR_WHITE);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-
-	glBegin(GL_QUADS);
-
-		// Top left
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2f(X, Y);
-
-		// Top right
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2f(X + Texture->GetWidth(), Y);
-
-		// Bottom right
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2f(X + Texture->GetWidth(), Y + Texture->GetHeight());
-
-		// Bottom left
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2f(X, Y + Texture->GetHeight());
-
-	glEnd();
+	const _Texture *Texture = Atlas->GetTexture();
+	Graphics.SubmitQuad(Texture->GetID(), X, Y, X + Texture->GetWidth(), Y + Texture->GetHeight(), 0.0f, 0.0f, 1.0f, 1.0f, COLOR_WHITE);
 }
 
 // Get width and height of a string
@@ -359,75 +158,86 @@ void _Font::GetStringDimensions(const std::string &Text, _TextBounds &TestBounds
 	}
 
 	TestBounds.Width = TestBounds.AboveBase = TestBounds.BelowBase = 0;
-	const GlyphStruct *Glyph = nullptr;
-	for(size_t i = 0; i < Text.size(); i++) {
+	const _Glyph *Glyph = nullptr;
+	for(size_t i = 0; i < Text.size(); ) {
 
 		// Get glyph data
-		Glyph = &Glyphs[(FT_Byte)Text[i]];
+		Glyph = &Atlas->GetGlyph(GetCodepoint(Text, i));
 
 		// Update width by advance
-		TestBounds.Width += (int)Glyph->Advance;
+		TestBounds.Width += (int)(Glyph->Advance * Scale);
 
 		// Get number of pixels below baseline
-		int BelowBase = (int)(-Glyph->OffsetY + Glyph->Height);
+		int BelowBase = (int)((-Glyph->OffsetY + Glyph->Height) * Scale);
 		if(BelowBase > TestBounds.BelowBase)
 			TestBounds.BelowBase = BelowBase;
 
 		// Get number of pixels above baseline
-		if(Glyph->OffsetY > (int)TestBounds.AboveBase)
-			TestBounds.AboveBase = (int)Glyph->OffsetY;
+		if((int)(Glyph->OffsetY * Scale) > TestBounds.AboveBase)
+			TestBounds.AboveBase = (int)(Glyph->OffsetY * Scale);
 	}
 
 	// Fix last char since it should be using width
 	if(Glyph) {
-		TestBounds.Width -= (int)Glyph->Advance;
-		TestBounds.Width += (int)(Glyph->Width + Glyph->OffsetX);
+		TestBounds.Width -= (int)(Glyph->Advance * Scale);
+		TestBounds.Width += (int)((Glyph->Width + Glyph->OffsetX) * Scale);
 	}
 }
 
 // Break up text into multiple strings based on max width
 void _Font::BreakupString(const std::string &Text, float Width, std::vector<std::string> &Strings) const {
+	const _TextLayout *Layout = TextCache.Find(this, Text, TEXTLAYOUT_WRAPPED, Width);
+	if(!Layout) {
+		_TextLayout &NewLayout = TextCache.Insert(this, Text, TEXTLAYOUT_WRAPPED, Width);
+		WrapText(Text, Width, NewLayout.Lines);
+		Layout = &NewLayout;
+	}
+
+	Strings.insert(Strings.end(), Layout->Lines.begin(), Layout->Lines.end());
+}
+
+// Split text into lines no wider than Width
+void _Font::WrapText(const std::string &Text, float Width, std::vector<std::string> &Strings) const {
 
 	float X = 0;
-	FT_UInt PreviousGlyphIndex = 0;
+	uint32_t Previous = 0;
 	size_t StartCut = 0;
 	size_t LastSpace = std::string::npos;
-	for(size_t i = 0; i < Text.size(); i++) {
+	for(size_t i = 0; i < Text.size(); ) {
+		size_t Start = i;
+		uint32_t Codepoint = GetCodepoint(Text, i);
 
 		// Remember last space position
-		if(Text[i] == ' ')
-			LastSpace = i;
-
-		FT_UInt GlyphIndex = FT_Get_Char_Index(Face, Text[i]);
+		if(Codepoint == ' ')
+			LastSpace = Start;
 
 		// Handle kerning
-		if(HasKerning && i) {
-			FT_Vector Delta;
-			FT_Get_Kerning(Face, PreviousGlyphIndex, GlyphIndex, FT_KERNING_DEFAULT, &Delta);
-			X += (float)(Delta.x >> 6);
-		}
-		PreviousGlyphIndex = GlyphIndex;
+		X += Atlas->GetKerning(Previous, Codepoint) * Scale;
+		Previous = Codepoint;
 
 		// Get glyph info
-		const GlyphStruct &Glyph = Glyphs[(FT_Byte)Text[i]];
-		X += Glyph.Advance;
+		X += Atlas->GetGlyph(Codepoint).Advance * Scale;
 
 		// Check for max width
 		if(X > Width) {
 			size_t Adjust = 0;
 			if(LastSpace == std::string::npos)
-				LastSpace = i;
+				LastSpace = Start;
 			else
 				Adjust = 1;
 
 			// Add to list of strings
 			Strings.push_back(Text.substr(StartCut, LastSpace - StartCut));
 			StartCut = LastSpace+Adjust;
-			LastSpace = -1;
+			LastSpace = std::string::npos;
 			i = StartCut;
 
+			// Skip the character after the cut, keeping multi-byte characters whole
+			if(i < Text.size())
+				GetCodepoint(Text, i);
+
 			X = 0;
-			PreviousGlyphIndex = 0;
+			Previous = 0;
 		}
 
 	}
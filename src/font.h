@@ -22,19 +22,12 @@
 #include <ui/ui.h>
 #include <string>
 #include <vector>
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include <stdint.h>
 #undef DrawText
 
 // Forward Declarations
-class _Texture;
-
-// Contains glyph info
-struct GlyphStruct {
-	float Left, Top, Right, Bottom;
-	float Width, Height;
-	float Advance, OffsetX, OffsetY;
-};
+class _GlyphAtlas;
+struct _StreamVertex;
 
 struct _TextBounds {
 	int Width;
@@ -47,8 +40,7 @@ class _Font {
 
 	public:
 
-		_Font();
-		_Font(const std::string &FontFile, int FontSize=12, int TextureWidth=256);
+		_Font(_GlyphAtlas *Atlas, int FontSize=12);
 		~_Font();
 
 		void DrawText(const std::string &Text, float X, float Y, const _Color &Color=COLOR_WHITE, const _Alignment &Alignment=LEFT_BASELINE) const;
@@ -57,21 +49,15 @@ class _Font {
 		void BreakupString(const std::string &Text, float Width, std::vector<std::string> &Strings) const;
 		float GetMaxHeight() const { return MaxHeight; }
 
+		static uint32_t GetCodepoint(const std::string &Text, size_t &Index);
+
 	private:
 
-		void CreateFontTexture(std::string SortedCharacters, int TextureWidth);
-		void SortCharacters(FT_Face &Face, const std::string &Characters, std::string &SortedCharacters);
+		void LayoutText(const std::string &Text, const _Alignment &Alignment, std::vector<_StreamVertex> &Vertices) const;
+		void WrapText(const std::string &Text, float Width, std::vector<std::string> &Strings) const;
 
-		// Glyphs
-		GlyphStruct Glyphs[256];
+		// Shared distance field glyphs, scaled to this size
+		_GlyphAtlas *Atlas;
+		float Scale;
 		float MaxHeight;
-
-		// Texture
-		_Texture *Texture;
-
-		// Freetype
-		bool HasKerning;
-		FT_Library Library;
-		FT_Face Face;
-		FT_Int32 LoadFlags;
 };
@@ -25,9 +25,13 @@
 #include <framelimit.h>
 #include <random.h>
 #include <stdexcept>
+#include <algorithm>
 #include <constants.h>
 #include <assets.h>
 #include <save.h>
+#include <profiler.h>
+#include <jobs.h>
+#include <textcache.h>
 #include <states/null.h>
 #include <states/convert.h>
 #include <states/play.h>
@@ -41,7 +45,11 @@ _Framework Framework;
 void _Framework::Init(int ArgumentCount, char **Arguments) {
 	RequestedState = nullptr;
 	Done = false;
+	Headless = false;
+	ProfilerDump = false;
 	TimeStepAccumulator = 0.0;
+	TickCount = 0;
+	TickLimit = 0;
 	TimeStep = GAME_TIMESTEP;
 	FrameworkState = INIT;
 	std::string ModPath = "./";
@@ -53,6 +61,7 @@ void _Framework::Init(int ArgumentCount, char **Arguments) {
 	int ScreenHeight = Config.WindowHeight;
 	int MSAA = Config.MSAA;
 	int Vsync = Config.Vsync;
+	int GraphicsBackend = Config.GraphicsBackend;
 
 	// Process arguments
 	std::string Token;
@@ -79,6 +88,9 @@ void _Framework::Init(int ArgumentCount, char **Arguments) {
 		else if(Token == "-msaa" && TokensRemaining > 0) {
 			MSAA = atoi(Arguments[++i]);
 		}
+		else if(Token == "-legacygl") {
+			GraphicsBackend = GRAPHICS_LEGACY;
+		}
 		else if(Token == "-editor") {
 			State = &EditorState;
 			if(TokensRemaining && Arguments[i+1][0] != '-')
@@ -97,6 +109,15 @@ void _Framework::Init(int ArgumentCount, char **Arguments) {
 		else if(Token == "-noaudio") {
 			AudioEnabled = false;
 		}
+		else if(Token == "-headless") {
+			Headless = true;
+		}
+		else if(Token == "-profile") {
+			ProfilerDump = true;
+		}
+		else if(Token == "-ticks" && TokensRemaining > 0) {
+			TickLimit = strtoull(Arguments[++i], nullptr, 10);
+		}
 		else if(Token == "-mod" && TokensRemaining > 0) {
 			ModPath = Arguments[++i];
 			if(ModPath.substr(ModPath.size()-1, 1) != "/")
@@ -104,13 +125,20 @@ void _Framework::Init(int ArgumentCount, char **Arguments) {
 		}
 	}
 
+	// Run without a window or audio device
+	if(Headless)
+		AudioEnabled = false;
+
 	// Initialize SDL
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
+	if(SDL_Init(Headless ? SDL_INIT_TIMER : SDL_INIT_VIDEO) < 0) {
 		throw std::runtime_error("Failed to initialize SDL");
 	}
 
 	// Set up subsystems
-	Graphics.Init(ScreenWidth, ScreenHeight, Vsync, MSAA, Fullscreen);
+	if(Headless)
+		Graphics.InitHeadless(ScreenWidth, ScreenHeight);
+	else
+		Graphics.Init(ScreenWidth, ScreenHeight, Vsync, MSAA, Fullscreen, GraphicsBackend);
 	Audio.Init(AudioEnabled);
 	Audio.SetGain(Config.SoundVolume);
 
@@ -122,6 +150,14 @@ void _Framework::Init(int ArgumentCount, char **Arguments) {
 	Assets.Init(ModPath);
 	Actions.LoadActionNames();
 	Save.LoadSaves();
+
+	Profiler.Init(PROFILER_FRAMES);
+
+	// Start workers, leaving a core for the main thread unless overridden
+	int WorkerThreads = Config.WorkerThreads;
+	if(WorkerThreads < 0)
+		WorkerThreads = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+	JobSystem.Init(WorkerThreads);
 }
 
 // Shutdown
@@ -131,6 +167,12 @@ void _Framework::Close() {
 	if(State)
 		State->Close();
 
+	JobSystem.Close();
+
+	if(ProfilerDump)
+		Profiler.Dump(Config.GetConfigPath() + PROFILER_DUMPNAME);
+	Profiler.Close();
+
 	Assets.Close();
 	delete FrameLimit;
 
@@ -141,11 +183,21 @@ void _Framework::Close() {
 
 // Update input
 void _Framework::Update() {
+	Profiler.BeginFrame();
+	JobSystem.UpdateStats();
+	TextCache.UpdateStats();
+	_ProfilerScope Zone("Framework::Update");
 
 	// Get frame time
 	double FrameTime = (SDL_GetPerformanceCounter() - Timer) / (double)SDL_GetPerformanceFrequency();
 	Timer = SDL_GetPerformanceCounter();
 
+	// Step the simulation as fast as possible
+	if(Headless) {
+		UpdateHeadless();
+		return;
+	}
+
 	// Get events from SDL
 	SDL_PumpEvents();
 	Input.Update(FrameTime);
@@ -167,6 +219,12 @@ void _Framework::Update() {
 					if(Event.type == SDL_KEYDOWN && (Event.key.keysym.mod & KMOD_ALT) && Event.key.keysym.scancode == SDL_SCANCODE_RETURN) {
 						//Graphics.ToggleFullScreen();
 					}
+
+					// Profiler overlay and export
+					if(Event.type == SDL_KEYDOWN && Event.key.keysym.scancode == SDL_SCANCODE_F10)
+						Profiler.ToggleOverlay();
+					else if(Event.type == SDL_KEYDOWN && Event.key.keysym.scancode == SDL_SCANCODE_F11)
+						Profiler.Dump(Config.GetConfigPath() + PROFILER_DUMPNAME);
 				}
 				else {
 					if(State && FrameworkState == UPDATE && Event.key.keysym.scancode == SDL_SCANCODE_BACKSPACE) {
@@ -211,8 +269,11 @@ void _Framework::Update() {
 			while(TimeStepAccumulator >= TimeStep) {
 				State->Update(TimeStep);
 				TimeStepAccumulator -= TimeStep;
+				TickCount++;
 			}
+			JobSystem.RunMainThreadJobs();
 			State->Render(TimeStepAccumulator / TimeStep);
+			Profiler.Render();
 			//printf("%f\n", TimeStepAccumulator);
 		} break;
 		case CLOSE: {
@@ -225,11 +286,43 @@ void _Framework::Update() {
 	}
 
 	Audio.Update(FrameTime);
-	Graphics.Flip(FrameTime);
+	{
+		_ProfilerScope FlipZone("Graphics::Flip");
+		Graphics.Flip(FrameTime);
+	}
 	if(!Config.Vsync)
 		FrameLimit->Update();
 }
 
+// Run one fixed timestep without input, rendering or frame limiting
+void _Framework::UpdateHeadless() {
+
+	switch(FrameworkState) {
+		case INIT: {
+			if(State) {
+				State->Init();
+				FrameworkState = UPDATE;
+			}
+			else
+				Done = true;
+		} break;
+		case UPDATE: {
+			State->Update(TimeStep);
+			JobSystem.RunMainThreadJobs();
+			TickCount++;
+			if(TickLimit && TickCount >= TickLimit)
+				Done = true;
+		} break;
+		case CLOSE: {
+			if(State)
+				State->Close();
+
+			State = RequestedState;
+			FrameworkState = INIT;
+		} break;
+	}
+}
+
 // Change states
 void _Framework::ChangeState(_State *RequestedState) {
 	this->RequestedState = RequestedState;
@@ -45,6 +45,8 @@ class _Framework {
 
 		bool GetDone() { return Done; }
 		void SetDone(bool Done) { this->Done = Done; }
+		bool IsHeadless() const { return Headless; }
+		Uint64 GetTickCount() const { return TickCount; }
 
 		_State *GetState() { return State; }
 		void ChangeState(_State *RequestedState);
@@ -54,13 +56,19 @@ class _Framework {
 		// States
 		_State *State, *RequestedState;
 		bool Done;
+		bool Headless;
+		bool ProfilerDump;
 		StateType FrameworkState;
 
+		void UpdateHeadless();
+
 		// Time
 		_FrameLimit *FrameLimit;
 		Uint64 Timer;
 		double TimeStep;
 		double TimeStepAccumulator;
+		Uint64 TickCount;
+		Uint64 TickLimit;
 };
 
 extern _Framework Framework;
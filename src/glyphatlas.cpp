@@ -0,0 +1,417 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <glyphatlas.h>
+#include <graphics.h>
+#include <texture.h>
+#include <constants.h>
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <cmath>
+
+// Printable ASCII, always in the atlas
+const uint32_t GLYPHATLAS_FIRST = 32;
+const uint32_t GLYPHATLAS_LAST = 127;
+const int GLYPHATLAS_PRINTABLE = GLYPHATLAS_LAST - GLYPHATLAS_FIRST;
+
+// Squared distance to the nearest zero along one line, using the lower envelope of parabolas
+static void TransformLine(double *Data, int Count, int Stride, std::vector<double> &Line, std::vector<int> &Hull, std::vector<double> &Bounds) {
+	const double Infinity = 1e20;
+
+	for(int i = 0; i < Count; i++)
+		Line[i] = Data[i * Stride];
+
+	int K = 0;
+	Hull[0] = 0;
+	Bounds[0] = -Infinity;
+	Bounds[1] = Infinity;
+	for(int Q = 1; Q < Count; Q++) {
+		double S;
+		while(true) {
+			int V = Hull[K];
+			S = ((Line[Q] + Q * Q) - (Line[V] + V * V)) / (2.0 * (Q - V));
+			if(S > Bounds[K] || K == 0)
+				break;
+			K--;
+		}
+		K++;
+		Hull[K] = Q;
+		Bounds[K] = S;
+		Bounds[K + 1] = Infinity;
+	}
+
+	K = 0;
+	for(int Q = 0; Q < Count; Q++) {
+		while(Bounds[K + 1] < Q)
+			K++;
+		int V = Hull[K];
+		Data[Q * Stride] = (Q - V) * (Q - V) + Line[V];
+	}
+}
+
+// Squared distance of every pixel to the nearest zero
+static void TransformGrid(std::vector<double> &Grid, int Width, int Height) {
+	int Size = std::max(Width, Height);
+	std::vector<double> Line(Size), Bounds(Size + 1);
+	std::vector<int> Hull(Size);
+	for(int X = 0; X < Width; X++)
+		TransformLine(&Grid[X], Height, Width, Line, Hull, Bounds);
+	for(int Y = 0; Y < Height; Y++)
+		TransformLine(&Grid[Y * Width], Width, 1, Line, Hull, Bounds);
+}
+
+// Write the signed distance of each padded pixel to the glyph edge, mapped so the edge is at 0.5
+static void BuildDistanceField(const FT_Bitmap &Bitmap, uint8_t *Output, int OutputPitch) {
+	const double Infinity = 1e20;
+	int Width = (int)Bitmap.width + FONT_SDFSPREAD * 2;
+	int Height = (int)Bitmap.rows + FONT_SDFSPREAD * 2;
+
+	// Distances to the nearest pixel outside and inside the glyph
+	std::vector<double> Inside(Width * Height), Outside(Width * Height);
+	std::vector<bool> Solid(Width * Height, false);
+	for(int Y = 0; Y < (int)Bitmap.rows; Y++) {
+		for(int X = 0; X < (int)Bitmap.width; X++)
+			Solid[(Y + FONT_SDFSPREAD) * Width + X + FONT_SDFSPREAD] = Bitmap.buffer[Y * Bitmap.pitch + X] >= 128;
+	}
+	for(int i = 0; i < Width * Height; i++) {
+		Inside[i] = Solid[i] ? Infinity : 0.0;
+		Outside[i] = Solid[i] ? 0.0 : Infinity;
+	}
+	TransformGrid(Inside, Width, Height);
+	TransformGrid(Outside, Width, Height);
+
+	for(int Y = 0; Y < Height; Y++) {
+		for(int X = 0; X < Width; X++) {
+			int Index = Y * Width + X;
+			double Distance = Solid[Index] ? std::sqrt(Inside[Index]) - 0.5 : 0.5 - std::sqrt(Outside[Index]);
+			Output[Y * OutputPitch + X] = GetColorByte((float)(0.5 + Distance / (FONT_SDFSPREAD * 2)));
+		}
+	}
+}
+
+// Hash a file's contents
+static uint64_t GetFileHash(const std::string &Path) {
+	std::ifstream File(Path.c_str(), std::ios::in | std::ios::binary);
+	if(!File)
+		throw std::runtime_error("Error loading font file: " + Path);
+
+	uint64_t Hash = 14695981039346656037ULL;
+	char Buffer[4096];
+	while(File.read(Buffer, sizeof(Buffer)) || File.gcount()) {
+		for(std::streamsize i = 0; i < File.gcount(); i++) {
+			Hash ^= (uint8_t)Buffer[i];
+			Hash *= 1099511628211ULL;
+		}
+	}
+
+	return Hash;
+}
+
+// Load the atlas from its cache, generating and saving it when missing or stale
+_GlyphAtlas::_GlyphAtlas(const std::string &FontFile, const std::string &CacheFile)
+:	FontFile(FontFile),
+	EmptyGlyph(),
+	HasKerning(false),
+	MaxHeight(0.0f),
+	PackX(0),
+	PackY(0),
+	ShelfHeight(0),
+	Texture(nullptr),
+	Library(nullptr),
+	Face(nullptr),
+	FaceOpen(false) {
+
+	uint64_t SourceHash = GetFileHash(FontFile);
+	if(!LoadCache(CacheFile, SourceHash)) {
+		Image.assign(FONT_ATLASSIZE * FONT_ATLASSIZE, 0);
+		OpenFace();
+
+		for(uint32_t Codepoint = GLYPHATLAS_FIRST; Codepoint < GLYPHATLAS_LAST; Codepoint++) {
+			if(!AddGlyph(Codepoint))
+				throw std::runtime_error("Glyph atlas is too small for " + FontFile);
+
+			MaxHeight = std::max(MaxHeight, Glyphs[Codepoint].Height);
+		}
+
+		// Kerning between printable characters
+		HasKerning = !!FT_HAS_KERNING(Face);
+		if(HasKerning) {
+			Kerning.resize(GLYPHATLAS_PRINTABLE * GLYPHATLAS_PRINTABLE);
+			for(int First = 0; First < GLYPHATLAS_PRINTABLE; First++) {
+				FT_UInt FirstIndex = FT_Get_Char_Index(Face, First + GLYPHATLAS_FIRST);
+				for(int Second = 0; Second < GLYPHATLAS_PRINTABLE; Second++) {
+					FT_Vector Delta;
+					FT_Get_Kerning(Face, FirstIndex, FT_Get_Char_Index(Face, Second + GLYPHATLAS_FIRST), FT_KERNING_UNFITTED, &Delta);
+					Kerning[First * GLYPHATLAS_PRINTABLE + Second] = Delta.x / 64.0f;
+				}
+			}
+		}
+
+		SaveCache(CacheFile, SourceHash);
+	}
+
+	// Control characters take no space
+	for(uint32_t i = 0; i < 128; i++) {
+		if(i >= GLYPHATLAS_FIRST && i < GLYPHATLAS_LAST)
+			AsciiGlyphs[i] = &Glyphs[i];
+		else
+			AsciiGlyphs[i] = &EmptyGlyph;
+	}
+
+	CreateTexture();
+}
+
+// Destructor
+_GlyphAtlas::~_GlyphAtlas() {
+	if(FaceOpen) {
+		FT_Done_Face(Face);
+		FT_Done_FreeType(Library);
+	}
+
+	delete Texture;
+}
+
+// Get a glyph, adding characters outside ASCII on first use
+const _Glyph &_GlyphAtlas::GetGlyph(uint32_t Codepoint) {
+	if(Codepoint < 128)
+		return *AsciiGlyphs[Codepoint];
+
+	auto Iterator = Glyphs.find(Codepoint);
+	if(Iterator != Glyphs.end())
+		return Iterator->second;
+
+	// Draw characters the font lacks, or that don't fit, as the missing glyph
+	if(!AddGlyph(Codepoint)) {
+		_Glyph Missing = *AsciiGlyphs[(int)'?'];
+		Glyphs[Codepoint] = Missing;
+	}
+
+	return Glyphs[Codepoint];
+}
+
+// Get the pen adjustment between two characters
+float _GlyphAtlas::GetKerning(uint32_t Previous, uint32_t Codepoint) {
+	if(!HasKerning || !Previous)
+		return 0.0f;
+
+	if(Previous >= GLYPHATLAS_FIRST && Previous < GLYPHATLAS_LAST && Codepoint >= GLYPHATLAS_FIRST && Codepoint < GLYPHATLAS_LAST)
+		return Kerning[(Previous - GLYPHATLAS_FIRST) * GLYPHATLAS_PRINTABLE + Codepoint - GLYPHATLAS_FIRST];
+
+	OpenFace();
+	FT_Vector Delta;
+	FT_Get_Kerning(Face, FT_Get_Char_Index(Face, Previous), FT_Get_Char_Index(Face, Codepoint), FT_KERNING_UNFITTED, &Delta);
+
+	return Delta.x / 64.0f;
+}
+
+// Read glyphs, kerning and the distance field image written by SaveCache
+bool _GlyphAtlas::LoadCache(const std::string &CacheFile, uint64_t SourceHash) {
+	std::ifstream File(CacheFile.c_str(), std::ios::in | std::ios::binary);
+	if(!File)
+		return false;
+
+	// Check that the cache matches the font and generation settings
+	int32_t Header[5];
+	uint64_t Hash;
+	File.read((char *)Header, sizeof(Header));
+	File.read((char *)&Hash, sizeof(Hash));
+	if(!File || Header[0] != FONT_CACHEVERSION || Header[1] != FONT_SDFSIZE || Header[2] != FONT_SDFSPREAD || Header[3] != FONT_ATLASSIZE || Hash != SourceHash)
+		return false;
+	HasKerning = Header[4] != 0;
+
+	int32_t Packing[3], GlyphCount;
+	File.read((char *)Packing, sizeof(Packing));
+	File.read((char *)&MaxHeight, sizeof(MaxHeight));
+	File.read((char *)&GlyphCount, sizeof(GlyphCount));
+	if(!File || GlyphCount < GLYPHATLAS_PRINTABLE)
+		return false;
+	PackX = Packing[0];
+	PackY = Packing[1];
+	ShelfHeight = Packing[2];
+
+	for(int i = 0; i < GlyphCount; i++) {
+		uint32_t Codepoint;
+		_Glyph Glyph;
+		File.read((char *)&Codepoint, sizeof(Codepoint));
+		File.read((char *)&Glyph, sizeof(Glyph));
+		Glyphs[Codepoint] = Glyph;
+	}
+
+	if(HasKerning) {
+		Kerning.resize(GLYPHATLAS_PRINTABLE * GLYPHATLAS_PRINTABLE);
+		File.read((char *)Kerning.data(), Kerning.size() * sizeof(float));
+	}
+
+	Image.resize(FONT_ATLASSIZE * FONT_ATLASSIZE);
+	File.read((char *)Image.data(), Image.size());
+	if(!File) {
+		Glyphs.clear();
+		Kerning.clear();
+		return false;
+	}
+
+	// Every printable character must be present
+	for(uint32_t Codepoint = GLYPHATLAS_FIRST; Codepoint < GLYPHATLAS_LAST; Codepoint++) {
+		if(Glyphs.find(Codepoint) == Glyphs.end()) {
+			Glyphs.clear();
+			Kerning.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Write the atlas so later runs skip rasterizing
+void _GlyphAtlas::SaveCache(const std::string &CacheFile, uint64_t SourceHash) const {
+	std::ofstream File(CacheFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!File)
+		return;
+
+	int32_t Header[5] = { FONT_CACHEVERSION, FONT_SDFSIZE, FONT_SDFSPREAD, FONT_ATLASSIZE, HasKerning };
+	int32_t Packing[3] = { PackX, PackY, ShelfHeight };
+	int32_t GlyphCount = (int32_t)Glyphs.size();
+	File.write((const char *)Header, sizeof(Header));
+	File.write((const char *)&SourceHash, sizeof(SourceHash));
+	File.write((const char *)Packing, sizeof(Packing));
+	File.write((const char *)&MaxHeight, sizeof(MaxHeight));
+	File.write((const char *)&GlyphCount, sizeof(GlyphCount));
+	for(const auto &Glyph : Glyphs) {
+		File.write((const char *)&Glyph.first, sizeof(Glyph.first));
+		File.write((const char *)&Glyph.second, sizeof(Glyph.second));
+	}
+	if(HasKerning)
+		File.write((const char *)Kerning.data(), Kerning.size() * sizeof(float));
+	File.write((const char *)Image.data(), Image.size());
+}
+
+// Open the font for rasterizing at the atlas size
+void _GlyphAtlas::OpenFace() {
+	if(FaceOpen)
+		return;
+
+	if(FT_Init_FreeType(&Library) != 0)
+		throw std::runtime_error("Error initializing FreeType");
+
+	if(FT_New_Face(Library, FontFile.c_str(), 0, &Face) != 0) {
+		FT_Done_FreeType(Library);
+		throw std::runtime_error("Error loading font file: " + FontFile);
+	}
+
+	if(FT_Set_Pixel_Sizes(Face, 0, FONT_SDFSIZE)) {
+		FT_Done_Face(Face);
+		FT_Done_FreeType(Library);
+		throw std::runtime_error("Error setting pixel size");
+	}
+
+	FaceOpen = true;
+}
+
+// Rasterize a character and add its distance field to the atlas
+bool _GlyphAtlas::AddGlyph(uint32_t Codepoint) {
+	OpenFace();
+
+	FT_UInt Index = FT_Get_Char_Index(Face, Codepoint);
+	if(!Index || FT_Load_Glyph(Face, Index, FT_LOAD_RENDER | FT_LOAD_NO_HINTING) != 0)
+		return false;
+
+	FT_GlyphSlot GlyphSlot = Face->glyph;
+	const FT_Bitmap &Bitmap = GlyphSlot->bitmap;
+
+	_Glyph Glyph = _Glyph();
+	Glyph.Width = (float)Bitmap.width;
+	Glyph.Height = (float)Bitmap.rows;
+	Glyph.Advance = GlyphSlot->advance.x / 64.0f;
+	Glyph.OffsetX = (float)GlyphSlot->bitmap_left;
+	Glyph.OffsetY = (float)GlyphSlot->bitmap_top;
+
+	// Blank characters like space only advance
+	if(Bitmap.width && Bitmap.rows) {
+		int Width = (int)Bitmap.width + FONT_SDFSPREAD * 2;
+		int Height = (int)Bitmap.rows + FONT_SDFSPREAD * 2;
+		int X, Y;
+		if(!Pack(Width, Height, X, Y))
+			return false;
+
+		BuildDistanceField(Bitmap, &Image[Y * FONT_ATLASSIZE + X], FONT_ATLASSIZE);
+		Glyph.Left = X / (float)FONT_ATLASSIZE;
+		Glyph.Top = Y / (float)FONT_ATLASSIZE;
+		Glyph.Right = (X + Width) / (float)FONT_ATLASSIZE;
+		Glyph.Bottom = (Y + Height) / (float)FONT_ATLASSIZE;
+		UpdateTexture(X, Y, Width, Height);
+	}
+
+	Glyphs[Codepoint] = Glyph;
+
+	return true;
+}
+
+// Find room for a glyph on the current shelf or a new one below it
+bool _GlyphAtlas::Pack(int Width, int Height, int &X, int &Y) {
+	if(PackX + Width > FONT_ATLASSIZE) {
+		PackX = 0;
+		PackY += ShelfHeight + 1;
+		ShelfHeight = 0;
+	}
+	if(Width > FONT_ATLASSIZE || PackY + Height > FONT_ATLASSIZE)
+		return false;
+
+	X = PackX;
+	Y = PackY;
+	PackX += Width + 1;
+	ShelfHeight = std::max(ShelfHeight, Height);
+
+	return true;
+}
+
+// Upload the distance field image
+void _GlyphAtlas::CreateTexture() {
+	if(Graphics.IsCore())
+		Texture = new _Texture(Image.data(), FONT_ATLASSIZE, FONT_ATLASSIZE, GL_R8, GL_RED);
+	else
+		Texture = new _Texture(Image.data(), FONT_ATLASSIZE, FONT_ATLASSIZE, GL_ALPHA8, GL_ALPHA);
+	if(!Texture->GetID())
+		return;
+
+	Graphics.SetTextureID(Texture->GetID());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, Graphics.GetClampMode());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, Graphics.GetClampMode());
+
+	// Core profile has no alpha textures, so read distance from the red channel
+	if(Graphics.IsCore()) {
+		GLint Swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, Swizzle);
+	}
+
+	// Distance fields are filtered to draw at any size
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
+
+// Upload a region of the image after adding a glyph
+void _GlyphAtlas::UpdateTexture(int X, int Y, int Width, int Height) {
+	if(!Texture || !Texture->GetID())
+		return;
+
+	Graphics.SetTextureID(Texture->GetID());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, FONT_ATLASSIZE);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, X, Y, Width, Height, Graphics.IsCore() ? GL_RED : GL_ALPHA, GL_UNSIGNED_BYTE, &Image[Y * FONT_ATLASSIZE + X]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// Forward Declarations
+class _Texture;
+
+// Glyph metrics in pixels at FONT_SDFSIZE, with texture coordinates of the padded distance field
+struct _Glyph {
+	float Left, Top, Right, Bottom;
+	float Width, Height;
+	float Advance, OffsetX, OffsetY;
+};
+
+// Signed distance field glyphs of one typeface, drawn at any size from one texture
+class _GlyphAtlas {
+
+	public:
+
+		_GlyphAtlas(const std::string &FontFile, const std::string &CacheFile);
+		~_GlyphAtlas();
+
+		const _Glyph &GetGlyph(uint32_t Codepoint);
+		float GetKerning(uint32_t Previous, uint32_t Codepoint);
+		float GetMaxHeight() const { return MaxHeight; }
+		const _Texture *GetTexture() const { return Texture; }
+
+	private:
+
+		bool LoadCache(const std::string &CacheFile, uint64_t SourceHash);
+		void SaveCache(const std::string &CacheFile, uint64_t SourceHash) const;
+		void OpenFace();
+		bool AddGlyph(uint32_t Codepoint);
+		bool Pack(int Width, int Height, int &X, int &Y);
+		void CreateTexture();
+		void UpdateTexture(int X, int Y, int Width, int Height);
+
+		// Glyphs, with printable ASCII also indexed directly
+		std::string FontFile;
+		std::unordered_map<uint32_t, _Glyph> Glyphs;
+		const _Glyph *AsciiGlyphs[128];
+		_Glyph EmptyGlyph;
+		std::vector<float> Kerning;
+		bool HasKerning;
+		float MaxHeight;
+
+		// Distance field image and the shelf being filled
+		std::vector<uint8_t> Image;
+		int PackX, PackY, ShelfHeight;
+		_Texture *Texture;
+
+		// Freetype, opened only for glyphs missing from the cache
+		FT_Library Library;
+		FT_Face Face;
+		bool FaceOpen;
+};
@@ -19,6 +19,11 @@
 #include <color.h>
 #include <texture.h>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
 #include <constants.h>
 #include <opengl.h>
 #include <ui/element.h>
@@ -27,16 +32,186 @@
 typedef void (APIENTRYP PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
 typedef void (APIENTRYP PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
 typedef void (APIENTRYP PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void (APIENTRYP PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
 typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
+typedef void (APIENTRYP PFNGLGENFRAMEBUFFERSPROC) (GLsizei n, GLuint *framebuffers);
+typedef void (APIENTRYP PFNGLBINDFRAMEBUFFERPROC) (GLenum target, GLuint framebuffer);
+typedef void (APIENTRYP PFNGLFRAMEBUFFERTEXTURE2DPROC) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRYP PFNGLCHECKFRAMEBUFFERSTATUSPROC) (GLenum target);
+typedef void (APIENTRYP PFNGLDELETEFRAMEBUFFERSPROC) (GLsizei n, const GLuint *framebuffers);
+typedef void (APIENTRYP PFNGLBLENDFUNCSEPARATEPROC) (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
+typedef GLuint (APIENTRYP PFNGLCREATESHADERPROC) (GLenum type);
+typedef void (APIENTRYP PFNGLSHADERSOURCEPROC) (GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+typedef void (APIENTRYP PFNGLCOMPILESHADERPROC) (GLuint shader);
+typedef void (APIENTRYP PFNGLGETSHADERIVPROC) (GLuint shader, GLenum pname, GLint *params);
+typedef void (APIENTRYP PFNGLGETSHADERINFOLOGPROC) (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+typedef void (APIENTRYP PFNGLDELETESHADERPROC) (GLuint shader);
+typedef GLuint (APIENTRYP PFNGLCREATEPROGRAMPROC) (void);
+typedef void (APIENTRYP PFNGLATTACHSHADERPROC) (GLuint program, GLuint shader);
+typedef void (APIENTRYP PFNGLLINKPROGRAMPROC) (GLuint program);
+typedef void (APIENTRYP PFNGLGETPROGRAMIVPROC) (GLuint program, GLenum pname, GLint *params);
+typedef void (APIENTRYP PFNGLGETPROGRAMINFOLOGPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+typedef void (APIENTRYP PFNGLUSEPROGRAMPROC) (GLuint program);
+typedef void (APIENTRYP PFNGLDELETEPROGRAMPROC) (GLuint program);
+typedef GLint (APIENTRYP PFNGLGETUNIFORMLOCATIONPROC) (GLuint program, const GLchar *name);
+typedef void (APIENTRYP PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
+typedef void (APIENTRYP PFNGLUNIFORM4FPROC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+typedef void (APIENTRYP PFNGLUNIFORMMATRIX4FVPROC) (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+typedef GLuint (APIENTRYP PFNGLGETUNIFORMBLOCKINDEXPROC) (GLuint program, const GLchar *uniformBlockName);
+typedef void (APIENTRYP PFNGLUNIFORMBLOCKBINDINGPROC) (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+typedef void (APIENTRYP PFNGLBINDBUFFERBASEPROC) (GLenum target, GLuint index, GLuint buffer);
+typedef void (APIENTRYP PFNGLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
+typedef void (APIENTRYP PFNGLBINDVERTEXARRAYPROC) (GLuint array);
+typedef void (APIENTRYP PFNGLDELETEVERTEXARRAYSPROC) (GLsizei n, const GLuint *arrays);
+typedef void (APIENTRYP PFNGLENABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+typedef void (APIENTRYP PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+typedef void (APIENTRYP PFNGLVERTEXATTRIB4FPROC) (GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void *(APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+typedef const GLubyte *(APIENTRYP PFNGLGETSTRINGIPROC) (GLenum name, GLuint index);
+typedef void (APIENTRYP PFNGLGENERATEMIPMAPPROC) (GLenum target);
+typedef void (APIENTRYP PFNGLACTIVETEXTUREPROC) (GLenum texture);
 PFNGLGENBUFFERSPROC glGenBuffers;
 PFNGLBINDBUFFERPROC glBindBuffer;
 PFNGLBUFFERDATAPROC glBufferData;
+PFNGLBUFFERSUBDATAPROC glBufferSubData;
 PFNGLDELETEBUFFERSPROC glDeleteBuffers;
+PFNGLGENFRAMEBUFFERSPROC glGenFramebuffers;
+PFNGLBINDFRAMEBUFFERPROC glBindFramebuffer;
+PFNGLFRAMEBUFFERTEXTURE2DPROC glFramebufferTexture2D;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC glCheckFramebufferStatus;
+PFNGLDELETEFRAMEBUFFERSPROC glDeleteFramebuffers;
+PFNGLBLENDFUNCSEPARATEPROC glBlendFuncSeparate;
+PFNGLCREATESHADERPROC glCreateShader;
+PFNGLSHADERSOURCEPROC glShaderSource;
+PFNGLCOMPILESHADERPROC glCompileShader;
+PFNGLGETSHADERIVPROC glGetShaderiv;
+PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog;
+PFNGLDELETESHADERPROC glDeleteShader;
+PFNGLCREATEPROGRAMPROC glCreateProgram;
+PFNGLATTACHSHADERPROC glAttachShader;
+PFNGLLINKPROGRAMPROC glLinkProgram;
+PFNGLGETPROGRAMIVPROC glGetProgramiv;
+PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
+PFNGLUSEPROGRAMPROC glUseProgram;
+PFNGLDELETEPROGRAMPROC glDeleteProgram;
+PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
+PFNGLUNIFORM1IPROC glUniform1i;
+PFNGLUNIFORM4FPROC glUniform4f;
+PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
+PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndex;
+PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBinding;
+PFNGLBINDBUFFERBASEPROC glBindBufferBase;
+PFNGLGENVERTEXARRAYSPROC glGenVertexArrays;
+PFNGLBINDVERTEXARRAYPROC glBindVertexArray;
+PFNGLDELETEVERTEXARRAYSPROC glDeleteVertexArrays;
+PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArray;
+PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer;
+PFNGLVERTEXATTRIB4FPROC glVertexAttrib4f;
+PFNGLBUFFERSTORAGEPROC glBufferStorage;
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+PFNGLFENCESYNCPROC glFenceSync;
+PFNGLCLIENTWAITSYNCPROC glClientWaitSync;
+PFNGLDELETESYNCPROC glDeleteSync;
+PFNGLGETSTRINGIPROC glGetStringi;
+PFNGLGENERATEMIPMAPPROC glGenerateMipmap;
+
+// Declared by the GL 1.3 headers on some platforms, so loaded under another name
+static PFNGLACTIVETEXTUREPROC ActiveTexture;
 
 _Graphics Graphics;
 
+// Shader backend: fixed-function transform, vertex color, texture modulation and distance field text
+static const char *VertexShaderSource =
+	"#version 330 core\n"
+	"layout(std140) uniform Camera {\n"
+	"	mat4 Projection;\n"
+	"	mat4 View;\n"
+	"};\n"
+	"uniform mat4 Model;\n"
+	"uniform mat4 TextureMatrix;\n"
+	"uniform vec4 Color;\n"
+	"layout(location = 0) in vec3 Position;\n"
+	"layout(location = 1) in vec2 TexCoord;\n"
+	"layout(location = 2) in vec4 VertexColor;\n"
+	"out vec2 FragmentTexCoord;\n"
+	"out vec4 FragmentColor;\n"
+	"void main() {\n"
+	"	gl_Position = Projection * View * Model * vec4(Position, 1.0);\n"
+	"	FragmentTexCoord = (TextureMatrix * vec4(TexCoord, 0.0, 1.0)).xy;\n"
+	"	FragmentColor = Color * VertexColor;\n"
+	"}\n";
+
+static const char *FragmentShaderSource =
+	"#version 330 core\n"
+	"uniform sampler2D Texture;\n"
+	"uniform int Textured;\n"
+	"in vec2 FragmentTexCoord;\n"
+	"in vec4 FragmentColor;\n"
+	"out vec4 OutputColor;\n"
+	"void main() {\n"
+	"	OutputColor = FragmentColor;\n"
+	"	if(Textured == 2) {\n"
+	"		float Distance = texture(Texture, FragmentTexCoord).a;\n"
+	"		float Width = max(fwidth(Distance) * 0.7, 0.001);\n"
+	"		OutputColor.a *= smoothstep(0.5 - Width, 0.5 + Width, Distance);\n"
+	"	}\n"
+	"	else if(Textured != 0)\n"
+	"		OutputColor *= texture(Texture, FragmentTexCoord);\n"
+	"}\n";
+
+// Fill a streamed vertex
+static void SetStreamVertex(_StreamVertex &Vertex, float X, float Y, float Z, float U, float V, const _Color &Color) {
+	Vertex.X = X;
+	Vertex.Y = Y;
+	Vertex.Z = Z;
+	Vertex.U = U;
+	Vertex.V = V;
+	Vertex.Red = GetColorByte(Color.Red);
+	Vertex.Green = GetColorByte(Color.Green);
+	Vertex.Blue = GetColorByte(Color.Blue);
+	Vertex.Alpha = GetColorByte(Color.Alpha);
+}
+
+// Cube faces stored as triangle strips of position, texture coordinate and normal
+static float CubeVertices[] = {
+
+	// Top
+	1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+	1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+
+	// Front
+	1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+
+	// Left
+	0.0f, 1.0f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f,
+
+	// Back
+	0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+	0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f,
+
+	// Right
+	1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+};
+
 // Initialize
-void _Graphics::Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, bool Fullscreen) {
+void _Graphics::Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, bool Fullscreen, int Backend) {
 	this->ScreenWidth = WindowWidth;
 	this->ScreenHeight = WindowHeight;
 	FramesPerSecond = 0;
@@ -50,7 +225,16 @@ void _Graphics::Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, boo
 	LastTextureID = -1;
 	LastColor = COLOR_WHITE;
 	LastTextureEnabled = true;
-
+	LastDistanceField = false;
+	ActiveVBO = -1;
+	ActiveMeshBuffer = 0;
+	Core = false;
+	Program = 0;
+	CameraBuffer = 0;
+	StreamMemory = nullptr;
+	StreamBase = 0;
+	for(int i = 0; i < GRAPHICS_STREAMREGIONS; i++)
+		StreamFences[i] = nullptr;
 
 	// Set video flags
 	Uint32 VideoFlags = SDL_WINDOW_OPENGL;
@@ -83,8 +267,30 @@ void _Graphics::Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, boo
 	if(Window == nullptr)
 		throw std::runtime_error("SDL_CreateWindow failed");
 
+	// Try a core profile context for the shader backend
+	Context = nullptr;
+	if(Backend == GRAPHICS_CORE) {
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		Context = SDL_GL_CreateContext(Window);
+		if(Context && !SetupCore()) {
+			SDL_GL_DeleteContext(Context);
+			Context = nullptr;
+		}
+
+		// Fall back to fixed function
+		if(!Context) {
+			std::cerr << "OpenGL 3.3 core unavailable, using legacy renderer" << std::endl;
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+		}
+	}
+
 	// Set up opengl context
-	Context = SDL_GL_CreateContext(Window);
+	if(!Context)
+		Context = SDL_GL_CreateContext(Window);
 	if(Context == nullptr)
 		throw std::runtime_error("SDL_GL_CreateContext failed");
 
@@ -98,6 +304,33 @@ void _Graphics::Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, boo
 	ChangeViewport(this->ScreenWidth, this->ScreenHeight);
 }
 
+// Initialize viewport and root element without creating a window or context
+void _Graphics::InitHeadless(int WindowWidth, int WindowHeight) {
+	this->ScreenWidth = WindowWidth;
+	this->ScreenHeight = WindowHeight;
+	FramesPerSecond = 0;
+	FrameCount = 0;
+	FrameRateTimer = 0;
+	TriangleCount = 0;
+	Context = 0;
+	Window = 0;
+	Enabled = false;
+	LastTextureID = -1;
+	LastColor = COLOR_WHITE;
+	LastTextureEnabled = true;
+	LastDistanceField = false;
+	ActiveVBO = -1;
+	ActiveMeshBuffer = 0;
+	Core = false;
+	StreamMemory = nullptr;
+
+	// Set root element
+	Element = new _Element("screen_element", nullptr, _Point(0, 0), _Point(this->ScreenWidth, this->ScreenHeight), _Alignment(0, 0), nullptr, false);
+
+	// Set up viewport
+	ChangeViewport(this->ScreenWidth, this->ScreenHeight);
+}
+
 // Shutdown system
 void _Graphics::Close() {
 	delete Element;
@@ -106,6 +339,16 @@ void _Graphics::Close() {
 		for(int i = 0; i < VBO_COUNT; i++)
 			glDeleteBuffers(1, &VertexBuffer[i]);
 
+		if(Core) {
+			for(int i = 0; i < GRAPHICS_STREAMREGIONS; i++) {
+				if(StreamFences[i])
+					glDeleteSync(StreamFences[i]);
+			}
+			glDeleteVertexArrays(VBO_COUNT + 1, VertexArray);
+			glDeleteBuffers(1, &CameraBuffer);
+			glDeleteProgram(Program);
+		}
+
 		SDL_GL_DeleteContext(Context);
 		Context = nullptr;
 	}
@@ -139,11 +382,21 @@ void _Graphics::SetupOpenGL() {
 	glGenBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
 	glBindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
 	glBufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+	glBufferSubData = (PFNGLBUFFERSUBDATAPROC)SDL_GL_GetProcAddress("glBufferSubData");
 	glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+	glGenFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)SDL_GL_GetProcAddress("glGenFramebuffers");
+	glBindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)SDL_GL_GetProcAddress("glBindFramebuffer");
+	glFramebufferTexture2D = (PFNGLFRAMEBUFFERTEXTURE2DPROC)SDL_GL_GetProcAddress("glFramebufferTexture2D");
+	glCheckFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)SDL_GL_GetProcAddress("glCheckFramebufferStatus");
+	glDeleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteFramebuffers");
+	glBlendFuncSeparate = (PFNGLBLENDFUNCSEPARATEPROC)SDL_GL_GetProcAddress("glBlendFuncSeparate");
+	ActiveTexture = (PFNGLACTIVETEXTUREPROC)SDL_GL_GetProcAddress("glActiveTexture");
 
 	// Default state
-	glEnable(GL_TEXTURE_2D);
-	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	if(!Core) {
+		glEnable(GL_TEXTURE_2D);
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
 	glCullFace(GL_BACK);
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glEnable(GL_BLEND);
@@ -152,11 +405,247 @@ void _Graphics::SetupOpenGL() {
 	// Build vertex buffers
 	BuildVertexBuffers();
 
+	// Vertex arrays, camera block and initial uniforms for the shader backend
+	if(Core) {
+		glGenVertexArrays(VBO_COUNT + 1, VertexArray);
+		for(int i = 0; i < VBO_COUNT; i++)
+			SetVertexLayout(i, VertexBuffer[i]);
+		if(glBufferStorage)
+			CreateStream(GRAPHICS_STREAMSIZE);
+		glBindVertexArray(0);
+
+		// Buffers without a color array draw with the color uniform alone
+		glVertexAttrib4f(2, 1.0f, 1.0f, 1.0f, 1.0f);
+
+		glGenBuffers(1, &CameraBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, CameraBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(float) * 32, nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, 0, CameraBuffer);
+
+		glUseProgram(Program);
+		glUniform1i(glGetUniformLocation(Program, "Texture"), 0);
+		ModelDirty = TextureMatrixDirty = true;
+		UniformColor = _Color(-1.0f, -1.0f, -1.0f, -1.0f);
+		UniformTextured = -1;
+		UpdateCamera();
+	}
+
 	// Clear screen
 	ClearScreen();
 	Flip(0);
 }
 
+// Load the shader backend and build its program, returning false if the context can't run it
+bool _Graphics::SetupCore() {
+	GLint MajorVersion = 0, MinorVersion = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &MajorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &MinorVersion);
+	int Version = MajorVersion * 10 + MinorVersion;
+	if(Version < 33)
+		return false;
+
+	// Load functions
+	glCreateShader = (PFNGLCREATESHADERPROC)SDL_GL_GetProcAddress("glCreateShader");
+	glShaderSource = (PFNGLSHADERSOURCEPROC)SDL_GL_GetProcAddress("glShaderSource");
+	glCompileShader = (PFNGLCOMPILESHADERPROC)SDL_GL_GetProcAddress("glCompileShader");
+	glGetShaderiv = (PFNGLGETSHADERIVPROC)SDL_GL_GetProcAddress("glGetShaderiv");
+	glGetShaderInfoLog = (PFNGLGETSHADERINFOLOGPROC)SDL_GL_GetProcAddress("glGetShaderInfoLog");
+	glDeleteShader = (PFNGLDELETESHADERPROC)SDL_GL_GetProcAddress("glDeleteShader");
+	glCreateProgram = (PFNGLCREATEPROGRAMPROC)SDL_GL_GetProcAddress("glCreateProgram");
+	glAttachShader = (PFNGLATTACHSHADERPROC)SDL_GL_GetProcAddress("glAttachShader");
+	glLinkProgram = (PFNGLLINKPROGRAMPROC)SDL_GL_GetProcAddress("glLinkProgram");
+	glGetProgramiv = (PFNGLGETPROGRAMIVPROC)SDL_GL_GetProcAddress("glGetProgramiv");
+	glGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC)SDL_GL_GetProcAddress("glGetProgramInfoLog");
+	glUseProgram = (PFNGLUSEPROGRAMPROC)SDL_GL_GetProcAddress("glUseProgram");
+	glDeleteProgram = (PFNGLDELETEPROGRAMPROC)SDL_GL_GetProcAddress("glDeleteProgram");
+	glGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)SDL_GL_GetProcAddress("glGetUniformLocation");
+	glUniform1i = (PFNGLUNIFORM1IPROC)SDL_GL_GetProcAddress("glUniform1i");
+	glUniform4f = (PFNGLUNIFORM4FPROC)SDL_GL_GetProcAddress("glUniform4f");
+	glUniformMatrix4fv = (PFNGLUNIFORMMATRIX4FVPROC)SDL_GL_GetProcAddress("glUniformMatrix4fv");
+	glGetUniformBlockIndex = (PFNGLGETUNIFORMBLOCKINDEXPROC)SDL_GL_GetProcAddress("glGetUniformBlockIndex");
+	glUniformBlockBinding = (PFNGLUNIFORMBLOCKBINDINGPROC)SDL_GL_GetProcAddress("glUniformBlockBinding");
+	glBindBufferBase = (PFNGLBINDBUFFERBASEPROC)SDL_GL_GetProcAddress("glBindBufferBase");
+	glGenVertexArrays = (PFNGLGENVERTEXARRAYSPROC)SDL_GL_GetProcAddress("glGenVertexArrays");
+	glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)SDL_GL_GetProcAddress("glBindVertexArray");
+	glDeleteVertexArrays = (PFNGLDELETEVERTEXARRAYSPROC)SDL_GL_GetProcAddress("glDeleteVertexArrays");
+	glEnableVertexAttribArray = (PFNGLENABLEVERTEXATTRIBARRAYPROC)SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+	glVertexAttribPointer = (PFNGLVERTEXATTRIBPOINTERPROC)SDL_GL_GetProcAddress("glVertexAttribPointer");
+	glVertexAttrib4f = (PFNGLVERTEXATTRIB4FPROC)SDL_GL_GetProcAddress("glVertexAttrib4f");
+	glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)SDL_GL_GetProcAddress("glMapBufferRange");
+	glFenceSync = (PFNGLFENCESYNCPROC)SDL_GL_GetProcAddress("glFenceSync");
+	glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)SDL_GL_GetProcAddress("glClientWaitSync");
+	glDeleteSync = (PFNGLDELETESYNCPROC)SDL_GL_GetProcAddress("glDeleteSync");
+	glGetStringi = (PFNGLGETSTRINGIPROC)SDL_GL_GetProcAddress("glGetStringi");
+	glGenerateMipmap = (PFNGLGENERATEMIPMAPPROC)SDL_GL_GetProcAddress("glGenerateMipmap");
+	if(!glCreateShader || !glGenVertexArrays || !glBindBufferBase || !glFenceSync || !glGetStringi || !glGenerateMipmap)
+		return false;
+
+	// Persistent mapping needs 4.4 or ARB_buffer_storage, otherwise the stream is orphaned like the legacy path
+	bool BufferStorage = Version >= 44;
+	GLint ExtensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+	for(GLint i = 0; i < ExtensionCount && !BufferStorage; i++)
+		BufferStorage = strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0;
+	glBufferStorage = BufferStorage ? (PFNGLBUFFERSTORAGEPROC)SDL_GL_GetProcAddress("glBufferStorage") : nullptr;
+
+	// Build program
+	GLuint VertexShader = CompileShader(GL_VERTEX_SHADER, VertexShaderSource);
+	GLuint FragmentShader = CompileShader(GL_FRAGMENT_SHADER, FragmentShaderSource);
+	if(!VertexShader || !FragmentShader)
+		return false;
+
+	Program = glCreateProgram();
+	glAttachShader(Program, VertexShader);
+	glAttachShader(Program, FragmentShader);
+	glLinkProgram(Program);
+	glDeleteShader(VertexShader);
+	glDeleteShader(FragmentShader);
+
+	GLint Status;
+	glGetProgramiv(Program, GL_LINK_STATUS, &Status);
+	if(!Status) {
+		char Log[1024];
+		glGetProgramInfoLog(Program, sizeof(Log), nullptr, Log);
+		std::cerr << "Shader link failed: " << Log << std::endl;
+		return false;
+	}
+
+	ModelUniform = glGetUniformLocation(Program, "Model");
+	TextureMatrixUniform = glGetUniformLocation(Program, "TextureMatrix");
+	ColorUniform = glGetUniformLocation(Program, "Color");
+	TexturedUniform = glGetUniformLocation(Program, "Textured");
+	glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "Camera"), 0);
+
+	Core = true;
+	return true;
+}
+
+// Compile a shader, returning 0 on failure
+GLuint _Graphics::CompileShader(GLenum Type, const char *Source) {
+	GLuint Shader = glCreateShader(Type);
+	glShaderSource(Shader, 1, &Source, nullptr);
+	glCompileShader(Shader);
+
+	GLint Status;
+	glGetShaderiv(Shader, GL_COMPILE_STATUS, &Status);
+	if(!Status) {
+		char Log[1024];
+		glGetShaderInfoLog(Shader, sizeof(Log), nullptr, Log);
+		std::cerr << "Shader compile failed: " << Log << std::endl;
+		glDeleteShader(Shader);
+		return 0;
+	}
+
+	return Shader;
+}
+
+// Describe a vertex buffer's layout to the shader in its vertex array
+void _Graphics::SetVertexLayout(int Type, GLuint BufferID) {
+	glBindVertexArray(VertexArray[Type]);
+	glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+
+	switch(Type) {
+		case VBO_CIRCLE:
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0);
+		break;
+		case VBO_QUAD:
+			glEnableVertexAttribArray(0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, 0);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (GLvoid *)(sizeof(float) * 2));
+		break;
+		case VBO_STREAM:
+			glEnableVertexAttribArray(0);
+			glEnableVertexAttribArray(1);
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, X));
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, U));
+			glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, Red));
+		break;
+		default:
+			glEnableVertexAttribArray(0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * GRAPHICS_VERTEXSIZE, 0);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * GRAPHICS_VERTEXSIZE, (GLvoid *)(sizeof(float) * 3));
+		break;
+	}
+}
+
+// Allocate persistently mapped stream storage split into one region per frame in flight
+void _Graphics::CreateStream(GLsizeiptr RegionSize) {
+	RegionSize = (RegionSize + sizeof(_StreamVertex) - 1) / sizeof(_StreamVertex) * sizeof(_StreamVertex);
+	for(int i = 0; i < GRAPHICS_STREAMREGIONS; i++) {
+		if(StreamFences[i])
+			glDeleteSync(StreamFences[i]);
+		StreamFences[i] = nullptr;
+	}
+	glDeleteBuffers(1, &VertexBuffer[VBO_STREAM]);
+
+	GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &VertexBuffer[VBO_STREAM]);
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer[VBO_STREAM]);
+	glBufferStorage(GL_ARRAY_BUFFER, RegionSize * GRAPHICS_STREAMREGIONS, nullptr, Flags);
+	StreamMemory = (uint8_t *)glMapBufferRange(GL_ARRAY_BUFFER, 0, RegionSize * GRAPHICS_STREAMREGIONS, Flags);
+	if(!StreamMemory)
+		throw std::runtime_error("Failed to map stream buffer");
+
+	StreamRegionSize = RegionSize;
+	StreamRegion = 0;
+	StreamOffset = 0;
+
+	// Point the stream's vertex array at the new buffer
+	GLuint PreviousArray = ActiveVBO >= 0 ? VertexArray[ActiveVBO] : 0;
+	SetVertexLayout(VBO_STREAM, VertexBuffer[VBO_STREAM]);
+	glBindVertexArray(PreviousArray);
+}
+
+// Copy vertices into the current frame's stream region, or orphan the buffer without persistent mapping
+void _Graphics::WriteStream(const _StreamVertex *Vertices, size_t Count) {
+	GLsizeiptr Size = (GLsizeiptr)(Count * sizeof(_StreamVertex));
+	if(!StreamMemory) {
+		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer[VBO_STREAM]);
+		StreamSize = std::max(StreamSize, Size);
+		glBufferData(GL_ARRAY_BUFFER, StreamSize, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, Size, Vertices);
+		StreamBase = 0;
+		return;
+	}
+
+	// Grow the regions once the GPU is done with them
+	if(StreamOffset + Size > StreamRegionSize) {
+		glFinish();
+		CreateStream(std::max(StreamRegionSize * 2, Size));
+	}
+
+	GLsizeiptr Offset = StreamRegion * StreamRegionSize + StreamOffset;
+	memcpy(StreamMemory + Offset, Vertices, Size);
+	StreamBase = (GLint)(Offset / (GLsizeiptr)sizeof(_StreamVertex));
+	StreamOffset += Size;
+}
+
+// Draw a few vertices through the stream in place of immediate mode
+void _Graphics::DrawStream(GLenum Mode, const _StreamVertex *Vertices, int Count) {
+	int PreviousVBO = ActiveVBO;
+	GLint PreviousBase = StreamBase;
+
+	WriteStream(Vertices, Count);
+	ActiveVBO = VBO_STREAM;
+	glBindVertexArray(VertexArray[VBO_STREAM]);
+	DrawArrays(Mode, 0, Count);
+
+	ActiveVBO = PreviousVBO;
+	StreamBase = PreviousBase;
+	glBindVertexArray(PreviousVBO >= 0 ? VertexArray[PreviousVBO] : 0);
+}
+
+// Upload projection and view to the camera block
+void _Graphics::UpdateCamera() {
+	glBindBuffer(GL_UNIFORM_BUFFER, CameraBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(float) * 16, Projection.GetData());
+	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(float) * 16, sizeof(float) * 16, View.GetData());
+}
+
 // Builds the vertex buffer objects
 void _Graphics::BuildVertexBuffers() {
 
@@ -189,42 +678,136 @@ void _Graphics::BuildVertexBuffers() {
 
 	// Cube
 	{
+		VertexBuffer[VBO_CUBE] = CreateVBO(CubeVertices, sizeof(CubeVertices));
+	}
 
-		float Triangles[] = {
+	// Streamed geometry, refilled every draw
+	{
+		StreamSize = GRAPHICS_STREAMSIZE;
+		glGenBuffers(1, &VertexBuffer[VBO_STREAM]);
+		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer[VBO_STREAM]);
+		glBufferData(GL_ARRAY_BUFFER, StreamSize, nullptr, GL_STREAM_DRAW);
+	}
+}
 
-			// Top
-			1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-			1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-			0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-
-			// Front
-			1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-			1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-
-			// Left
-			0.0f, 1.0f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 1.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-
-			// Back
-			0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f,
-			1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, -1.0f, 0.0f,
-			1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f,
-
-			// Right
-			1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-			1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-			1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-		};
+// Replace the contents of the stream buffer
+void _Graphics::UploadStream(const std::vector<_StreamVertex> &Vertices) {
+	FlushBatch();
+	if(Core) {
+		WriteStream(Vertices.data(), Vertices.size());
+		return;
+	}
+
+	GLsizeiptr Size = (GLsizeiptr)(Vertices.size() * sizeof(_StreamVertex));
+
+	// Orphan the old storage so the driver doesn't wait on draws still using it
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer[VBO_STREAM]);
+	StreamSize = std::max(StreamSize, Size);
+	glBufferData(GL_ARRAY_BUFFER, StreamSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, Size, Vertices.data());
+}
+
+// Queue a screen or world aligned quad, texture id 0 meaning untextured
+void _Graphics::SubmitQuad(GLuint TextureID, float Left, float Top, float Right, float Bottom, float U0, float V0, float U1, float V1, const _Color &Color, float Z) {
+
+	// Continue the last run when the texture matches
+	if(BatchRuns.empty() || BatchRuns.back().TextureID != TextureID || BatchRuns.back().DistanceField)
+		BatchRuns.push_back(_BatchRun{ TextureID, (GLint)BatchVertices.size(), 0, false });
+	BatchRuns.back().Count += 6;
+
+	BatchVertices.resize(BatchVertices.size() + 6);
+	BuildQuad(&BatchVertices[BatchVertices.size() - 6], Left, Top, Right, Bottom, U0, V0, U1, V1, Color, Z);
+}
+
+// Queue prebuilt quads moved to X, Y and tinted by a color
+void _Graphics::SubmitVertices(GLuint TextureID, const std::vector<_StreamVertex> &Vertices, float X, float Y, const _Color &Color, bool DistanceField) {
+	if(Vertices.empty())
+		return;
+
+	if(BatchRuns.empty() || BatchRuns.back().TextureID != TextureID || BatchRuns.back().DistanceField != DistanceField)
+		BatchRuns.push_back(_BatchRun{ TextureID, (GLint)BatchVertices.size(), 0, DistanceField });
+	BatchRuns.back().Count += (GLsizei)Vertices.size();
+
+	uint8_t Red = GetColorByte(Color.Red);
+	uint8_t Green = GetColorByte(Color.Green);
+	uint8_t Blue = GetColorByte(Color.Blue);
+	uint8_t Alpha = GetColorByte(Color.Alpha);
+	for(const auto &Vertex : Vertices) {
+		BatchVertices.push_back(Vertex);
+		_StreamVertex &Moved = BatchVertices.back();
+		Moved.X += X;
+		Moved.Y += Y;
+		Moved.Red = Red;
+		Moved.Green = Green;
+		Moved.Blue = Blue;
+		Moved.Alpha = Alpha;
+	}
+}
+
+// Write the two triangles of an axis aligned quad
+void _Graphics::BuildQuad(_StreamVertex *Vertices, float Left, float Top, float Right, float Bottom, float U0, float V0, float U1, float V1, const _Color &Color, float Z) {
+	static const int Triangles[6] = { 0, 1, 2, 2, 1, 3 };
+
+	const float Corners[4][4] = {
+		{ Left,  Top,    U0, V0 },
+		{ Right, Top,    U1, V0 },
+		{ Left,  Bottom, U0, V1 },
+		{ Right, Bottom, U1, V1 },
+	};
+	_StreamVertex Vertex;
+	Vertex.Z = Z;
+	Vertex.Red = GetColorByte(Color.Red);
+	Vertex.Green = GetColorByte(Color.Green);
+	Vertex.Blue = GetColorByte(Color.Blue);
+	Vertex.Alpha = GetColorByte(Color.Alpha);
+	for(int i = 0; i < 6; i++) {
+		const float *Corner = Corners[Triangles[i]];
+		Vertex.X = Corner[0];
+		Vertex.Y = Corner[1];
+		Vertex.U = Corner[2];
+		Vertex.V = Corner[3];
+		Vertices[i] = Vertex;
+	}
+}
 
-		VertexBuffer[VBO_CUBE] = CreateVBO(Triangles, sizeof(Triangles));
+// Draw queued quads with one upload and one draw per texture run
+void _Graphics::FlushBatch() {
+	if(BatchRuns.empty())
+		return;
+
+	// Take the queue so the calls below don't flush again
+	FlushVertices.swap(BatchVertices);
+	FlushRuns.swap(BatchRuns);
+	int PreviousVBO = ActiveVBO;
+
+	UploadStream(FlushVertices);
+	EnableVBO(VBO_STREAM);
+	for(const auto &Run : FlushRuns) {
+		SetTextureEnabled(Run.TextureID != 0);
+		if(Run.TextureID)
+			SetTextureID(Run.TextureID);
+		SetDistanceField(Run.DistanceField);
+
+		DrawArrays(GL_TRIANGLES, Run.First, Run.Count);
+		TriangleCount += Run.Count / 3;
 	}
+	SetDistanceField(false);
+	DisableVBO(VBO_STREAM);
+
+	// Restore the vertex layout that was bound before
+	if(PreviousVBO == VBO_COUNT)
+		EnableMeshVBO(ActiveMeshBuffer);
+	else if(PreviousVBO >= 0 && PreviousVBO != VBO_STREAM)
+		EnableVBO(PreviousVBO);
+
+	FlushVertices.clear();
+	FlushRuns.clear();
+}
+
+// Delete a vertex buffer
+void _Graphics::DeleteVBO(GLuint BufferID) {
+	if(Enabled)
+		glDeleteBuffers(1, &BufferID);
 }
 
 // Create vertex buffer and return id
@@ -238,8 +821,117 @@ GLuint _Graphics::CreateVBO(float *Triangles, GLuint Size) {
 	return BufferID;
 }
 
+// Check for framebuffer object support
+bool _Graphics::HasRenderTargets() const {
+	return Enabled && glGenFramebuffers && glBindFramebuffer && glFramebufferTexture2D && glCheckFramebufferStatus && glDeleteFramebuffers && glBlendFuncSeparate;
+}
+
+// Create a cleared RGBA texture with a framebuffer drawing into it
+GLuint _Graphics::CreateRenderTarget(int Width, int Height, GLuint &TextureID) {
+
+	glGenTextures(1, &TextureID);
+	SetTextureID(TextureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	GLuint FramebufferID;
+	glGenFramebuffers(1, &FramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, FramebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, TextureID, 0);
+	GLenum Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if(Status == GL_FRAMEBUFFER_COMPLETE)
+		glClear(GL_COLOR_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if(Status != GL_FRAMEBUFFER_COMPLETE) {
+		DeleteRenderTarget(FramebufferID, TextureID);
+		throw std::runtime_error("Render target is incomplete");
+	}
+
+	return FramebufferID;
+}
+
+// Delete a render target and its texture
+void _Graphics::DeleteRenderTarget(GLuint FramebufferID, GLuint TextureID) {
+	if(!Enabled)
+		return;
+
+	glDeleteFramebuffers(1, &FramebufferID);
+	glDeleteTextures(1, &TextureID);
+	if(LastTextureID == TextureID)
+		LastTextureID = -1;
+}
+
+// Draw into a render target with a flat projection of the world rectangle in Bounds
+void _Graphics::BeginRenderTarget(GLuint FramebufferID, int Width, int Height, const float *Bounds, bool Clear, const _Color &ClearColor) {
+	FlushBatch();
+	glBindFramebuffer(GL_FRAMEBUFFER, FramebufferID);
+	if(Clear) {
+		glClearColor(ClearColor.Red, ClearColor.Green, ClearColor.Blue, ClearColor.Alpha);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	if(Core) {
+		glGetIntegerv(GL_VIEWPORT, SavedViewport);
+		glViewport(0, 0, Width, Height);
+
+		SavedProjection = Projection;
+		SavedView = View;
+		PushMatrix();
+		Projection = _Matrix::Ortho(Bounds[0], Bounds[2], Bounds[1], Bounds[3], -100.0f, 100.0f);
+		View.SetIdentity();
+		Model.SetIdentity();
+		UpdateCamera();
+		return;
+	}
+
+	glPushAttrib(GL_VIEWPORT_BIT);
+	glViewport(0, 0, Width, Height);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(Bounds[0], Bounds[2], Bounds[1], Bounds[3], -100.0, 100.0);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+}
+
+// Return to drawing on the screen
+void _Graphics::EndRenderTarget() {
+	FlushBatch();
+	if(Core) {
+		Projection = SavedProjection;
+		View = SavedView;
+		PopMatrix();
+		UpdateCamera();
+		glViewport(SavedViewport[0], SavedViewport[1], SavedViewport[2], SavedViewport[3]);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return;
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+
+	glPopAttrib();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 // Enable state for VBO
 void _Graphics::EnableVBO(int Type) {
+	FlushBatch();
+	ActiveVBO = Type;
+	if(Core) {
+		glBindVertexArray(VertexArray[Type]);
+		return;
+	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer[Type]);
 
@@ -262,11 +954,25 @@ void _Graphics::EnableVBO(int Type) {
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glVertexPointer(2, GL_FLOAT, sizeof(float) * 2, 0);
 		break;
+		case VBO_STREAM:
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, X));
+			glTexCoordPointer(2, GL_FLOAT, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, U));
+			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(_StreamVertex), (GLvoid *)offsetof(_StreamVertex, Red));
+		break;
 	}
 }
 
 // Disable state for VBO
 void _Graphics::DisableVBO(int Type) {
+	FlushBatch();
+	ActiveVBO = -1;
+	if(Core) {
+		glBindVertexArray(0);
+		return;
+	}
 
 	switch(Type) {
 		case VBO_CUBE:
@@ -281,34 +987,111 @@ void _Graphics::DisableVBO(int Type) {
 		case VBO_CIRCLE:
 			glDisableClientState(GL_VERTEX_ARRAY);
 		break;
+		case VBO_STREAM:
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+			glDisableClientState(GL_COLOR_ARRAY);
+
+			// Current color is undefined after drawing with a color array
+			glColor4f(LastColor.Red, LastColor.Green, LastColor.Blue, LastColor.Alpha);
+		break;
+	}
+}
+
+// Enable state for a baked mesh using the cube vertex layout
+void _Graphics::EnableMeshVBO(GLuint BufferID) {
+	FlushBatch();
+	ActiveVBO = VBO_COUNT;
+	ActiveMeshBuffer = BufferID;
+	if(Core) {
+		SetVertexLayout(VBO_COUNT, BufferID);
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(float) * GRAPHICS_VERTEXSIZE, 0);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(float) * GRAPHICS_VERTEXSIZE, (GLvoid *)(sizeof(float) * 3));
+	glNormalPointer(GL_FLOAT, sizeof(float) * GRAPHICS_VERTEXSIZE, (GLvoid *)(sizeof(float) * 5));
+}
+
+// Disable state for a baked mesh
+void _Graphics::DisableMeshVBO() {
+	FlushBatch();
+	ActiveVBO = -1;
+	if(Core) {
+		glBindVertexArray(0);
+		return;
 	}
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
 }
 
 // Clears the screen
 void _Graphics::ClearScreen() {
+	FlushBatch();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 
 // Set up modelview matrix
 void _Graphics::Setup3DViewport() {
+	FlushBatch();
 	glViewport(0, ScreenHeight - ViewportHeight, ViewportWidth, ViewportHeight);
 }
 
 // Sets up the projection matrix for drawing 2D objects
 void _Graphics::Setup2DProjectionMatrix() {
+	FlushBatch();
 
 	// Set viewport
 	glViewport(0, 0, ScreenWidth, ScreenHeight);
 
+	// Set projection matrix and frustum
+	if(Core) {
+		Projection = _Matrix::Ortho(0, ScreenWidth, ScreenHeight, 0, -1, 1);
+		View.SetIdentity();
+		Model.SetIdentity();
+		ModelDirty = true;
+		UpdateCamera();
+	}
+	else {
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, ScreenWidth, ScreenHeight, 0, -1, 1);
+
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+	}
+
+	glDisable(GL_DEPTH_TEST);
+}
+
+// Sets up the perspective projection and camera view for drawing the world
+void _Graphics::Setup3DProjection(const float *Frustum, float Near, float Far, const Vector2 &Position, float Distance) {
+	FlushBatch();
+
+	if(Core) {
+		Projection = _Matrix::Frustum(-Frustum[0], Frustum[0], Frustum[1], -Frustum[1], Near, Far);
+		View.SetIdentity();
+		View.Translate(-Position.X, -Position.Y, -Distance);
+		Model.SetIdentity();
+		ModelDirty = true;
+		UpdateCamera();
+		return;
+	}
+
 	// Set projection matrix and frustum
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	glOrtho(0, ScreenWidth, ScreenHeight, 0, -1, 1);
+	glFrustum(-Frustum[0], Frustum[0], Frustum[1], -Frustum[1], Near, Far);
 
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
-
-	glDisable(GL_DEPTH_TEST);
+	glTranslatef(-Position.X, -Position.Y, -Distance);
 }
 
 // Fade the screen
@@ -318,106 +1101,59 @@ void _Graphics::FadeScreen(float Amount) {
 
 // Draw centered image in screen space
 void _Graphics::DrawImage(const _Point &CenterPoint, const _Texture *Texture, const _Color &Color) {
-	SetTextureEnabled(true);
-	SetTextureID(Texture->GetID());
-	SetColor(Color);
-
 	float HalfWidth = Texture->GetWidth() / 2.0f;
 	float HalfHeight = Texture->GetHeight() / 2.0f;
 
-	glBegin(GL_TRIANGLE_STRIP);
-
-		// Top right
-		glTexCoord2f(1, 0.0f);
-		glVertex2f(CenterPoint.X + HalfWidth, CenterPoint.Y - HalfHeight);
-
-		// Top left
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2f(CenterPoint.X - HalfWidth, CenterPoint.Y - HalfHeight);
-
-		// Bottom right
-		glTexCoord2f(1, 1);
-		glVertex2f(CenterPoint.X + HalfWidth, CenterPoint.Y + HalfHeight);
-
-		// Bottom left
-		glTexCoord2f(0.0f, 1);
-		glVertex2f(CenterPoint.X - HalfWidth, CenterPoint.Y + HalfHeight);
-
-	glEnd();
-
-	TriangleCount += 2;
+	SubmitQuad(Texture->GetID(), CenterPoint.X - HalfWidth, CenterPoint.Y - HalfHeight, CenterPoint.X + HalfWidth, CenterPoint.Y + HalfHeight, Texture->GetLeft(), Texture->GetTop(), Texture->GetRight(), Texture->GetBottom(), Color);
 }
 
 // Draw image in screen space
 void _Graphics::DrawImage(const _Bounds &Bounds, const _Texture *Texture, const _Color &Color, bool Stretch) {
-	SetTextureEnabled(true);
-	SetColor(Color);
-	SetTextureID(Texture->GetID());
 
 	// Get s and t
 	float S, T;
+	float EndX = Bounds.End.X, EndY = Bounds.End.Y;
 	if(Stretch) {
 		S = T = 1;
 	}
 	else {
 		S = (Bounds.End.X - Bounds.Start.X) / (float)(Texture->GetWidth());
 		T = (Bounds.End.Y - Bounds.Start.Y) / (float)(Texture->GetHeight());
-	}
-
-	glBegin(GL_TRIANGLE_STRIP);
-
-		// Top right
-		glTexCoord2f(S, 0.0f);
-		glVertex2f(Bounds.End.X, Bounds.Start.Y);
-
-		// Top left
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2f(Bounds.Start.X, Bounds.Start.Y);
 
-		// Bottom right
-		glTexCoord2f(S, T);
-		glVertex2f(Bounds.End.X, Bounds.End.Y);
-
-		// Bottom left
-		glTexCoord2f(0.0f, T);
-		glVertex2f(Bounds.Start.X, Bounds.End.Y);
-
-	glEnd();
+		// Atlas regions can't wrap, so stop at the image edge
+		if(Texture->IsAtlased()) {
+			if(S > 1.0f) {
+				S = 1.0f;
+				EndX = Bounds.Start.X + Texture->GetWidth();
+			}
+			if(T > 1.0f) {
+				T = 1.0f;
+				EndY = Bounds.Start.Y + Texture->GetHeight();
+			}
+		}
+	}
 
-	TriangleCount += 2;
+	SubmitQuad(Texture->GetID(), Bounds.Start.X, Bounds.Start.Y, EndX, EndY, Texture->GetLeft(), Texture->GetTop(), Texture->GetU(S), Texture->GetV(T), Color);
 }
 
 // Draw rectangle in screen space
 void _Graphics::DrawRectangle(const _Bounds &Bounds, const _Color &Color, bool Filled) {
-	SetTextureEnabled(false);
-
-	// Set alpha
-	SetColor(Color);
-
-	if(Filled)
-		glBegin(GL_QUADS);
-	else
-		glBegin(GL_LINE_LOOP);
-
-	// Top left
-	glVertex2f(Bounds.Start.X+1, Bounds.Start.Y);
-
-	// Top right
-	glVertex2f(Bounds.End.X, Bounds.Start.Y);
 
-	// Bottom right
-	glVertex2f(Bounds.End.X, Bounds.End.Y-1);
-
-	// Bottom left
-	glVertex2f(Bounds.Start.X+1, Bounds.End.Y-1);
-
-	glEnd();
+	if(Filled) {
+		SubmitQuad(0, Bounds.Start.X + 1, Bounds.Start.Y, Bounds.End.X, Bounds.End.Y - 1, 0.0f, 0.0f, 0.0f, 0.0f, Color);
+		return;
+	}
 
-	TriangleCount += 2;
+	// Outline as one pixel wide edges inside the bounds
+	SubmitQuad(0, Bounds.Start.X, Bounds.Start.Y, Bounds.End.X, Bounds.Start.Y + 1, 0.0f, 0.0f, 0.0f, 0.0f, Color);
+	SubmitQuad(0, Bounds.Start.X, Bounds.End.Y - 1, Bounds.End.X, Bounds.End.Y, 0.0f, 0.0f, 0.0f, 0.0f, Color);
+	SubmitQuad(0, Bounds.Start.X, Bounds.Start.Y + 1, Bounds.Start.X + 1, Bounds.End.Y - 1, 0.0f, 0.0f, 0.0f, 0.0f, Color);
+	SubmitQuad(0, Bounds.End.X - 1, Bounds.Start.Y + 1, Bounds.End.X, Bounds.End.Y - 1, 0.0f, 0.0f, 0.0f, 0.0f, Color);
 }
 
 // Draw stencil mask
 void _Graphics::DrawMask(const _Bounds &Bounds) {
+	FlushBatch();
 
 	// Enable stencil
 	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
@@ -427,129 +1163,81 @@ void _Graphics::DrawMask(const _Bounds &Bounds) {
 	// Write 1 to stencil buffer
 	glStencilFunc(GL_ALWAYS, 0x01, 0x01);
 	glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
-	glBegin(GL_TRIANGLE_STRIP);
-		glVertex2f(Bounds.End.X, Bounds.Start.Y);
-		glVertex2f(Bounds.Start.X, Bounds.Start.Y);
-		glVertex2f(Bounds.End.X, Bounds.End.Y);
-		glVertex2f(Bounds.Start.X, Bounds.End.Y);
-	glEnd();
+	SubmitQuad(0, Bounds.Start.X, Bounds.Start.Y, Bounds.End.X, Bounds.End.Y, 0.0f, 0.0f, 0.0f, 0.0f, COLOR_WHITE);
+	FlushBatch();
 
 	// Then draw element only where stencil is 1
 	glStencilFunc(GL_EQUAL, 0x01, 0x01);
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 	glDepthMask(GL_TRUE);
-
-	TriangleCount += 2;
 }
 
 // Draw 3d sprite
 void _Graphics::DrawTexture(float X, float Y, float Z, const _Texture *Texture, const _Color &Color, float Rotation, float ScaleX, float ScaleY) {
+	FlushBatch();
 	SetTextureEnabled(true);
 	SetColor(Color);
 	SetTextureID(Texture->GetID());
 
-	glPushMatrix();
+	PushMatrix();
 
 		// Apply translation, rotation, and scale transforms
-		glTranslatef(X, Y, Z);
+		Translate(X, Y, Z);
 		if(Rotation != 0.0f)
-			glRotatef(Rotation, 0.0f, 0.0f, 1.0f);
+			Rotate(Rotation);
 
 		// Set scale
-		glScalef(ScaleX, ScaleY, 1.0f);
-
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-	glPopMatrix();
-
-	TriangleCount += 2;
-}
-
-// Draw light
-void _Graphics::DrawLight(const Vector2 &Position, const _Texture *Texture, const _Color &Color, float Scale) {
-	SetTextureEnabled(true);
-	SetTextureID(Texture->GetID());
-
-	glPushMatrix();
-
-		// Apply translation, rotation, and scale transforms
-		glTranslatef(Position.X, Position.Y, 0.0f);
-
-		glScalef(Scale, Scale, 1.0f);
-
-		SetColor(Color);
-
-		glBegin(GL_TRIANGLE_STRIP);
-		glNormal3f(0.0f, 0.0f, 1.0f);
-
-		// Top right
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2f(-1.0f, 1.0f);
-
-		// Top left
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2f(1.0f, 1.0f);
-
-		// Bottom light
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2f(-1.0f, -1.0f);
-
-		// Bottom left
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2f(1.0f, -1.0f);
-
-	glEnd();
+		Scale(ScaleX, ScaleY, 1.0f);
+
+		// Map the quad's coordinates into the atlas region
+		if(Texture->IsAtlased()) {
+			_Matrix Region;
+			Region.Translate(Texture->GetLeft(), Texture->GetTop(), 0.0f);
+			Region.Scale(Texture->GetRight() - Texture->GetLeft(), Texture->GetBottom() - Texture->GetTop(), 1.0f);
+			SetTextureMatrix(Region);
+			DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			SetTextureMatrix(_Matrix());
+		}
+		else
+			DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	glPopMatrix();
+	PopMatrix();
 
 	TriangleCount += 2;
 }
 
 // Draw 3d wall
 void _Graphics::DrawCube(float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, const _Texture *Texture) {
+	FlushBatch();
 	SetTextureEnabled(true);
 	SetColor(COLOR_WHITE);
 	SetTextureID(Texture->GetID());
 
 	glEnable(GL_CULL_FACE);
 
-	glPushMatrix();
+	PushMatrix();
 
 		// Position cube
-		glTranslatef(StartX, StartY, StartZ);
-		glScalef(ScaleX, ScaleY, ScaleZ);
-
-		// Change texture
-		glMatrixMode(GL_TEXTURE);
-
-		// Draw top
-		glScalef(ScaleX, ScaleY, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		glLoadIdentity();
-
-		// Draw front
-		glScalef(ScaleX, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);
-		glLoadIdentity();
-
-		// Draw left
-		glScalef(ScaleY, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 8, 4);
-		glLoadIdentity();
-
-		// Draw back
-		glScalef(ScaleX, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 12, 4);
-		glLoadIdentity();
-
-		// Draw right
-		glScalef(ScaleY, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 16, 4);
-		glLoadIdentity();
-
-		glMatrixMode(GL_MODELVIEW);
+		Translate(StartX, StartY, StartZ);
+		Scale(ScaleX, ScaleY, ScaleZ);
+
+		// Draw top, front, left, back and right with the texture repeated across each face
+		float TextureScale[5][2] = {
+			{ ScaleX, ScaleY },
+			{ ScaleX, ScaleZ },
+			{ ScaleY, ScaleZ },
+			{ ScaleX, ScaleZ },
+			{ ScaleY, ScaleZ },
+		};
+		for(int i = 0; i < 5; i++) {
+			_Matrix FaceScale;
+			FaceScale.Scale(TextureScale[i][0], TextureScale[i][1], 1);
+			SetTextureMatrix(FaceScale);
+			DrawArrays(GL_TRIANGLE_STRIP, i * 4, 4);
+		}
+		SetTextureMatrix(_Matrix());
 
-	glPopMatrix();
+	PopMatrix();
 
 	glDisable(GL_CULL_FACE);
 
@@ -558,41 +1246,43 @@ void _Graphics::DrawCube(float StartX, float StartY, float StartZ, float ScaleX,
 
 // Draw double-sided flat wall
 void _Graphics::DrawWall(float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, float Rotation, const _Texture *Texture) {
+	FlushBatch();
 	SetTextureEnabled(true);
 	SetTextureID(Texture->GetID());
 	SetColor(COLOR_WHITE);
 
-	glPushMatrix();
+	PushMatrix();
 
+	_Matrix WallScale;
 	if(Rotation == 0) {
 
-		glTranslatef(StartX, StartY + 0.5f, StartZ);
-		glScalef(ScaleX, ScaleY, ScaleZ);
+		Translate(StartX, StartY + 0.5f, StartZ);
+		Scale(ScaleX, ScaleY, ScaleZ);
 
-		glMatrixMode(GL_TEXTURE);
-		glScalef(ScaleX, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 12, 4);
+		WallScale.Scale(ScaleX, ScaleZ, 1);
+		SetTextureMatrix(WallScale);
+		DrawArrays(GL_TRIANGLE_STRIP, 12, 4);
 	}
 	else {
 
-		glTranslatef(StartX + 0.5f, StartY, StartZ);
-		glScalef(ScaleX, ScaleY, ScaleZ);
+		Translate(StartX + 0.5f, StartY, StartZ);
+		Scale(ScaleX, ScaleY, ScaleZ);
 
-		glMatrixMode(GL_TEXTURE);
-		glScalef(ScaleY, ScaleZ, 1);
-		glDrawArrays(GL_TRIANGLE_STRIP, 8, 4);
+		WallScale.Scale(ScaleY, ScaleZ, 1);
+		SetTextureMatrix(WallScale);
+		DrawArrays(GL_TRIANGLE_STRIP, 8, 4);
 	}
 
-	glLoadIdentity();
-	glMatrixMode(GL_MODELVIEW);
+	SetTextureMatrix(_Matrix());
 
-	glPopMatrix();
+	PopMatrix();
 
 	TriangleCount += 2;
 }
 
 // Draw quad with repeated textures
 void _Graphics::DrawRepeatable(float StartX, float StartY, float StartZ, float EndX, float EndY, float EndZ, const _Texture *Texture, float Rotation, float ScaleX) {
+	FlushBatch();
 	SetTextureEnabled(true);
 	SetTextureID(Texture->GetID());
 	SetColor(COLOR_WHITE);
@@ -601,14 +1291,21 @@ void _Graphics::DrawRepeatable(float StartX, float StartY, float StartZ, float E
 	float Width = EndX - StartX;
 	float Height = EndY - StartY;
 
-	// Set texture mode
-	glMatrixMode(GL_TEXTURE);
-	glPushMatrix();
-
-		// Rotate the texture
-		glScalef(ScaleX, 1.0f, 1.0f);
-		glRotatef(Rotation, 0.0f, 0.0f, -1.0f);
-
+	// Rotate the texture
+	_Matrix Repeat;
+	Repeat.Scale(ScaleX, 1.0f, 1.0f);
+	Repeat.Rotate(-Rotation);
+	SetTextureMatrix(Repeat);
+
+	if(Core) {
+		_StreamVertex Vertices[4];
+		SetStreamVertex(Vertices[0], EndX, StartY, StartZ, Width, 0.0f, COLOR_WHITE);
+		SetStreamVertex(Vertices[1], StartX, StartY, StartZ, 0.0f, 0.0f, COLOR_WHITE);
+		SetStreamVertex(Vertices[2], EndX, EndY, EndZ, Width, Height, COLOR_WHITE);
+		SetStreamVertex(Vertices[3], StartX, EndY, EndZ, 0.0f, Height, COLOR_WHITE);
+		DrawStream(GL_TRIANGLE_STRIP, Vertices, 4);
+	}
+	else {
 		glBegin(GL_TRIANGLE_STRIP);
 			glNormal3f(0.0f, 0.0f, 1.0f);
 
@@ -629,24 +1326,125 @@ void _Graphics::DrawRepeatable(float StartX, float StartY, float StartZ, float E
 			glVertex3f(StartX, EndY, EndZ);
 
 		glEnd();
+	}
 
-	glPopMatrix();
-
-	// Restore modelview matrix
-	glMatrixMode(GL_MODELVIEW);
+	SetTextureMatrix(_Matrix());
 
 	TriangleCount += 2;
 }
 
+// Draw a range of triangles from the bound mesh
+void _Graphics::DrawMesh(const _Texture *Texture, GLint First, GLsizei Count, bool Cull) {
+	DrawMesh(Texture->GetID(), First, Count, Cull);
+}
+
+// Draw a range of triangles from the bound mesh with a raw texture id
+void _Graphics::DrawMesh(GLuint TextureID, GLint First, GLsizei Count, bool Cull) {
+	FlushBatch();
+	SetTextureEnabled(true);
+	SetTextureID(TextureID);
+	SetColor(COLOR_WHITE);
+
+	if(Cull)
+		glEnable(GL_CULL_FACE);
+
+	DrawArrays(GL_TRIANGLES, First, Count);
+
+	if(Cull)
+		glDisable(GL_CULL_FACE);
+
+	TriangleCount += Count / 3;
+}
+
+// Append a repeating textured quad, optionally clipped, matching DrawRepeatable
+void _Graphics::BuildRepeatable(std::vector<float> &Vertices, float StartX, float StartY, float EndX, float EndY, float Z, float Rotation, float ScaleX, const float *Clip) {
+	float Left = StartX, Top = StartY, Right = EndX, Bottom = EndY;
+	if(Clip) {
+		Left = std::max(Left, Clip[0]);
+		Top = std::max(Top, Clip[1]);
+		Right = std::min(Right, Clip[2]);
+		Bottom = std::min(Bottom, Clip[3]);
+		if(Left >= Right || Top >= Bottom)
+			return;
+	}
+
+	// Texture matrix from DrawRepeatable
+	float Radians = Rotation * (float)M_PI / 180.0f;
+	float Cos = std::cos(Radians);
+	float Sin = std::sin(Radians);
+
+	// Triangle strip order: top right, top left, bottom right, bottom left
+	float Corners[4][2] = { { Right, Top }, { Left, Top }, { Right, Bottom }, { Left, Bottom } };
+	int Order[6] = { 0, 1, 2, 2, 1, 3 };
+	for(int i = 0; i < 6; i++) {
+		float X = Corners[Order[i]][0];
+		float Y = Corners[Order[i]][1];
+		float U = X - StartX;
+		float V = Y - StartY;
+		float Vertex[GRAPHICS_VERTEXSIZE] = { X, Y, Z, ScaleX * (U * Cos + V * Sin), -U * Sin + V * Cos, 0.0f, 0.0f, 1.0f };
+		Vertices.insert(Vertices.end(), Vertex, Vertex + GRAPHICS_VERTEXSIZE);
+	}
+}
+
+// Append one face of the cube as two triangles
+void _Graphics::BuildCubeFace(std::vector<float> &Vertices, int Face, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, float TextureScaleX, float TextureScaleY) {
+	int Order[6] = { 0, 1, 2, 2, 1, 3 };
+	for(int i = 0; i < 6; i++) {
+		const float *Source = &CubeVertices[(Face * 4 + Order[i]) * GRAPHICS_VERTEXSIZE];
+		float Vertex[GRAPHICS_VERTEXSIZE] = {
+			StartX + Source[0] * ScaleX,
+			StartY + Source[1] * ScaleY,
+			StartZ + Source[2] * ScaleZ,
+			Source[3] * TextureScaleX,
+			Source[4] * TextureScaleY,
+			Source[5],
+			Source[6],
+			Source[7]
+		};
+		Vertices.insert(Vertices.end(), Vertex, Vertex + GRAPHICS_VERTEXSIZE);
+	}
+}
+
+// Append a cube without the bottom, matching DrawCube
+void _Graphics::BuildCube(std::vector<float> &Vertices, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ) {
+	BuildCubeFace(Vertices, 0, StartX, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleX, ScaleY);
+	BuildCubeFace(Vertices, 1, StartX, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleX, ScaleZ);
+	BuildCubeFace(Vertices, 2, StartX, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleY, ScaleZ);
+	BuildCubeFace(Vertices, 3, StartX, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleX, ScaleZ);
+	BuildCubeFace(Vertices, 4, StartX, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleY, ScaleZ);
+}
+
+// Append a flat wall, matching DrawWall
+void _Graphics::BuildWall(std::vector<float> &Vertices, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, float Rotation) {
+	if(Rotation == 0)
+		BuildCubeFace(Vertices, 3, StartX, StartY + 0.5f, StartZ, ScaleX, ScaleY, ScaleZ, ScaleX, ScaleZ);
+	else
+		BuildCubeFace(Vertices, 2, StartX + 0.5f, StartY, StartZ, ScaleX, ScaleY, ScaleZ, ScaleY, ScaleZ);
+}
+
 // Draw rectangle in 3d space
 void _Graphics::DrawRectangle(float StartX, float StartY, float EndX, float EndY, const _Color &Color, bool Filled) {
+	if(Filled) {
+		SubmitQuad(0, StartX, StartY, EndX, EndY, 0.0f, 0.0f, 0.0f, 0.0f, Color);
+		return;
+	}
+
+	FlushBatch();
 	SetTextureEnabled(false);
 	SetColor(Color);
 
-	if(Filled)
-		glBegin(GL_QUADS);
-	else
-		glBegin(GL_LINE_LOOP);
+	if(Core) {
+		_StreamVertex Vertices[4];
+		SetStreamVertex(Vertices[0], StartX, StartY, 0.0f, 0.0f, 0.0f, Color);
+		SetStreamVertex(Vertices[1], EndX, StartY, 0.0f, 0.0f, 0.0f, Color);
+		SetStreamVertex(Vertices[2], EndX, EndY, 0.0f, 0.0f, 0.0f, Color);
+		SetStreamVertex(Vertices[3], StartX, EndY, 0.0f, 0.0f, 0.0f, Color);
+		DrawStream(GL_LINE_LOOP, Vertices, 4);
+		TriangleCount += 2;
+		return;
+	}
+
+	glBegin(GL_LINE_LOOP);
 
 	// Top left
 	glVertex2f(StartX, StartY);
@@ -667,8 +1465,18 @@ void _Graphics::DrawRectangle(float StartX, float StartY, float EndX, float EndY
 
 // Draws line
 void _Graphics::DrawLine(float StartX, float StartY, float EndX, float EndY, const _Color &Color, float Z) {
+	FlushBatch();
 	SetTextureEnabled(false);
 
+	if(Core) {
+		SetColor(Color);
+		_StreamVertex Vertices[2];
+		SetStreamVertex(Vertices[0], StartX, StartY, Z, 0.0f, 0.0f, Color);
+		SetStreamVertex(Vertices[1], EndX, EndY, Z, 0.0f, 0.0f, Color);
+		DrawStream(GL_LINES, Vertices, 2);
+		return;
+	}
+
 	glPushMatrix();
 
 		glTranslatef(0.0f, 0.0f, Z);
@@ -688,18 +1496,19 @@ void _Graphics::DrawLine(float StartX, float StartY, float EndX, float EndY, con
 
 // Draw circle
 void _Graphics::DrawCircle(float X, float Y, float Z, float Radius, const _Color &Color) {
+	FlushBatch();
 	SetTextureEnabled(false);
 	SetColor(Color);
 
-	glPushMatrix();
+	PushMatrix();
 
 		// Apply translation and scale transforms
-		glTranslatef(X, Y, Z);
-		glScalef(Radius, Radius, 0.0f);
+		Translate(X, Y, Z);
+		Scale(Radius, Radius, 0.0f);
 
-		glDrawArrays(GL_LINE_LOOP, 0, GRAPHICS_CIRCLE_VERTICES);
+		DrawArrays(GL_LINE_LOOP, 0, GRAPHICS_CIRCLE_VERTICES);
 
-	glPopMatrix();
+	PopMatrix();
 }
 
 // Draws the frame
@@ -707,8 +1516,21 @@ void _Graphics::Flip(double FrameTime) {
 	if(!Enabled)
 		return;
 
+	FlushBatch();
 	TriangleCount = 0;
 
+	// Fence this frame's stream region and wait until the next one is free
+	if(StreamMemory) {
+		StreamFences[StreamRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		StreamRegion = (StreamRegion + 1) % GRAPHICS_STREAMREGIONS;
+		StreamOffset = 0;
+		if(StreamFences[StreamRegion]) {
+			glClientWaitSync(StreamFences[StreamRegion], GL_SYNC_FLUSH_COMMANDS_BIT, GRAPHICS_FENCETIMEOUT);
+			glDeleteSync(StreamFences[StreamRegion]);
+			StreamFences[StreamRegion] = nullptr;
+		}
+	}
+
 	// Swap buffers
 	SDL_GL_SwapWindow(Window);
 
@@ -728,7 +1550,8 @@ void _Graphics::Flip(double FrameTime) {
 // Set opengl color
 void _Graphics::SetColor(const _Color &Color) {
 	if(Color != LastColor) {
-		glColor4f(Color.Red, Color.Green, Color.Blue, Color.Alpha);
+		if(!Core)
+			glColor4f(Color.Red, Color.Green, Color.Blue, Color.Alpha);
 		LastColor = Color;
 	}
 }
@@ -736,15 +1559,62 @@ void _Graphics::SetColor(const _Color &Color) {
 // Enable/disable textures
 void _Graphics::SetTextureEnabled(bool Value) {
 	if(Value != LastTextureEnabled) {
-		if(Value)
-			glEnable(GL_TEXTURE_2D);
-		else
-			glDisable(GL_TEXTURE_2D);
+
+		// The shader backend reads LastTextureEnabled when drawing
+		if(!Core) {
+			if(Value)
+				glEnable(GL_TEXTURE_2D);
+			else
+				glDisable(GL_TEXTURE_2D);
+		}
 
 		LastTextureEnabled = Value;
 	}
 }
 
+// Treat the texture's alpha as a signed distance to an edge at 0.5
+void _Graphics::SetDistanceField(bool Value) {
+	if(Value != LastDistanceField) {
+
+		// Without shaders, sharpen the distance around the edge in the first stage and fade by vertex alpha in the second
+		if(!Core) {
+			if(Value) {
+				static const GLfloat Edge[4] = { 0.0f, 0.0f, 0.0f, 0.375f };
+				glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PRIMARY_COLOR);
+				glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_SUBTRACT);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_TEXTURE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_CONSTANT);
+				glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, Edge);
+				glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 4.0f);
+
+				// The second stage only runs with a texture enabled on its unit, but never samples it
+				ActiveTexture(GL_TEXTURE1);
+				glBindTexture(GL_TEXTURE_2D, LastTextureID);
+				glEnable(GL_TEXTURE_2D);
+				glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
+				glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS);
+				glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_PRIMARY_COLOR);
+				ActiveTexture(GL_TEXTURE0);
+			}
+			else {
+				ActiveTexture(GL_TEXTURE1);
+				glDisable(GL_TEXTURE_2D);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				ActiveTexture(GL_TEXTURE0);
+				glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 1.0f);
+				glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			}
+		}
+
+		LastDistanceField = Value;
+	}
+}
+
 // Set texture id
 void _Graphics::SetTextureID(GLuint TextureID) {
 	if(TextureID != LastTextureID) {
@@ -753,12 +1623,123 @@ void _Graphics::SetTextureID(GLuint TextureID) {
 	}
 }
 
+// Build mipmaps for the bound texture
+void _Graphics::GenerateMipmap() {
+	glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+// Save the model transform
+void _Graphics::PushMatrix() {
+	if(Core)
+		ModelStack.push_back(Model);
+	else
+		glPushMatrix();
+}
+
+// Restore the model transform
+void _Graphics::PopMatrix() {
+	if(Core) {
+		Model = ModelStack.back();
+		ModelStack.pop_back();
+		ModelDirty = true;
+	}
+	else
+		glPopMatrix();
+}
+
+// Translate the model transform
+void _Graphics::Translate(float X, float Y, float Z) {
+	if(Core) {
+		Model.Translate(X, Y, Z);
+		ModelDirty = true;
+	}
+	else
+		glTranslatef(X, Y, Z);
+}
+
+// Rotate the model transform around the z axis
+void _Graphics::Rotate(float Degrees) {
+	if(Core) {
+		Model.Rotate(Degrees);
+		ModelDirty = true;
+	}
+	else
+		glRotatef(Degrees, 0.0f, 0.0f, 1.0f);
+}
+
+// Scale the model transform
+void _Graphics::Scale(float X, float Y, float Z) {
+	if(Core) {
+		Model.Scale(X, Y, Z);
+		ModelDirty = true;
+	}
+	else
+		glScalef(X, Y, Z);
+}
+
+// Replace the texture coordinate transform
+void _Graphics::SetTextureMatrix(const _Matrix &Matrix) {
+	if(Core) {
+		TextureMatrix = Matrix;
+		TextureMatrixDirty = true;
+	}
+	else {
+		glMatrixMode(GL_TEXTURE);
+		glLoadMatrixf(Matrix.GetData());
+		glMatrixMode(GL_MODELVIEW);
+	}
+}
+
+// Draw from the bound vertex array, uploading changed shader state first
+void _Graphics::DrawArrays(GLenum Mode, GLint First, GLsizei Count) {
+	if(!Core) {
+		glDrawArrays(Mode, First, Count);
+		return;
+	}
+
+	if(ModelDirty) {
+		glUniformMatrix4fv(ModelUniform, 1, GL_FALSE, Model.GetData());
+		ModelDirty = false;
+	}
+	if(TextureMatrixDirty) {
+		glUniformMatrix4fv(TextureMatrixUniform, 1, GL_FALSE, TextureMatrix.GetData());
+		TextureMatrixDirty = false;
+	}
+
+	// Streamed vertices carry their own color
+	const _Color &Color = ActiveVBO == VBO_STREAM ? COLOR_WHITE : LastColor;
+	if(Color != UniformColor) {
+		glUniform4f(ColorUniform, Color.Red, Color.Green, Color.Blue, Color.Alpha);
+		UniformColor = Color;
+	}
+	int Textured = LastTextureEnabled ? (LastDistanceField ? 2 : 1) : 0;
+	if(Textured != UniformTextured) {
+		glUniform1i(TexturedUniform, Textured);
+		UniformTextured = Textured;
+	}
+
+	if(ActiveVBO == VBO_STREAM)
+		First += StreamBase;
+
+	glDrawArrays(Mode, First, Count);
+}
+
 _Element *_Graphics::GetElement() { return Element; }
-void _Graphics::SetDepthMask(bool Value) { glDepthMask(Value); }
-void _Graphics::EnableStencilTest() { glEnable(GL_STENCIL_TEST); }
-void _Graphics::DisableStencilTest() { glDisable(GL_STENCIL_TEST); }
-void _Graphics::EnableDepthTest() { glEnable(GL_DEPTH_TEST); }
-void _Graphics::DisableDepthTest() { glDisable(GL_DEPTH_TEST); }
-void _Graphics::EnableParticleBlending() { glBlendFunc(GL_SRC_ALPHA, 1); }
-void _Graphics::DisableParticleBlending() { glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
-void _Graphics::ShowCursor(bool Show) { SDL_ShowCursor(Show); }
\ No newline at end of file
+void _Graphics::SetDepthMask(bool Value) { FlushBatch(); glDepthMask(Value); }
+void _Graphics::EnableStencilTest() { FlushBatch(); glEnable(GL_STENCIL_TEST); }
+void _Graphics::DisableStencilTest() { FlushBatch(); glDisable(GL_STENCIL_TEST); }
+void _Graphics::EnableCullFace() { FlushBatch(); glEnable(GL_CULL_FACE); }
+void _Graphics::DisableCullFace() { FlushBatch(); glDisable(GL_CULL_FACE); }
+void _Graphics::EnableDepthTest() { FlushBatch(); glEnable(GL_DEPTH_TEST); }
+void _Graphics::DisableDepthTest() { FlushBatch(); glDisable(GL_DEPTH_TEST); }
+void _Graphics::EnableParticleBlending() { FlushBatch(); glBlendFunc(GL_SRC_ALPHA, 1); }
+void _Graphics::DisableParticleBlending() { FlushBatch(); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
+void _Graphics::EnableBakeBlending() { FlushBatch(); glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA); }
+void _Graphics::EnablePremultipliedBlending() { FlushBatch(); glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); }
+void _Graphics::EnableModulateBlending() { FlushBatch(); glBlendFunc(GL_DST_COLOR, GL_SRC_COLOR); }
+void _Graphics::ShowCursor(bool Show) {
+	if(!Enabled)
+		return;
+
+	SDL_ShowCursor(Show);
+}
\ No newline at end of file
@@ -20,8 +20,12 @@
 // Libraries
 #include <vector2.h>
 #include <color.h>
+#include <matrix.h>
+#include <constants.h>
 #include <SDL_video.h>
 #include <SDL_opengl.h>
+#include <vector>
+#include <stdint.h>
 
 // Forward Declarations
 class _Texture;
@@ -29,13 +33,44 @@ class _Element;
 class _Point;
 class _Bounds;
 
+enum GraphicsBackendType {
+	GRAPHICS_LEGACY,
+	GRAPHICS_CORE,
+};
+
 enum VertexBufferType {
 	VBO_CIRCLE,
 	VBO_QUAD,
 	VBO_CUBE,
+	VBO_STREAM,
 	VBO_COUNT
 };
 
+// Pre-transformed vertex with its own color for streamed geometry
+struct _StreamVertex {
+	float X, Y, Z;
+	float U, V;
+	uint8_t Red, Green, Blue, Alpha;
+};
+
+// Convert a color channel to a byte
+inline uint8_t GetColorByte(float Value) {
+	if(Value <= 0.0f)
+		return 0;
+	if(Value >= 1.0f)
+		return 255;
+
+	return (uint8_t)(Value * 255.0f + 0.5f);
+}
+
+// Run of batched vertices sharing a texture
+struct _BatchRun {
+	GLuint TextureID;
+	GLint First;
+	GLsizei Count;
+	bool DistanceField;
+};
+
 // Classes
 class _Graphics {
 
@@ -43,7 +78,8 @@ class _Graphics {
 
 		_Graphics() { Enabled = false; }
 
-		void Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, bool Fullscreen);
+		void Init(int WindowWidth, int WindowHeight, int Vsync, int MSAA, bool Fullscreen, int Backend=GRAPHICS_CORE);
+		void InitHeadless(int WindowWidth, int WindowHeight);
 		void Close();
 
 		void ToggleFullScreen();
@@ -53,6 +89,7 @@ class _Graphics {
 		void ChangeViewport(int Width, int Height);
 		void Setup2DProjectionMatrix();
 		void Setup3DViewport();
+		void Setup3DProjection(const float *Frustum, float Near, float Far, const Vector2 &Position, float Distance);
 
 		void FadeScreen(float Amount);
 		void DrawImage(const _Point &CenterPoint, const _Texture *Texture, const _Color &Color);
@@ -67,7 +104,12 @@ class _Graphics {
 		void DrawRectangle(float StartX, float StartY, float EndX, float EndY, const _Color &Color, bool Filled=false);
 		void DrawLine(float StartX, float StartY, float EndX, float EndY, const _Color &Color, float Z=0.0f);
 		void DrawCircle(float X, float Y, float Z, float Radius, const _Color &Color);
-		void DrawLight(const Vector2 &Position, const _Texture *Texture, const _Color &Color, float Scale=1.0f);
+		void DrawMesh(const _Texture *Texture, GLint First, GLsizei Count, bool Cull);
+		void DrawMesh(GLuint TextureID, GLint First, GLsizei Count, bool Cull);
+
+		void BuildRepeatable(std::vector<float> &Vertices, float StartX, float StartY, float EndX, float EndY, float Z, float Rotation, float ScaleX, const float *Clip);
+		void BuildCube(std::vector<float> &Vertices, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ);
+		void BuildWall(std::vector<float> &Vertices, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, float Rotation);
 
 		int GetScreenWidth() const { return ScreenWidth; }
 		int GetScreenHeight() const { return ScreenHeight; }
@@ -75,6 +117,9 @@ class _Graphics {
 		int GetViewportHeight() const { return ViewportHeight; }
 		float GetAspectRatio() const { return AspectRatio; }
 		int GetFramesPerSecond() const { return FramesPerSecond; }
+		bool IsEnabled() const { return Enabled; }
+		bool IsCore() const { return Core; }
+		GLint GetClampMode() const { return Core ? GL_CLAMP_TO_EDGE : GL_CLAMP; }
 		_Element *GetElement();
 
 		void SetDepthMask(bool Value);
@@ -82,22 +127,60 @@ class _Graphics {
 		void DisableDepthTest();
 		void EnableStencilTest();
 		void DisableStencilTest();
+		void EnableCullFace();
+		void DisableCullFace();
 		void EnableParticleBlending();
 		void DisableParticleBlending();
+		void EnableBakeBlending();
+		void EnablePremultipliedBlending();
+		void EnableModulateBlending();
 		void ClearScreen();
 		void Flip(double FrameTime);
 
 		GLuint CreateVBO(float *Triangles, GLuint Size);
+		void DeleteVBO(GLuint BufferID);
 		void EnableVBO(int Type);
 		void DisableVBO(int Type);
+		void UploadStream(const std::vector<_StreamVertex> &Vertices);
+		void BuildQuad(_StreamVertex *Vertices, float Left, float Top, float Right, float Bottom, float U0, float V0, float U1, float V1, const _Color &Color, float Z=0.0f);
+		void SubmitQuad(GLuint TextureID, float Left, float Top, float Right, float Bottom, float U0, float V0, float U1, float V1, const _Color &Color, float Z=0.0f);
+		void SubmitVertices(GLuint TextureID, const std::vector<_StreamVertex> &Vertices, float X, float Y, const _Color &Color, bool DistanceField=false);
+		void FlushBatch();
+		void EnableMeshVBO(GLuint BufferID);
+		void DisableMeshVBO();
+
+		bool HasRenderTargets() const;
+		GLuint CreateRenderTarget(int Width, int Height, GLuint &TextureID);
+		void DeleteRenderTarget(GLuint FramebufferID, GLuint TextureID);
+		void BeginRenderTarget(GLuint FramebufferID, int Width, int Height, const float *Bounds, bool Clear, const _Color &ClearColor=COLOR_TRANSPARENT);
+		void EndRenderTarget();
 
 		void SetColor(const _Color &Color);
 		void SetTextureEnabled(bool Value);
 		void SetTextureID(GLuint TextureID);
+		void GenerateMipmap();
 
 	private:
 
 		void SetupOpenGL();
+		bool SetupCore();
+		GLuint CompileShader(GLenum Type, const char *Source);
+		void SetVertexLayout(int Type, GLuint BufferID);
+		void SetDistanceField(bool Value);
+		void CreateStream(GLsizeiptr RegionSize);
+		void WriteStream(const _StreamVertex *Vertices, size_t Count);
+		void DrawStream(GLenum Mode, const _StreamVertex *Vertices, int Count);
+		void UpdateCamera();
+
+		// Transforms for either backend
+		void PushMatrix();
+		void PopMatrix();
+		void Translate(float X, float Y, float Z);
+		void Rotate(float Degrees);
+		void Scale(float X, float Y, float Z);
+		void SetTextureMatrix(const _Matrix &Matrix);
+		void DrawArrays(GLenum Mode, GLint First, GLsizei Count);
+		void BuildCubeFace(std::vector<float> &Vertices, int Face, float StartX, float StartY, float StartZ, float ScaleX, float ScaleY, float ScaleZ, float TextureScaleX, float TextureScaleY);
 
 		// Data structures
 		bool Enabled;
@@ -112,11 +195,41 @@ class _Graphics {
 		int ViewportHeight;
 		float AspectRatio;
 
+		// Shader backend
+		bool Core;
+		GLuint Program;
+		GLuint CameraBuffer;
+		GLint ModelUniform, TextureMatrixUniform, ColorUniform, TexturedUniform;
+		GLuint VertexArray[VBO_COUNT + 1];
+		_Matrix Projection, View, Model, TextureMatrix;
+		_Matrix SavedProjection, SavedView;
+		std::vector<_Matrix> ModelStack;
+		GLint SavedViewport[4];
+		bool ModelDirty, TextureMatrixDirty;
+		_Color UniformColor;
+		int UniformTextured;
+
+		// Persistently mapped stream regions, one per frame in flight
+		uint8_t *StreamMemory;
+		GLsizeiptr StreamRegionSize;
+		GLsizeiptr StreamOffset;
+		GLint StreamBase;
+		int StreamRegion;
+		GLsync StreamFences[GRAPHICS_STREAMREGIONS];
+
 		// Vertex buffers
 		GLuint VertexBuffer[VBO_COUNT];
+		GLsizeiptr StreamSize;
+		int ActiveVBO;
+		GLuint ActiveMeshBuffer;
+
+		// Sprite batch
+		std::vector<_StreamVertex> BatchVertices, FlushVertices;
+		std::vector<_BatchRun> BatchRuns, FlushRuns;
 
 		// State changes
 		bool LastTextureEnabled;
+		bool LastDistanceField;
 		GLuint LastTextureID;
 		_Color LastColor;
 
@@ -0,0 +1,86 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <grid.h>
+#include <constants.h>
+
+// Allocate cells and the node pool
+void _Grid::Init(int Width, int Height) {
+	this->Width = Width;
+	this->Height = Height;
+
+	Heads.assign(Width * Height * GRID_COUNT, -1);
+	Nodes.clear();
+	Nodes.reserve(MAP_GRIDNODES);
+	FreeNode = -1;
+}
+
+// Add an object to the front of a cell
+void _Grid::Add(int X, int Y, int Type, _Object *Object) {
+
+	// Get a node from the free list or grow the pool
+	int Node = FreeNode;
+	if(Node != -1)
+		FreeNode = Nodes[Node].Next;
+	else {
+		Node = (int)Nodes.size();
+		Nodes.push_back(_GridNode());
+	}
+
+	// Link to front
+	int &Head = Heads[GetIndex(X, Y, Type)];
+	Nodes[Node].Object = Object;
+	Nodes[Node].Next = Head;
+	Head = Node;
+}
+
+// Remove an object from a cell
+void _Grid::Remove(int X, int Y, int Type, _Object *Object) {
+	int *Link = &Heads[GetIndex(X, Y, Type)];
+	while(*Link != -1) {
+		int Node = *Link;
+		if(Nodes[Node].Object == Object) {
+
+			// Unlink and return to free list
+			*Link = Nodes[Node].Next;
+			Nodes[Node].Next = FreeNode;
+			FreeNode = Node;
+			return;
+		}
+
+		Link = &Nodes[Node].Next;
+	}
+}
+
+// Move an object already in a cell to its front
+void _Grid::MoveToFront(int X, int Y, int Type, _Object *Object) {
+	int &Head = Heads[GetIndex(X, Y, Type)];
+	int *Link = &Head;
+	while(*Link != -1) {
+		int Node = *Link;
+		if(Nodes[Node].Object == Object) {
+
+			// Relink at the head without touching the pool
+			*Link = Nodes[Node].Next;
+			Nodes[Node].Next = Head;
+			Head = Node;
+			return;
+		}
+
+		Link = &Nodes[Node].Next;
+	}
+}
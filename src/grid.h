@@ -0,0 +1,102 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <vector>
+
+// Forward Declarations
+class _Object;
+
+// Types of objects in the collision grid
+enum CollisionGridType {
+	GRID_PLAYER,
+	GRID_MONSTER,
+	GRID_ITEM,
+	GRID_COUNT
+};
+
+// Link in a cell's object list
+struct _GridNode {
+	_Object *Object;
+	int Next;
+};
+
+// Flat per-tile object lists backed by one node pool
+class _Grid {
+
+	public:
+
+		// Walks the objects in one cell
+		class _Iterator {
+
+			public:
+
+				_Iterator(const _GridNode *Nodes, int Index) : Nodes(Nodes), Index(Index) { }
+
+				_Object *operator*() const { return Nodes[Index].Object; }
+				_Iterator &operator++() { Index = Nodes[Index].Next; return *this; }
+				bool operator!=(const _Iterator &Iterator) const { return Index != Iterator.Index; }
+
+			private:
+
+				const _GridNode *Nodes;
+				int Index;
+		};
+
+		// Objects in one cell for range-based for loops
+		class _Cell {
+
+			public:
+
+				_Cell(const _GridNode *Nodes, int Head) : Nodes(Nodes), Head(Head) { }
+
+				_Iterator begin() const { return _Iterator(Nodes, Head); }
+				_Iterator end() const { return _Iterator(Nodes, -1); }
+				bool empty() const { return Head == -1; }
+
+			private:
+
+				const _GridNode *Nodes;
+				int Head;
+		};
+
+		_Grid() : Width(0), Height(0), FreeNode(-1) { }
+
+		void Init(int Width, int Height);
+
+		void Add(int X, int Y, int Type, _Object *Object);
+		void Remove(int X, int Y, int Type, _Object *Object);
+		void MoveToFront(int X, int Y, int Type, _Object *Object);
+
+		_Cell GetObjects(int X, int Y, int Type) const { return _Cell(Nodes.data(), Heads[GetIndex(X, Y, Type)]); }
+		bool HasObjects(int X, int Y, int Type) const { return Heads[GetIndex(X, Y, Type)] != -1; }
+
+	private:
+
+		int GetIndex(int X, int Y, int Type) const { return (Y * Width + X) * GRID_COUNT + Type; }
+
+		// Cells
+		int Width;
+		int Height;
+		std::vector<int> Heads;
+
+		// Node pool
+		std::vector<_GridNode> Nodes;
+		int FreeNode;
+};
@@ -16,6 +16,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <hud.h>
+#include <profiler.h>
 #include <graphics.h>
 #include <font.h>
 #include <config.h>
@@ -247,6 +248,7 @@ void _HUD::Update(double FrameTime, float Radius) {
 
 // Draw phase
 void _HUD::Render() {
+	_ProfilerScope Zone("HUD::Render");
 
 	// FPS
 	std::ostringstream Buffer;
@@ -59,6 +59,7 @@ class _Input {
 		bool MouseDown(Uint32 Button);
 
 		const _Point &GetMouse() { return Mouse; }
+		void SetMouse(const _Point &Point) { Mouse = Point; }
 
 		static const char *GetKeyName(int Key);
 		static const std::string &GetMouseButtonName(Uint32 Button);
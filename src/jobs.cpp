@@ -0,0 +1,233 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <jobs.h>
+#include <profiler.h>
+#include <SDL_timer.h>
+#include <algorithm>
+
+// Global instance
+_JobSystem JobSystem;
+
+// Index of the queue owned by the current thread
+static thread_local int WorkerIndex = 0;
+
+// Start worker threads
+void _JobSystem::Init(int WorkerCount) {
+	Done = false;
+	Pending = 0;
+
+	Queues.clear();
+	for(int i = 0; i <= WorkerCount; i++)
+		Queues.push_back(std::unique_ptr<_JobQueue>(new _JobQueue));
+
+	BusyTime.reset(new std::atomic<uint64_t>[WorkerCount + 1]);
+	CounterNames.clear();
+	for(int i = 0; i <= WorkerCount; i++) {
+		BusyTime[i] = 0;
+		CounterNames.push_back("Worker " + std::to_string(i) + " %");
+	}
+	StatsTime = SDL_GetPerformanceCounter();
+
+	WorkerIndex = 0;
+	for(int i = 1; i <= WorkerCount; i++)
+		Threads.push_back(std::thread(&_JobSystem::WorkerThread, this, i));
+}
+
+// Finish queued jobs and stop worker threads
+void _JobSystem::Close() {
+	while(RunQueuedJob(0) || RunMainThreadJob())
+		;
+
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		Done = true;
+	}
+	Wake.notify_all();
+
+	for(auto &Thread : Threads)
+		Thread.join();
+	Threads.clear();
+	Queues.clear();
+}
+
+// Queue a job on the current thread's deque
+void _JobSystem::Run(const std::function<void()> &Function, _JobCounter *Counter) {
+	if(Counter)
+		Counter->Count++;
+
+	// Nobody to hand it to
+	if(Threads.empty()) {
+		_Job Job = { Function, Counter };
+		Execute(Job, WorkerIndex);
+		return;
+	}
+
+	_JobQueue &Queue = *Queues[WorkerIndex];
+	{
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		Queue.Jobs.push_back({ Function, Counter });
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		Pending++;
+	}
+	Wake.notify_one();
+}
+
+// Queue a job that must run on the main thread, such as one making GL calls
+void _JobSystem::RunOnMainThread(const std::function<void()> &Function, _JobCounter *Counter) {
+	if(Counter)
+		Counter->Count++;
+
+	std::lock_guard<std::mutex> Lock(MainQueue.Mutex);
+	MainQueue.Jobs.push_back({ Function, Counter });
+}
+
+// Help run jobs until a counter reaches zero
+void _JobSystem::Wait(_JobCounter &Counter) {
+	while(Counter.Count.load() > 0) {
+		if(IsMainThread() && RunMainThreadJob())
+			continue;
+
+		if(!RunQueuedJob(WorkerIndex))
+			std::this_thread::yield();
+	}
+}
+
+// Run a function over [0, Count) in batches, returning when all batches are done
+void _JobSystem::ParallelFor(int Count, int BatchSize, const std::function<void(int Start, int End)> &Function) {
+	if(Count <= 0)
+		return;
+
+	// Not worth splitting
+	if(Threads.empty() || Count <= BatchSize) {
+		Function(0, Count);
+		return;
+	}
+
+	_JobCounter Counter;
+	for(int Start = 0; Start < Count; Start += BatchSize) {
+		int End = std::min(Start + BatchSize, Count);
+		Run([&Function, Start, End]() { Function(Start, End); }, &Counter);
+	}
+
+	Wait(Counter);
+}
+
+// Run all jobs queued for the main thread
+void _JobSystem::RunMainThreadJobs() {
+	_ProfilerScope Zone("JobSystem::RunMainThreadJobs");
+
+	while(RunMainThreadJob());
+}
+
+// Send worker utilization since the last call to the profiler
+void _JobSystem::UpdateStats() {
+	uint64_t Time = SDL_GetPerformanceCounter();
+	uint64_t Elapsed = Time - StatsTime;
+	StatsTime = Time;
+	if(!Elapsed)
+		return;
+
+	for(size_t i = 1; i < CounterNames.size(); i++)
+		Profiler.SetCounter(CounterNames[i].c_str(), BusyTime[i].exchange(0) * 100.0 / Elapsed);
+}
+
+// Determines if the current thread is the main thread
+bool _JobSystem::IsMainThread() const {
+	return WorkerIndex == 0;
+}
+
+// Run jobs, sleeping when there are none
+void _JobSystem::WorkerThread(int Index) {
+	WorkerIndex = Index;
+
+	while(1) {
+		if(RunQueuedJob(Index))
+			continue;
+
+		std::unique_lock<std::mutex> Lock(SleepMutex);
+		Wake.wait(Lock, [this] { return Done || Pending > 0; });
+		if(Done && Pending == 0)
+			return;
+	}
+}
+
+// Run a job from our own deque, or steal one from another thread
+bool _JobSystem::RunQueuedJob(int Index) {
+	if(Queues.empty())
+		return false;
+
+	_Job Job;
+	bool Found = false;
+	int QueueCount = (int)Queues.size();
+	for(int i = 0; i < QueueCount && !Found; i++) {
+		_JobQueue &Queue = *Queues[(Index + i) % QueueCount];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		if(Queue.Jobs.empty())
+			continue;
+
+		// Newest from our own deque, oldest from others
+		if(i == 0) {
+			Job = std::move(Queue.Jobs.back());
+			Queue.Jobs.pop_back();
+		}
+		else {
+			Job = std::move(Queue.Jobs.front());
+			Queue.Jobs.pop_front();
+		}
+		Found = true;
+	}
+
+	if(!Found)
+		return false;
+
+	Pending--;
+	Execute(Job, Index);
+
+	return true;
+}
+
+// Run one job from the main thread queue
+bool _JobSystem::RunMainThreadJob() {
+	_Job Job;
+	{
+		std::lock_guard<std::mutex> Lock(MainQueue.Mutex);
+		if(MainQueue.Jobs.empty())
+			return false;
+
+		Job = std::move(MainQueue.Jobs.front());
+		MainQueue.Jobs.pop_front();
+	}
+
+	Execute(Job, 0);
+
+	return true;
+}
+
+// Run a job and signal its counter
+void _JobSystem::Execute(_Job &Job, int Index) {
+	uint64_t Start = SDL_GetPerformanceCounter();
+	Job.Function();
+	if(BusyTime)
+		BusyTime[Index] += SDL_GetPerformanceCounter() - Start;
+
+	if(Job.Counter)
+		Job.Counter->Count--;
+}
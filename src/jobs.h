@@ -0,0 +1,106 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+
+// Counts unfinished jobs so a parent can wait on its children
+class _JobCounter {
+
+	public:
+
+		_JobCounter() : Count(0) { }
+
+		bool IsDone() const { return Count.load() == 0; }
+
+	private:
+
+		friend class _JobSystem;
+
+		std::atomic<int> Count;
+};
+
+// Unit of work
+struct _Job {
+	std::function<void()> Function;
+	_JobCounter *Counter;
+};
+
+// Jobs owned by one thread, popped from the back by the owner and stolen from the front
+struct _JobQueue {
+	std::mutex Mutex;
+	std::deque<_Job> Jobs;
+};
+
+// Work-stealing job system
+class _JobSystem {
+
+	public:
+
+		_JobSystem() : Pending(0), Done(false), StatsTime(0) { }
+
+		void Init(int WorkerCount);
+		void Close();
+
+		// Scheduling
+		void Run(const std::function<void()> &Function, _JobCounter *Counter=nullptr);
+		void RunOnMainThread(const std::function<void()> &Function, _JobCounter *Counter=nullptr);
+		void Wait(_JobCounter &Counter);
+		void ParallelFor(int Count, int BatchSize, const std::function<void(int Start, int End)> &Function);
+		void RunMainThreadJobs();
+
+		// Stats
+		void UpdateStats();
+		int GetWorkerCount() const { return (int)Threads.size(); }
+		bool IsMainThread() const;
+
+	private:
+
+		void WorkerThread(int Index);
+		bool RunQueuedJob(int Index);
+		bool RunMainThreadJob();
+		void Execute(_Job &Job, int Index);
+
+		// Threads and queues, with index 0 belonging to the main thread
+		std::vector<std::thread> Threads;
+		std::vector<std::unique_ptr<_JobQueue>> Queues;
+		_JobQueue MainQueue;
+
+		// Sleeping
+		std::mutex SleepMutex;
+		std::condition_variable Wake;
+		std::atomic<int> Pending;
+		std::atomic<bool> Done;
+
+		// Utilization
+		std::unique_ptr<std::atomic<uint64_t>[]> BusyTime;
+		std::vector<std::string> CounterNames;
+		uint64_t StatsTime;
+};
+
+extern _JobSystem JobSystem;
@@ -0,0 +1,230 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <lights.h>
+#include <renderqueue.h>
+#include <profiler.h>
+#include <assets.h>
+#include <camera.h>
+#include <texture.h>
+#include <constants.h>
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+_Lights::_Lights()
+:	Texture(Assets.GetTexture("light1")),
+	Framebuffer(0),
+	BufferTexture(0),
+	Width(0),
+	Height(0),
+	TilesX(0),
+	TilesY(0) {
+
+	Active.reserve(LIGHTS_CAPACITY);
+}
+
+// Destructor
+_Lights::~_Lights() {
+	if(Framebuffer)
+		Graphics.DeleteRenderTarget(Framebuffer, BufferTexture);
+}
+
+// Add a light that fades out over its duration
+void _Lights::Add(const Vector2 &Position, float Radius, const _Color &Color, float Duration) {
+	if((int)Active.size() >= LIGHTS_CAPACITY || Radius <= 0.0f || Duration <= 0.0f)
+		return;
+
+	_Light Light;
+	Light.Position = Position;
+	Light.Color = Color;
+	Light.Radius = Radius;
+	Light.Duration = Duration;
+	Light.Time = 0.0f;
+	Active.push_back(Light);
+}
+
+// Age lights and remove expired ones
+void _Lights::Update(double FrameTime) {
+	for(size_t i = 0; i < Active.size(); ) {
+		Active[i].Time += (float)FrameTime;
+		if(Active[i].Time >= Active[i].Duration) {
+			Active[i] = Active.back();
+			Active.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+// Draw the light buffer and queue it for compositing over the world
+void _Lights::Render(const _Camera *Camera, const _Texture *AmbientTexture, const _Color &Ambient, const Vector2 &AmbientPosition, float AmbientRadius) {
+	_ProfilerScope Zone("Lights::Render");
+
+	Cull(Camera);
+	Profiler.SetCounter("Lights", (double)Active.size());
+	Profiler.SetCounter("Visible lights", (double)Visible.size());
+
+	// Nothing to darken or light
+	if(Ambient.Alpha <= 0.0f && Visible.empty())
+		return;
+
+	ResizeBuffer();
+
+	// World rectangle covered by the buffer, padded to hide the camera's blending between updates
+	const float *AABB = Camera->GetAABB();
+	float Bounds[4] = { AABB[0] - LIGHTS_PADDING, AABB[1] - LIGHTS_PADDING, AABB[2] + LIGHTS_PADDING, AABB[3] + LIGHTS_PADDING };
+
+	// The buffer holds half the light so compositing can brighten up to double
+	Vertices.clear();
+	if(AmbientTexture && Ambient.Alpha > 0.0f) {
+		Vertices.resize(6);
+		_Color Color(Ambient.Red * 0.5f, Ambient.Green * 0.5f, Ambient.Blue * 0.5f, Ambient.Alpha);
+		Graphics.BuildQuad(&Vertices[0], AmbientPosition.X - AmbientRadius, AmbientPosition.Y - AmbientRadius, AmbientPosition.X + AmbientRadius, AmbientPosition.Y + AmbientRadius, AmbientTexture->GetLeft(), AmbientTexture->GetTop(), AmbientTexture->GetRight(), AmbientTexture->GetBottom(), Color);
+	}
+	size_t LightStart = Vertices.size();
+	BuildTiles(Bounds);
+
+	// Draw the ambient light then add point lights on top
+	Graphics.DisableDepthTest();
+	if(!Vertices.empty())
+		Graphics.UploadStream(Vertices);
+	Graphics.BeginRenderTarget(Framebuffer, Width, Height, Bounds, true, _Color(0.5f, 0.5f, 0.5f, 1.0f));
+	if(!Vertices.empty()) {
+		Graphics.EnableVBO(VBO_STREAM);
+		if(LightStart)
+			Graphics.DrawMesh(AmbientTexture->GetID(), 0, (GLsizei)LightStart, false);
+		if(Vertices.size() > LightStart) {
+			Graphics.EnableParticleBlending();
+			Graphics.DrawMesh(Texture->GetID(), (GLint)LightStart, (GLsizei)(Vertices.size() - LightStart), false);
+			Graphics.DisableParticleBlending();
+		}
+		Graphics.DisableVBO(VBO_STREAM);
+	}
+	Graphics.EndRenderTarget();
+	Graphics.EnableDepthTest();
+
+	// Composite once, with texture rows starting at the top edge like the buffer's projection
+	RenderQueue.SetPass(RENDERPASS_LIGHTS);
+	_StreamVertex *Composite = RenderQueue.AddVertices(BufferTexture, 6, RENDERBLEND_MODULATE);
+	Graphics.BuildQuad(Composite, Bounds[0], Bounds[1], Bounds[2], Bounds[3], 0.0f, 0.0f, 1.0f, 1.0f, COLOR_WHITE);
+}
+
+// Match the buffer to a fraction of the viewport
+void _Lights::ResizeBuffer() {
+	int NewWidth = std::max(Graphics.GetViewportWidth() / LIGHTS_DOWNSAMPLE, 1);
+	int NewHeight = std::max(Graphics.GetViewportHeight() / LIGHTS_DOWNSAMPLE, 1);
+	if(Framebuffer && NewWidth == Width && NewHeight == Height)
+		return;
+
+	if(Framebuffer)
+		Graphics.DeleteRenderTarget(Framebuffer, BufferTexture);
+
+	Width = NewWidth;
+	Height = NewHeight;
+	TilesX = (Width + LIGHTS_TILESIZE - 1) / LIGHTS_TILESIZE;
+	TilesY = (Height + LIGHTS_TILESIZE - 1) / LIGHTS_TILESIZE;
+	Framebuffer = Graphics.CreateRenderTarget(Width, Height, BufferTexture);
+}
+
+// Find the lights touching the view and how bright each is
+void _Lights::Cull(const _Camera *Camera) {
+	Visible.clear();
+	Weights.clear();
+	for(size_t i = 0; i < Active.size(); i++) {
+		const _Light &Light = Active[i];
+		if(!Camera->IsCircleInView(Light.Position, Light.Radius))
+			continue;
+
+		float Fade = 1.0f - Light.Time / Light.Duration;
+		Visible.push_back((int)i);
+		Weights.push_back(Fade * Light.Color.Alpha * Light.Radius * std::max(std::max(Light.Color.Red, Light.Color.Green), Light.Color.Blue));
+	}
+}
+
+// Bin visible lights into screen tiles and emit each tile's brightest lights clipped to the tile
+void _Lights::BuildTiles(const float *Bounds) {
+	if(Visible.empty())
+		return;
+
+	float TileWidth = (Bounds[2] - Bounds[0]) * LIGHTS_TILESIZE / Width;
+	float TileHeight = (Bounds[3] - Bounds[1]) * LIGHTS_TILESIZE / Height;
+
+	// Get the tiles overlapped by each light
+	TileLights.clear();
+	for(size_t i = 0; i < Visible.size(); i++) {
+		const _Light &Light = Active[Visible[i]];
+		int StartX = std::max((int)std::floor((Light.Position.X - Light.Radius - Bounds[0]) / TileWidth), 0);
+		int StartY = std::max((int)std::floor((Light.Position.Y - Light.Radius - Bounds[1]) / TileHeight), 0);
+		int EndX = std::min((int)std::floor((Light.Position.X + Light.Radius - Bounds[0]) / TileWidth), TilesX - 1);
+		int EndY = std::min((int)std::floor((Light.Position.Y + Light.Radius - Bounds[1]) / TileHeight), TilesY - 1);
+		for(int Y = StartY; Y <= EndY; Y++) {
+			for(int X = StartX; X <= EndX; X++)
+				TileLights.push_back(std::make_pair(Y * TilesX + X, (int)i));
+		}
+	}
+
+	// Group by tile, brightest first
+	std::sort(TileLights.begin(), TileLights.end(), [this](const std::pair<int, int> &First, const std::pair<int, int> &Second) {
+		if(First.first != Second.first)
+			return First.first < Second.first;
+		if(Weights[First.second] != Weights[Second.second])
+			return Weights[First.second] > Weights[Second.second];
+		return First.second < Second.second;
+	});
+
+	float TextureWidth = Texture->GetRight() - Texture->GetLeft();
+	float TextureHeight = Texture->GetBottom() - Texture->GetTop();
+	for(size_t Start = 0; Start < TileLights.size(); ) {
+		int Tile = TileLights[Start].first;
+		float TileLeft = Bounds[0] + (Tile % TilesX) * TileWidth;
+		float TileTop = Bounds[1] + (Tile / TilesX) * TileHeight;
+		float TileRight = std::min(TileLeft + TileWidth, Bounds[2]);
+		float TileBottom = std::min(TileTop + TileHeight, Bounds[3]);
+
+		// Lights past the tile's limit are too dim to notice
+		size_t End = Start;
+		for(; End < TileLights.size() && TileLights[End].first == Tile; End++) {
+			if(End - Start >= (size_t)LIGHTS_TILEMAX)
+				continue;
+
+			const _Light &Light = Active[Visible[TileLights[End].second]];
+			float LightLeft = Light.Position.X - Light.Radius;
+			float LightTop = Light.Position.Y - Light.Radius;
+			float Size = Light.Radius * 2.0f;
+			float Left = std::max(LightLeft, TileLeft);
+			float Top = std::max(LightTop, TileTop);
+			float Right = std::min(LightLeft + Size, TileRight);
+			float Bottom = std::min(LightTop + Size, TileBottom);
+			if(Left >= Right || Top >= Bottom)
+				continue;
+
+			float Fade = 1.0f - Light.Time / Light.Duration;
+			_Color Color(Light.Color.Red * 0.5f, Light.Color.Green * 0.5f, Light.Color.Blue * 0.5f, Light.Color.Alpha * Fade);
+
+			size_t Index = Vertices.size();
+			Vertices.resize(Index + 6);
+			Graphics.BuildQuad(&Vertices[Index], Left, Top, Right, Bottom,
+				Texture->GetLeft() + (Left - LightLeft) / Size * TextureWidth,
+				Texture->GetTop() + (Top - LightTop) / Size * TextureHeight,
+				Texture->GetLeft() + (Right - LightLeft) / Size * TextureWidth,
+				Texture->GetTop() + (Bottom - LightTop) / Size * TextureHeight,
+				Color);
+		}
+		Start = End;
+	}
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <graphics.h>
+#include <vector2.h>
+#include <color.h>
+#include <vector>
+#include <utility>
+
+// Forward Declarations
+class _Camera;
+class _Texture;
+
+// Short lived point light
+struct _Light {
+	Vector2 Position;
+	_Color Color;
+	float Radius;
+	float Duration;
+	float Time;
+};
+
+// Accumulates the ambient light and visible point lights into a low resolution buffer drawn over the world once
+class _Lights {
+
+	public:
+
+		_Lights();
+		~_Lights();
+
+		void Add(const Vector2 &Position, float Radius, const _Color &Color, float Duration);
+		void Clear() { Active.clear(); }
+		void Update(double FrameTime);
+		void Render(const _Camera *Camera, const _Texture *AmbientTexture, const _Color &Ambient, const Vector2 &AmbientPosition, float AmbientRadius);
+
+		int GetCount() const { return (int)Active.size(); }
+		int GetVisibleCount() const { return (int)Visible.size(); }
+
+	private:
+
+		void ResizeBuffer();
+		void Cull(const _Camera *Camera);
+		void BuildTiles(const float *Bounds);
+
+		// Lights
+		std::vector<_Light> Active;
+		std::vector<int> Visible;
+		std::vector<float> Weights;
+		const _Texture *Texture;
+
+		// Light buffer split into tiles, each holding its brightest lights
+		GLuint Framebuffer;
+		GLuint BufferTexture;
+		int Width, Height;
+		int TilesX, TilesY;
+		std::vector<std::pair<int, int>> TileLights;
+		std::vector<_StreamVertex> Vertices;
+};
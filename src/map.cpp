@@ -16,8 +16,13 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <map.h>
+#include <mapfile.h>
+#include <filesystem.h>
+#include <profiler.h>
 #include <utils.h>
 #include <graphics.h>
+#include <renderqueue.h>
+#include <lights.h>
 #include <assets.h>
 #include <camera.h>
 #include <events.h>
@@ -28,7 +33,10 @@
 #include <fstream>
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <map>
 
 // Initialize
 _Map::_Map()
@@ -36,7 +44,7 @@ _Map::_Map()
 	Width(MAP_WIDTH),
 	Height(MAP_HEIGHT),
 	Filename(""),
-	Data(nullptr),
+	Binary(false),
 	ObjectManager(new _ObjectManager()),
 	Camera(nullptr),
 	MonsterSet(MAP_DEFAULTMONSTERSET),
@@ -57,11 +65,39 @@ _Map::_Map(const std::string &Filename) : _Map() {
 
 	this->Filename = Filename;
 
-	// Load file
-	std::ifstream InputFile((Assets.GetAssetPath() + ASSETS_MAPS + Filename).c_str(), std::ios::in);
+	// Check format
+	std::string Path = Assets.GetAssetPath() + ASSETS_MAPS + Filename;
+	std::ifstream InputFile(Path.c_str(), std::ios::in);
 	if(!InputFile)
 		throw std::runtime_error("Cannot load file: " + Filename);
 
+	char Magic[sizeof(MAP_BINARYMAGIC) - 1];
+	InputFile.read(Magic, sizeof(Magic));
+	Binary = InputFile.gcount() == sizeof(Magic) && !memcmp(Magic, MAP_BINARYMAGIC, sizeof(Magic));
+
+	// Parse text maps from the stream, and map binary files into memory
+	if(Binary) {
+		InputFile.close();
+
+		_MappedFile File(Path);
+		if(!File.GetData())
+			throw std::runtime_error("Cannot load file: " + Filename);
+
+		LoadBinary(File.GetData(), File.GetSize());
+	}
+	else {
+		InputFile.clear();
+		InputFile.seekg(0);
+		LoadText(InputFile);
+	}
+
+	// Get light textures
+	AmbientLightTexture = Assets.GetTexture("light0");
+}
+
+// Load text map format
+void _Map::LoadText(std::ifstream &InputFile) {
+
 	// Get file version
 	int FileVersion;
 	InputFile >> FileVersion;
@@ -90,32 +126,7 @@ _Map::_Map(const std::string &Filename) : _Map() {
 		InputFile >> Object->Type >> Object->Identifier >> Object->Position.X >> Object->Position.Y;
 
 		// Check for items
-		switch(Object->Type) {
-			case _Object::MONSTER:
-				if(!Assets.IsMonsterLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find monster: " + Object->Identifier);
-			break;
-			case _Object::MISCITEM:
-				if(!Assets.IsMiscItemLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find misc item: " + Object->Identifier);
-			break;
-			case _Object::AMMO:
-				if(!Assets.IsAmmoLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find ammo: " + Object->Identifier);
-			break;
-			case _Object::UPGRADE:
-				if(!Assets.IsUpgradeLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find upgrade: " + Object->Identifier);
-			break;
-			case _Object::WEAPON:
-				if(!Assets.IsWeaponLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find weapon: " + Object->Identifier);
-			break;
-			case _Object::ARMOR:
-				if(!Assets.IsArmorLoaded(Object->Identifier))
-					throw std::runtime_error("Cannot find armor: " + Object->Identifier);
-			break;
-		}
+		CheckObjectIdentifier(Object->Type, Object->Identifier);
 
 		ObjectSpawns.push_back(Object);
 	}
@@ -137,10 +148,7 @@ _Map::_Map(const std::string &Filename) : _Map() {
 		std::string EventParticleIdentifier = GetCSVText(InputFile);
 
 		// Check for existence
-		if(EventMonsterIdentifier != "" && !Assets.IsMonsterLoaded(EventMonsterIdentifier))
-			throw std::runtime_error("Cannot find monster: " + EventMonsterIdentifier);
-		if(EventParticleIdentifier != "" && !Assets.IsParticleLoaded(EventParticleIdentifier))
-			throw std::runtime_error("Cannot find particle: " + EventParticleIdentifier);
+		CheckEventIdentifiers(EventMonsterIdentifier, EventParticleIdentifier);
 
 		_Event *Event = new _Event(EventType, EventActive, EventStart, EventEnd, EventLevel, EventActivationPeriod, EventItemIdentifier, EventMonsterIdentifier, EventParticleIdentifier);
 		for(size_t j = 0; j < TilesSize; j++) {
@@ -186,9 +194,145 @@ _Map::_Map(const std::string &Filename) : _Map() {
 		Blocks[Layer].push_back(Block);
 	}
 	InputFile.close();
+}
 
-	// Get light textures
-	AmbientLightTexture = Assets.GetTexture("light0");
+// Load binary map format
+void _Map::LoadBinary(const char *Data, size_t Size) {
+	if(Size < sizeof(_MapFileHeader))
+		throw std::runtime_error("Truncated map file: " + Filename);
+
+	// Check header
+	const _MapFileHeader *Header = (const _MapFileHeader *)Data;
+	if(Header->Version != MAP_BINARYVERSION)
+		throw std::runtime_error("Level version mismatch: " + Filename);
+
+	// Check that every section fits in the file
+	const _MapFileSection *Sections[] = { &Header->Strings, &Header->Objects, &Header->Events, &Header->EventTiles, &Header->Blocks };
+	const size_t RecordSizes[] = { sizeof(_MapFileString), sizeof(_MapFileObject), sizeof(_MapFileEvent), sizeof(_MapFileEventTile), sizeof(_MapFileBlock) };
+	for(size_t i = 0; i < sizeof(RecordSizes) / sizeof(RecordSizes[0]); i++) {
+		if(Sections[i]->Offset > Size || Sections[i]->Count > (Size - Sections[i]->Offset) / RecordSizes[i])
+			throw std::runtime_error("Corrupt map file: " + Filename);
+	}
+
+	const _MapFileString *FileStrings = (const _MapFileString *)(Data + Header->Strings.Offset);
+	const _MapFileObject *FileObjects = (const _MapFileObject *)(Data + Header->Objects.Offset);
+	const _MapFileEvent *FileEvents = (const _MapFileEvent *)(Data + Header->Events.Offset);
+	const _MapFileEventTile *FileEventTiles = (const _MapFileEventTile *)(Data + Header->EventTiles.Offset);
+	const _MapFileBlock *FileBlocks = (const _MapFileBlock *)(Data + Header->Blocks.Offset);
+
+	// Build string table
+	std::vector<std::string> Strings(Header->Strings.Count);
+	for(size_t i = 0; i < Strings.size(); i++) {
+		if(FileStrings[i].Offset > Size || FileStrings[i].Length > Size - FileStrings[i].Offset)
+			throw std::runtime_error("Corrupt map file: " + Filename);
+
+		Strings[i].assign(Data + FileStrings[i].Offset, FileStrings[i].Length);
+	}
+
+	// Look up a string by index
+	auto GetString = [&](int32_t Index) -> const std::string & {
+		static const std::string Empty;
+		if(Index < 0)
+			return Empty;
+		if((size_t)Index >= Strings.size())
+			throw std::runtime_error("Corrupt map file: " + Filename);
+
+		return Strings[Index];
+	};
+
+	MapType = Header->MapType;
+	Width = Header->Width;
+	Height = Header->Height;
+
+	// Load monster set
+	const std::string &SetFilename = GetString(Header->MonsterSet);
+	if(!LoadMonsterSet(SetFilename))
+		throw std::runtime_error("Cannot load monster set: " + SetFilename);
+
+	// Load objects
+	ObjectSpawns.reserve(Header->Objects.Count);
+	for(uint32_t i = 0; i < Header->Objects.Count; i++) {
+		const std::string &Identifier = GetString(FileObjects[i].Identifier);
+		CheckObjectIdentifier(FileObjects[i].Type, Identifier);
+
+		_ObjectSpawn *Object = new _ObjectSpawn();
+		Object->Type = FileObjects[i].Type;
+		Object->Identifier = Identifier;
+		Object->Position.X = FileObjects[i].PositionX;
+		Object->Position.Y = FileObjects[i].PositionY;
+		ObjectSpawns.push_back(Object);
+	}
+
+	// Load events
+	Events.reserve(Header->Events.Count);
+	for(uint32_t i = 0; i < Header->Events.Count; i++) {
+		const _MapFileEvent &FileEvent = FileEvents[i];
+		if(FileEvent.FirstTile > Header->EventTiles.Count || FileEvent.TileCount > Header->EventTiles.Count - FileEvent.FirstTile)
+			throw std::runtime_error("Corrupt map file: " + Filename);
+
+		CheckEventIdentifiers(GetString(FileEvent.MonsterIdentifier), GetString(FileEvent.ParticleIdentifier));
+
+		_Event *Event = new _Event(
+			FileEvent.Type,
+			FileEvent.Active,
+			_Coord(FileEvent.StartX, FileEvent.StartY),
+			_Coord(FileEvent.EndX, FileEvent.EndY),
+			FileEvent.Level,
+			FileEvent.ActivationPeriod,
+			GetString(FileEvent.ItemIdentifier),
+			GetString(FileEvent.MonsterIdentifier),
+			GetString(FileEvent.ParticleIdentifier)
+		);
+
+		Event->GetTiles().reserve(FileEvent.TileCount);
+		for(uint32_t j = FileEvent.FirstTile; j < FileEvent.FirstTile + FileEvent.TileCount; j++)
+			Event->AddTile(_EventTile(GetValidCoord(_Coord(FileEventTiles[j].X, FileEventTiles[j].Y)), FileEventTiles[j].Layer, FileEventTiles[j].BlockID));
+
+		Events.push_back(Event);
+		if(Event->GetType() == EVENT_CHECK)
+			CheckpointEvents.push_back(Event);
+	}
+
+	// Resolve each texture string once
+	std::vector<const _Texture *> Textures(Strings.size(), nullptr);
+	auto GetTexture = [&](int32_t Index) -> const _Texture * {
+		if(Index < 0)
+			return nullptr;
+
+		const std::string &Identifier = GetString(Index);
+		if(!Textures[Index]) {
+			Textures[Index] = Assets.GetTexture(Identifier);
+			if(!Textures[Index])
+				throw std::runtime_error("Cannot find texture: " + Identifier);
+		}
+
+		return Textures[Index];
+	};
+
+	// Load blocks by layer
+	for(int i = 0; i < MAPLAYER_COUNT; i++) {
+		const _MapFileSection &Layer = Header->Layers[i];
+		if(Layer.Offset > Header->Blocks.Count || Layer.Count > Header->Blocks.Count - Layer.Offset)
+			throw std::runtime_error("Corrupt map file: " + Filename);
+
+		Blocks[i].resize(Layer.Count);
+		for(uint32_t j = 0; j < Layer.Count; j++) {
+			const _MapFileBlock &FileBlock = FileBlocks[Layer.Offset + j];
+			_Block &Block = Blocks[i][j];
+			Block.TextureIdentifier = GetString(FileBlock.Texture);
+			Block.AltTextureIdentifier = GetString(FileBlock.AltTexture);
+			Block.Texture = GetTexture(FileBlock.Texture);
+			Block.AltTexture = GetTexture(FileBlock.AltTexture);
+			Block.Start = GetValidCoord(_Coord(FileBlock.StartX, FileBlock.StartY));
+			Block.End = GetValidCoord(_Coord(FileBlock.EndX, FileBlock.EndY));
+			Block.MinZ = FileBlock.MinZ;
+			Block.MaxZ = FileBlock.MaxZ;
+			Block.Rotation = FileBlock.Rotation;
+			Block.ScaleX = FileBlock.ScaleX;
+			Block.Wall = FileBlock.Wall;
+			Block.Walkable = FileBlock.Walkable;
+		}
+	}
 }
 
 // Shut down
@@ -202,12 +346,6 @@ _Map::~_Map() {
 	for(size_t i = 0; i < Events.size(); i++)
 		delete Events[i];
 
-	if(Data != nullptr) {
-		for(int i = 0; i < Width; i++)
-			delete[] Data[i];
-		delete[] Data;
-	}
-
 	Assets.UnloadMonsterSet();
 }
 
@@ -215,27 +353,35 @@ _Map::~_Map() {
 void _Map::Init() {
 
 	// Allocate memory
-	Data = new _Tile*[Width];
+	TileCollision.assign(Width * Height, 0);
+	Grid.Init(Width, Height);
 
-	for(int i = 0; i < Width; i++)
-		Data[i] = new _Tile[Height];
+	// Allocate pathfinding nodes
+	Pathfinder.Init(this, Width, Height);
+	FlowField.Init(this, Width, Height);
 
-	// Clear out array
-	for(int i = 0; i < Width; i++) {
-		for(int j = 0; j < Height; j++) {
-			Data[i][j] = _Tile();
-		}
+	// Build block indices
+	for(int i = 0; i < MAPLAYER_COUNT; i++) {
+		BlockIndex[i].Invalidate();
+		GetBlockIndex(i);
+	}
+
+	// Bake static geometry
+	if(Graphics.IsEnabled()) {
+		Mesh.Init(Width, Height);
+		for(int i = 0; i < MAPMESH_COUNT; i++)
+			UpdateMesh(i);
 	}
 
 	// Loop through layers and fill out walkable field
 	for(int l = 0; l < MAPLAYER_FORE; l++) {
 		for(size_t k = 0; k < Blocks[l].size(); k++) {
-			for(int i = Blocks[l][k].Start.X; i <= Blocks[l][k].End.X; i++) {
-				for(int j = Blocks[l][k].Start.Y; j <= Blocks[l][k].End.Y; j++) {
+			for(int j = Blocks[l][k].Start.Y; j <= Blocks[l][k].End.Y; j++) {
+				for(int i = Blocks[l][k].Start.X; i <= Blocks[l][k].End.X; i++) {
 					if(Blocks[l][k].Walkable)
-						Data[i][j].Collision &= ~_Tile::ENTITY;
+						TileCollision[j * Width + i] &= ~TILE_ENTITY;
 					else
-						Data[i][j].Collision |= _Tile::ENTITY;
+						TileCollision[j * Width + i] |= TILE_ENTITY;
 				}
 			}
 		}
@@ -243,23 +389,39 @@ void _Map::Init() {
 
 	// Loop through walls
 	for(size_t k = 0; k < Blocks[5].size(); k++) {
-		for(int i = Blocks[5][k].Start.X; i <= Blocks[5][k].End.X; i++) {
-			for(int j = Blocks[5][k].Start.Y; j <= Blocks[5][k].End.Y; j++) {
+		for(int j = Blocks[5][k].Start.Y; j <= Blocks[5][k].End.Y; j++) {
+			for(int i = Blocks[5][k].Start.X; i <= Blocks[5][k].End.X; i++) {
 				if(Blocks[5][k].Wall) {
 					if(Blocks[5][k].Walkable)
-						Data[i][j].Collision &= ~_Tile::ENTITY & ~_Tile::BULLET;
+						TileCollision[j * Width + i] &= ~(TILE_ENTITY | TILE_BULLET);
 					else
-						Data[i][j].Collision |= _Tile::ENTITY | _Tile::BULLET;
+						TileCollision[j * Width + i] |= TILE_ENTITY | TILE_BULLET;
 				}
 			}
 		}
 	}
 
-	// Loop through the events and fill out array
+	// Count events per tile
+	TileEventStart.assign(Width * Height + 1, 0);
+	for(size_t k = 0; k < Events.size(); k++) {
+		for(int j = Events[k]->GetStart().Y; j <= Events[k]->GetEnd().Y; j++) {
+			for(int i = Events[k]->GetStart().X; i <= Events[k]->GetEnd().X; i++)
+				TileEventStart[j * Width + i + 1]++;
+		}
+	}
+
+	// Convert counts to offsets
+	for(int i = 0; i < Width * Height; i++)
+		TileEventStart[i + 1] += TileEventStart[i];
+
+	// Fill out events in map order
+	std::vector<int> TileEventCount(Width * Height, 0);
+	TileEvents.resize(TileEventStart[Width * Height]);
 	for(size_t k = 0; k < Events.size(); k++) {
-		for(int i = Events[k]->GetStart().X; i <= Events[k]->GetEnd().X; i++) {
-			for(int j = Events[k]->GetStart().Y; j <= Events[k]->GetEnd().Y; j++) {
-				Data[i][j].Events.push_back(Events[k]);
+		for(int j = Events[k]->GetStart().Y; j <= Events[k]->GetEnd().Y; j++) {
+			for(int i = Events[k]->GetStart().X; i <= Events[k]->GetEnd().X; i++) {
+				int Index = j * Width + i;
+				TileEvents[TileEventStart[Index] + TileEventCount[Index]++] = Events[k];
 			}
 		}
 	}
@@ -269,7 +431,18 @@ void _Map::Init() {
 bool _Map::SaveLevel(const std::string &String) {
 
 	Filename = String;
-	std::ofstream Output((Assets.GetAssetPath() + ASSETS_MAPS + Filename).c_str(), std::ios::out);
+	std::string Path = Assets.GetAssetPath() + ASSETS_MAPS + Filename;
+	if(Binary)
+		SaveBinary(Path);
+	else
+		SaveText(Path);
+
+	return true;
+}
+
+// Save text map format
+void _Map::SaveText(const std::string &Path) {
+	std::ofstream Output(Path.c_str(), std::ios::out);
 	if(!Output)
 		throw std::runtime_error("Cannot create file: " + Filename);
 
@@ -332,8 +505,181 @@ bool _Map::SaveLevel(const std::string &String) {
 	}
 
 	Output.close();
+}
 
-	return true;
+// Save binary map format
+void _Map::SaveBinary(const std::string &Path) {
+	_MapFileHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, MAP_BINARYMAGIC, sizeof(Header.Magic));
+	Header.Version = MAP_BINARYVERSION;
+	Header.MapType = MapType;
+	Header.Width = Width;
+	Header.Height = Height;
+
+	// Add unique strings to the table
+	std::vector<std::string> Strings;
+	std::map<std::string, int32_t> StringIndex;
+	auto AddString = [&](const std::string &String) -> int32_t {
+		if(String == "")
+			return -1;
+
+		auto Iterator = StringIndex.find(String);
+		if(Iterator != StringIndex.end())
+			return Iterator->second;
+
+		int32_t Index = (int32_t)Strings.size();
+		StringIndex[String] = Index;
+		Strings.push_back(String);
+
+		return Index;
+	};
+
+	Header.MonsterSet = AddString(MonsterSet);
+
+	// Objects
+	std::vector<_MapFileObject> FileObjects(ObjectSpawns.size());
+	for(size_t i = 0; i < ObjectSpawns.size(); i++) {
+		FileObjects[i].Type = ObjectSpawns[i]->Type;
+		FileObjects[i].Identifier = AddString(ObjectSpawns[i]->Identifier);
+		FileObjects[i].PositionX = ObjectSpawns[i]->Position.X;
+		FileObjects[i].PositionY = ObjectSpawns[i]->Position.Y;
+	}
+
+	// Events
+	std::vector<_MapFileEvent> FileEvents(Events.size());
+	std::vector<_MapFileEventTile> FileEventTiles;
+	for(size_t i = 0; i < Events.size(); i++) {
+		const std::vector<_EventTile> &Tiles = Events[i]->GetTiles();
+
+		_MapFileEvent &FileEvent = FileEvents[i];
+		memset(&FileEvent, 0, sizeof(FileEvent));
+		FileEvent.ActivationPeriod = Events[i]->GetActivationPeriod();
+		FileEvent.Type = Events[i]->GetType();
+		FileEvent.Active = Events[i]->GetActive();
+		FileEvent.StartX = Events[i]->GetStart().X;
+		FileEvent.StartY = Events[i]->GetStart().Y;
+		FileEvent.EndX = Events[i]->GetEnd().X;
+		FileEvent.EndY = Events[i]->GetEnd().Y;
+		FileEvent.Level = Events[i]->GetLevel();
+		FileEvent.ItemIdentifier = AddString(Events[i]->GetItemIdentifier());
+		FileEvent.MonsterIdentifier = AddString(Events[i]->GetMonsterIdentifier());
+		FileEvent.ParticleIdentifier = AddString(Events[i]->GetParticleIdentifier());
+		FileEvent.FirstTile = (uint32_t)FileEventTiles.size();
+		FileEvent.TileCount = (uint32_t)Tiles.size();
+
+		for(size_t j = 0; j < Tiles.size(); j++) {
+			_MapFileEventTile FileEventTile;
+			FileEventTile.X = Tiles[j].Coord.X;
+			FileEventTile.Y = Tiles[j].Coord.Y;
+			FileEventTile.Layer = Tiles[j].Layer;
+			FileEventTile.BlockID = Tiles[j].BlockID;
+			FileEventTiles.push_back(FileEventTile);
+		}
+	}
+
+	// Blocks
+	std::vector<_MapFileBlock> FileBlocks;
+	for(int i = 0; i < MAPLAYER_COUNT; i++) {
+		Header.Layers[i].Offset = (uint32_t)FileBlocks.size();
+		Header.Layers[i].Count = (uint32_t)Blocks[i].size();
+		for(size_t j = 0; j < Blocks[i].size(); j++) {
+			_MapFileBlock FileBlock;
+			memset(&FileBlock, 0, sizeof(FileBlock));
+			FileBlock.StartX = Blocks[i][j].Start.X;
+			FileBlock.StartY = Blocks[i][j].Start.Y;
+			FileBlock.EndX = Blocks[i][j].End.X;
+			FileBlock.EndY = Blocks[i][j].End.Y;
+			FileBlock.MinZ = Blocks[i][j].MinZ;
+			FileBlock.MaxZ = Blocks[i][j].MaxZ;
+			FileBlock.Rotation = Blocks[i][j].Rotation;
+			FileBlock.ScaleX = Blocks[i][j].ScaleX;
+			FileBlock.Texture = AddString(Blocks[i][j].TextureIdentifier);
+			FileBlock.AltTexture = AddString(Blocks[i][j].AltTextureIdentifier);
+			FileBlock.Wall = Blocks[i][j].Wall;
+			FileBlock.Walkable = Blocks[i][j].Walkable;
+			FileBlocks.push_back(FileBlock);
+		}
+	}
+
+	// Lay out sections after the header
+	std::vector<_MapFileString> FileStrings(Strings.size());
+	uint32_t Offset = sizeof(Header);
+	Header.Strings.Offset = Offset;
+	Header.Strings.Count = (uint32_t)FileStrings.size();
+	Offset += (uint32_t)(FileStrings.size() * sizeof(_MapFileString));
+	Header.Objects.Offset = Offset;
+	Header.Objects.Count = (uint32_t)FileObjects.size();
+	Offset += (uint32_t)(FileObjects.size() * sizeof(_MapFileObject));
+	Header.Events.Offset = Offset;
+	Header.Events.Count = (uint32_t)FileEvents.size();
+	Offset += (uint32_t)(FileEvents.size() * sizeof(_MapFileEvent));
+	Header.EventTiles.Offset = Offset;
+	Header.EventTiles.Count = (uint32_t)FileEventTiles.size();
+	Offset += (uint32_t)(FileEventTiles.size() * sizeof(_MapFileEventTile));
+	Header.Blocks.Offset = Offset;
+	Header.Blocks.Count = (uint32_t)FileBlocks.size();
+	Offset += (uint32_t)(FileBlocks.size() * sizeof(_MapFileBlock));
+
+	// String data goes last
+	for(size_t i = 0; i < Strings.size(); i++) {
+		FileStrings[i].Offset = Offset;
+		FileStrings[i].Length = (uint32_t)Strings[i].size();
+		Offset += FileStrings[i].Length;
+	}
+
+	std::ofstream Output(Path.c_str(), std::ios::out | std::ios::binary);
+	if(!Output)
+		throw std::runtime_error("Cannot create file: " + Filename);
+
+	Output.write((const char *)&Header, sizeof(Header));
+	Output.write((const char *)FileStrings.data(), FileStrings.size() * sizeof(_MapFileString));
+	Output.write((const char *)FileObjects.data(), FileObjects.size() * sizeof(_MapFileObject));
+	Output.write((const char *)FileEvents.data(), FileEvents.size() * sizeof(_MapFileEvent));
+	Output.write((const char *)FileEventTiles.data(), FileEventTiles.size() * sizeof(_MapFileEventTile));
+	Output.write((const char *)FileBlocks.data(), FileBlocks.size() * sizeof(_MapFileBlock));
+	for(size_t i = 0; i < Strings.size(); i++)
+		Output.write(Strings[i].data(), Strings[i].size());
+
+	Output.close();
+}
+
+// Throw if a spawned object refers to a template that isn't loaded
+void _Map::CheckObjectIdentifier(int Type, const std::string &Identifier) {
+	switch(Type) {
+		case _Object::MONSTER:
+			if(!Assets.IsMonsterLoaded(Identifier))
+				throw std::runtime_error("Cannot find monster: " + Identifier);
+		break;
+		case _Object::MISCITEM:
+			if(!Assets.IsMiscItemLoaded(Identifier))
+				throw std::runtime_error("Cannot find misc item: " + Identifier);
+		break;
+		case _Object::AMMO:
+			if(!Assets.IsAmmoLoaded(Identifier))
+				throw std::runtime_error("Cannot find ammo: " + Identifier);
+		break;
+		case _Object::UPGRADE:
+			if(!Assets.IsUpgradeLoaded(Identifier))
+				throw std::runtime_error("Cannot find upgrade: " + Identifier);
+		break;
+		case _Object::WEAPON:
+			if(!Assets.IsWeaponLoaded(Identifier))
+				throw std::runtime_error("Cannot find weapon: " + Identifier);
+		break;
+		case _Object::ARMOR:
+			if(!Assets.IsArmorLoaded(Identifier))
+				throw std::runtime_error("Cannot find armor: " + Identifier);
+		break;
+	}
+}
+
+// Throw if an event refers to a monster or particle that isn't loaded
+void _Map::CheckEventIdentifiers(const std::string &MonsterIdentifier, const std::string &ParticleIdentifier) {
+	if(MonsterIdentifier != "" && !Assets.IsMonsterLoaded(MonsterIdentifier))
+		throw std::runtime_error("Cannot find monster: " + MonsterIdentifier);
+	if(ParticleIdentifier != "" && !Assets.IsParticleLoaded(ParticleIdentifier))
+		throw std::runtime_error("Cannot find particle: " + ParticleIdentifier);
 }
 
 // Loads a monster set
@@ -346,7 +692,7 @@ bool _Map::LoadMonsterSet(const std::string &String) {
 
 // Adds an object to the collision grid
 void _Map::AddObjectToGrid(_Object *Object, int Type) {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Get the object's bounding rectangle
@@ -355,14 +701,14 @@ void _Map::AddObjectToGrid(_Object *Object, int Type) {
 
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
 		for(int j = TileBounds.Start.Y; j <= TileBounds.End.Y; j++) {
-			Data[i][j].Objects[Type].push_front(Object);
+			Grid.Add(i, j, Type, Object);
 		}
 	}
 }
 
 // Removes an object from the collision grid
 void _Map::RemoveObjectFromGrid(_Object *Object, int Type) {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Get the object's bounding rectangle
@@ -371,19 +717,43 @@ void _Map::RemoveObjectFromGrid(_Object *Object, int Type) {
 
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
 		for(int j = TileBounds.Start.Y; j <= TileBounds.End.Y; j++) {
-			for(auto Iterator = Data[i][j].Objects[Type].begin(); Iterator != Data[i][j].Objects[Type].end(); ++Iterator) {
-				if(*Iterator == Object) {
-					Data[i][j].Objects[Type].erase(Iterator);
-					break;
-				}
-			}
+			Grid.Remove(i, j, Type, Object);
+		}
+	}
+}
+
+// Updates the collision grid after an object moves, without freeing nodes for cells it stays in
+void _Map::MoveObjectInGrid(_Object *Object, int Type, const Vector2 &OldPosition) {
+	if(TileCollision.empty())
+		throw std::runtime_error("Tile data uninitialized!");
+
+	// Get old and new bounding rectangles
+	_TileBounds OldBounds, NewBounds;
+	GetTileBounds(OldPosition, Object->GetRadius(), OldBounds);
+	GetTileBounds(Object->GetPosition(), Object->GetRadius(), NewBounds);
+
+	// Remove from cells that were left
+	for(int i = OldBounds.Start.X; i <= OldBounds.End.X; i++) {
+		for(int j = OldBounds.Start.Y; j <= OldBounds.End.Y; j++) {
+			if(i < NewBounds.Start.X || i > NewBounds.End.X || j < NewBounds.Start.Y || j > NewBounds.End.Y)
+				Grid.Remove(i, j, Type, Object);
+		}
+	}
+
+	// Put the object at the front of every cell it covers, matching a remove and add
+	for(int i = NewBounds.Start.X; i <= NewBounds.End.X; i++) {
+		for(int j = NewBounds.Start.Y; j <= NewBounds.End.Y; j++) {
+			if(i < OldBounds.Start.X || i > OldBounds.End.X || j < OldBounds.Start.Y || j > OldBounds.End.Y)
+				Grid.Add(i, j, Type, Object);
+			else
+				Grid.MoveToFront(i, j, Type, Object);
 		}
 	}
 }
 
 // Check collision with tiles and resolve
 bool _Map::CheckCollisions(const Vector2 &TargetPosition, float Radius, Vector2 &NewPosition) {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	NewPosition = TargetPosition;
@@ -421,7 +791,7 @@ bool _Map::CheckCollisions(const Vector2 &TargetPosition, float Radius, Vector2
 	bool NoDiag = false;
 	for(int i = LeftTile; i <= RightTile; i++) {
 		for(int j = TopTile; j <= BottomTile; j++) {
-			if(!Data[i][j].CanWalk()) {
+			if(!CanWalkThrough(i, j)) {
 
 				bool DiagonalPush = false;
 				Vector2 Push(0, 0);
@@ -508,7 +878,7 @@ bool _Map::CheckTileCollision(const Vector2 &Position, float Radius, float X, fl
 
 // Checks for collisions with an object in the collision grid
 _Object *_Map::CheckCollisionsInGrid(const Vector2 &Position, float Radius, int GridType, const _Object *SkipObject) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	float DistanceSquared, RadiiSum;
@@ -519,7 +889,7 @@ _Object *_Map::CheckCollisionsInGrid(const Vector2 &Position, float Radius, int
 
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
 		for(int j = TileBounds.Start.Y; j <= TileBounds.End.Y; j++) {
-			for(auto Iterator : Data[i][j].Objects[GridType]) {
+			for(auto Iterator : Grid.GetObjects(i, j, GridType)) {
 				if(Iterator != SkipObject) {
 					DistanceSquared = (Iterator->GetPosition() - Position).MagnitudeSquared();
 					RadiiSum = Iterator->GetRadius() + Radius;
@@ -538,7 +908,7 @@ _Object *_Map::CheckCollisionsInGrid(const Vector2 &Position, float Radius, int
 
 // Returns a list of entities that an object is colliding with
 void _Map::CheckEntityCollisionsInGrid(const Vector2 &Position, float Radius, const _Object *SkipObject, std::list<_Entity *> &Entities) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Get the object's bounding rectangle
@@ -548,8 +918,8 @@ void _Map::CheckEntityCollisionsInGrid(const Vector2 &Position, float Radius, co
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
 		for(int j = TileBounds.Start.Y; j <= TileBounds.End.Y; j++) {
 			for(int k = 0; k < 2; k++) {
-				for(auto Iterator = Data[i][j].Objects[k].begin(); Iterator != Data[i][j].Objects[k].end(); ++Iterator) {
-					_Entity *Entity = static_cast<_Entity *>(*Iterator);
+				for(auto Iterator : Grid.GetObjects(i, j, k)) {
+					_Entity *Entity = static_cast<_Entity *>(Iterator);
 					if(Entity != SkipObject && !Entity->IsDying()) {
 						float DistanceSquared = (Entity->GetPosition() - Position).MagnitudeSquared();
 						float RadiiSum = Entity->GetRadius() + Radius;
@@ -566,7 +936,7 @@ void _Map::CheckEntityCollisionsInGrid(const Vector2 &Position, float Radius, co
 
 // Checks for melee collisions with entities in the collision grid
 _Entity *_Map::CheckMeleeCollisions(_Entity *Attacker, const Vector2 &Direction, int GridType) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Get the object's bounding rectangle
@@ -574,8 +944,8 @@ _Entity *_Map::CheckMeleeCollisions(_Entity *Attacker, const Vector2 &Direction,
 	GetTileBounds(Attacker->GetPosition(), Attacker->GetWeaponRange(), TileBounds);
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
 		for(int j = TileBounds.Start.Y; j <= TileBounds.End.Y; j++) {
-			for(auto Iterator = Data[i][j].Objects[GridType].begin(); Iterator != Data[i][j].Objects[GridType].end(); ++Iterator) {
-				_Entity *Entity = static_cast<_Entity *>(*Iterator);
+			for(auto Iterator : Grid.GetObjects(i, j, GridType)) {
+				_Entity *Entity = static_cast<_Entity *>(Iterator);
 				if(!Entity->IsDying()) {
 					float DistanceSquared = (Entity->GetPosition() - Attacker->GetPosition()).MagnitudeSquared();
 					float RadiiSum = Entity->GetRadius() + Attacker->GetWeaponRange();
@@ -602,7 +972,7 @@ _Entity *_Map::CheckMeleeCollisions(_Entity *Attacker, const Vector2 &Direction,
 
 // Determines which walls are adjacent to the object
 int _Map::GetWallState(const Vector2 &Position, float Radius) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Get the object's bounding rectangle
@@ -613,7 +983,7 @@ int _Map::GetWallState(const Vector2 &Position, float Radius) const {
 	int WallState = 0;
 	_Coord TopLeft = GetValidCoord(_Coord((int)(Position[0] - Radius - MAP_EPSILON), (int)(Position[1] - Radius - MAP_EPSILON)));
 	for(int i = TileBounds.Start.Y; i <= TileBounds.End.Y; i++) {
-		if(!Data[TopLeft.X][i].CanWalk()) {
+		if(!CanWalkThrough(TopLeft.X, i)) {
 			WallState |= WALL_LEFT;
 			break;
 		}
@@ -621,7 +991,7 @@ int _Map::GetWallState(const Vector2 &Position, float Radius) const {
 
 	// Check top wall
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
-		if(!Data[i][TopLeft.Y].CanWalk()) {
+		if(!CanWalkThrough(i, TopLeft.Y)) {
 			WallState |= WALL_TOP;
 			break;
 		}
@@ -630,7 +1000,7 @@ int _Map::GetWallState(const Vector2 &Position, float Radius) const {
 	// Check right wall
 	_Coord BottomRight = GetValidCoord(_Coord((int)(Position[0] + Radius + MAP_EPSILON), (int)(Position[1] + Radius + MAP_EPSILON)));
 	for(int i = TileBounds.Start.Y; i <= TileBounds.End.Y; i++) {
-		if(!Data[BottomRight.X][i].CanWalk()) {
+		if(!CanWalkThrough(BottomRight.X, i)) {
 			WallState |= WALL_RIGHT;
 			break;
 		}
@@ -638,7 +1008,7 @@ int _Map::GetWallState(const Vector2 &Position, float Radius) const {
 
 	// Check bottom wall
 	for(int i = TileBounds.Start.X; i <= TileBounds.End.X; i++) {
-		if(!Data[i][BottomRight.Y].CanWalk()) {
+		if(!CanWalkThrough(i, BottomRight.Y)) {
 			WallState |= WALL_BOTTOM;
 			break;
 		}
@@ -667,7 +1037,7 @@ void _Map::GetAdjacentTile(const Vector2 &Position, float Direction, _Coord &Coo
 
 // Checks bullet collisions with objects and walls
 void _Map::CheckBulletCollisions(const Vector2 &Position, const Vector2 &Direction, _Entity **HitEntity, Vector2 *HitPosition, int GridType, bool CheckObjects) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Find slope
@@ -716,8 +1086,8 @@ void _Map::CheckBulletCollisions(const Vector2 &Position, const Vector2 &Directi
 
 		// Check for object intersections
 		if(CheckObjects) {
-			for(auto Iterator = Data[TileTracer.X][TileTracer.Y].Objects[GridType].begin(); Iterator != Data[TileTracer.X][TileTracer.Y].Objects[GridType].end(); ++Iterator) {
-				_Entity *Entity = static_cast<_Entity *>(*Iterator);
+			for(auto Iterator : Grid.GetObjects(TileTracer.X, TileTracer.Y, GridType)) {
+				_Entity *Entity = static_cast<_Entity *>(Iterator);
 				if(!Entity->IsDying()) {
 					float Distance = RayObjectIntersection(Position, Direction, Entity);
 					if(Distance < MinDistance && Distance > 0.0f) {
@@ -1008,9 +1378,149 @@ void _Map::RemoveBlock(int Layer, int Index) {
 	if(Index >= 0 && Index < (int)Blocks[Layer].size()) {
 		DeleteBlockIDFromTiles(Layer, Index);
 		Blocks[Layer].erase(Blocks[Layer].begin() + Index);
+		InvalidateLayer(Layer);
 	}
 }
 
+// Adds a block to the end of a layer
+void _Map::AddBlock(int Layer, _Block Block) {
+	Blocks[Layer].push_back(Block);
+	if(!BlockIndex[Layer].IsDirty())
+		BlockIndex[Layer].Add(Block.Start, Block.End, IsBlockAlwaysVisible(Layer, Block));
+
+	Mesh.Invalidate(GetMeshPass(Layer), Block.Start.X, Block.Start.Y, Block.End.X, Block.End.Y);
+}
+
+// Marks a layer's index and baked geometry as stale after blocks are edited
+void _Map::InvalidateLayer(int Layer) {
+	BlockIndex[Layer].Invalidate();
+	Mesh.Invalidate(GetMeshPass(Layer));
+}
+
+// Marks the baked geometry under a tile range as stale after a block there is edited in place
+void _Map::InvalidateBlock(int Layer, const _Coord &Start, const _Coord &End) {
+	BlockIndex[Layer].Invalidate();
+	Mesh.Invalidate(GetMeshPass(Layer), Start.X, Start.Y, End.X, End.Y);
+}
+
+// Returns the block index for a layer, rebuilding it after edits
+_BlockIndex &_Map::GetBlockIndex(int Layer) {
+	_BlockIndex &Index = BlockIndex[Layer];
+	if(Index.IsDirty()) {
+		Index.Clear(Width, Height);
+		for(size_t i = 0; i < Blocks[Layer].size(); i++)
+			Index.Add(Blocks[Layer][i].Start, Blocks[Layer][i].End, IsBlockAlwaysVisible(Layer, Blocks[Layer][i]));
+	}
+
+	return Index;
+}
+
+// Determines if a block skips camera culling
+bool _Map::IsBlockAlwaysVisible(int Layer, const _Block &Block) const {
+	if(Block.MinZ < 0)
+		return true;
+
+	// Raised floor blocks are drawn as cubes
+	return Layer >= MAPLAYER_FLOOR0 && Layer <= MAPLAYER_FLOOR2 && Block.MinZ != Block.MaxZ;
+}
+
+// Returns the baked geometry pass that draws a layer
+int _Map::GetMeshPass(int Layer) const {
+	switch(Layer) {
+		case MAPLAYER_BASE:
+			return MAPMESH_BASE;
+		case MAPLAYER_FLAT:
+			return MAPMESH_FLAT;
+		case MAPLAYER_WALL:
+			return MAPMESH_WALL;
+		case MAPLAYER_FORE:
+			return MAPMESH_FORE;
+	}
+
+	return MAPMESH_FLOOR;
+}
+
+// Rebuilds chunks changed since the last frame
+void _Map::UpdateMesh(int Pass) {
+	if(!Mesh.IsInitialized(Width, Height))
+		Mesh.Init(Width, Height);
+
+	const std::vector<int> &DirtyChunks = Mesh.GetDirtyChunks(Pass);
+	for(size_t i = 0; i < DirtyChunks.size(); i++)
+		BuildMeshChunk(Pass, DirtyChunks[i]);
+
+	Mesh.ClearDirtyChunks(Pass);
+}
+
+// Bakes the blocks of a pass that touch a chunk
+void _Map::BuildMeshChunk(int Pass, int Chunk) {
+	float ChunkBounds[4];
+	Mesh.GetChunkBounds(Chunk, ChunkBounds);
+	Mesh.BeginChunk(Pass, Chunk);
+
+	int FirstLayer = Pass == MAPMESH_FLOOR ? MAPLAYER_FLOOR0 : -1;
+	int LastLayer = Pass == MAPMESH_FLOOR ? MAPLAYER_FLOOR2 : -1;
+	for(int i = 0; i < MAPLAYER_COUNT && FirstLayer == -1; i++) {
+		if(GetMeshPass(i) == Pass)
+			FirstLayer = LastLayer = i;
+	}
+
+	for(int Layer = FirstLayer; Layer <= LastLayer; Layer++) {
+		GetBlockIndex(Layer).Query(ChunkBounds, MeshBlocks);
+		for(size_t k = 0; k < MeshBlocks.size(); k++) {
+			int i = MeshBlocks[k];
+			const _Block *Block = &Blocks[Layer][i];
+			float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
+			bool AlwaysVisible = IsBlockAlwaysVisible(Layer, *Block);
+			bool Cube = Pass == MAPMESH_WALL || (Pass == MAPMESH_FLOOR && Block->MinZ != Block->MaxZ);
+
+			// Cubes and walls belong to the chunk holding their first tile
+			if(Cube || Pass == MAPMESH_FLAT) {
+				if(Bounds[0] < ChunkBounds[0] || Bounds[0] >= ChunkBounds[2] || Bounds[1] < ChunkBounds[1] || Bounds[1] >= ChunkBounds[3])
+					continue;
+
+				std::vector<float> &Vertices = Mesh.AddPiece(Block->Texture, Cube, AlwaysVisible, Bounds);
+				if(Cube)
+					Graphics.BuildCube(Vertices, Bounds[0], Bounds[1], Block->MinZ, Bounds[2] - Bounds[0], Bounds[3] - Bounds[1], Block->MaxZ - Block->MinZ);
+				else
+					Graphics.BuildWall(Vertices, Bounds[0], Bounds[1], Block->MinZ, Bounds[2] - Bounds[0], Bounds[3] - Bounds[1], Block->MaxZ - Block->MinZ, Block->Rotation);
+
+				continue;
+			}
+
+			// Floors are clipped to the chunk
+			float Piece[4] = {
+				std::max(Bounds[0], ChunkBounds[0]),
+				std::max(Bounds[1], ChunkBounds[1]),
+				std::min(Bounds[2], ChunkBounds[2]),
+				std::min(Bounds[3], ChunkBounds[3])
+			};
+			if(Piece[0] >= Piece[2] || Piece[1] >= Piece[3])
+				continue;
+
+			float Z;
+			if(Pass == MAPMESH_BASE)
+				Z = Block->MinZ + MAP_LAYEROFFSET * i;
+			else if(Pass == MAPMESH_FORE)
+				Z = Block->MaxZ + MAP_LAYEROFFSET * i;
+			else
+				Z = Block->MinZ + MAP_LAYEROFFSET * Layer;
+
+			std::vector<float> &Vertices = Mesh.AddPiece(Block->Texture, false, AlwaysVisible, Piece);
+			Graphics.BuildRepeatable(Vertices, Bounds[0], Bounds[1], Bounds[2], Bounds[3], Z, Block->Rotation, Block->ScaleX, Piece);
+		}
+	}
+
+	Mesh.EndChunk();
+}
+
+// Queues the baked chunks of a pass
+void _Map::RenderMesh(int Pass, int RenderPass) {
+	UpdateMesh(Pass);
+	RenderQueue.SetPass(RenderPass);
+	Mesh.Render(Pass, Camera);
+}
+
 // Deletes a block id from the events list given a block id and layer
 void _Map::DeleteBlockIDFromTiles(int Layer, int Index) {
 
@@ -1037,12 +1547,7 @@ void _Map::RemoveObjects(std::list<size_t> &SelectedObjectIndices) {
 // Return the block at a given position
 int _Map::GetSelectedBlock(int Layer, const _Coord &Index) {
 
-	for(int i = static_cast<int>(Blocks[Layer].size())-1; i >= 0; i--) {
-		if(Index.X >= Blocks[Layer][i].Start.X && Index.Y >= Blocks[Layer][i].Start.Y && Index.X <= Blocks[Layer][i].End.X && Index.Y <= Blocks[Layer][i].End.Y)
-			return i;
-	}
-
-	return -1;
+	return GetBlockIndex(Layer).GetBlockAt(Index);
 }
 
 // Return the block at a given position
@@ -1099,18 +1604,20 @@ _Event *_Map::GetEvent(int Index) const {
 
 // Determines if a tile has any events
 bool _Map::HasEvents(const _Coord &Position) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
-	return Data[Position.X][Position.Y].Events.size() > 0;
+	int Index = Position.Y * Width + Position.X;
+	return TileEventStart[Index + 1] > TileEventStart[Index];
 }
 
 // Gets a list of event based on a position
-std::list<_Event *> &_Map::GetEventList(const _Coord &Position) {
-	if(!Data)
+_TileEvents _Map::GetEventList(const _Coord &Position) const {
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
-	return Data[Position.X][Position.Y].Events;
+	int Index = Position.Y * Width + Position.X;
+	return _TileEvents(TileEvents.data() + TileEventStart[Index], TileEvents.data() + TileEventStart[Index + 1]);
 }
 
 // Returns a starting position by level and player id
@@ -1160,8 +1667,9 @@ void _Map::ChangeLayer(int OldLayer, int NewLayer, int Index) {
 	DeleteBlockIDFromTiles(OldLayer, Index);
 
 	// Add new block
-	Blocks[NewLayer].push_back(Blocks[OldLayer][Index]);
+	AddBlock(NewLayer, Blocks[OldLayer][Index]);
 	Blocks[OldLayer].erase(Blocks[OldLayer].begin() + Index);
+	InvalidateLayer(OldLayer);
 
 }
 
@@ -1219,7 +1727,7 @@ Vector2 _Map::GetValidPosition(const Vector2 &Position) const {
 
 // Opens a door or hits a floor switch
 void _Map::ChangeMapState(const _Event *Event) {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Check for the proper event
@@ -1235,19 +1743,21 @@ void _Map::ChangeMapState(const _Event *Event) {
 
 		// Change all the tiles
 		for(size_t i = StartIndex; i < Tiles.size(); i++) {
-			_Tile *Tile = &Data[Tiles[i].Coord.X][Tiles[i].Coord.Y];
-
-			Tile->Collision ^= _Tile::ENTITY;
+			TileCollision[Tiles[i].Coord.Y * Width + Tiles[i].Coord.X] ^= TILE_ENTITY;
 
 			// Switch textures
 			SwapBlockTextures(Tiles[i].Layer, Tiles[i].BlockID);
 		}
+
+		// Doors change which paths exist
+		Pathfinder.ClearCache();
+		FlowField.Invalidate();
 	}
 }
 
 // Determines if the map state can be changed
 bool _Map::CanChangeMapState(const _Event *Event) {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
 	// Check for the proper event
@@ -1255,8 +1765,8 @@ bool _Map::CanChangeMapState(const _Event *Event) {
 
 	// Check for objects in the wall
 	for(size_t i = 0; i < Tiles.size(); i++) {
-		_Tile *Tile = &Data[Tiles[i].Coord.X][Tiles[i].Coord.Y];
-		if(Tile->CanWalk() && (Tile->Objects[GRID_PLAYER].size() > 0 || Tile->Objects[GRID_MONSTER].size() > 0))
+		const _Coord &Coord = Tiles[i].Coord;
+		if(CanWalkThrough(Coord.X, Coord.Y) && (Grid.HasObjects(Coord.X, Coord.Y, GRID_PLAYER) || Grid.HasObjects(Coord.X, Coord.Y, GRID_MONSTER)))
 			return false;
 	}
 
@@ -1270,99 +1780,37 @@ void _Map::SwapBlockTextures(int Layer, int Index) {
 		_Block *Block = &Blocks[Layer][Index];
 		if(Block->AltTexture) {
 			std::swap(Block->Texture, Block->AltTexture);
+			Mesh.Invalidate(GetMeshPass(Layer), Block->Start.X, Block->Start.Y, Block->End.X, Block->End.Y);
 		}
 	}
 }
 
 // Renders the floor
 void _Map::RenderFloors() {
+	_ProfilerScope Zone("Map::RenderFloors");
+
 	if(!Camera)
 		return;
 
 	// Draw base layer
-	Graphics.SetDepthMask(false);
-	for(int i = 0; i < static_cast<int>(Blocks[0].size()); i++) {
-		_Block *Block = &Blocks[0][i];
-		bool Draw = true;
-		if(Block->MinZ >= 0) {
-			float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
-			Draw = Camera->IsAABBInView(Bounds);
-		}
-
-		if(Draw)
-			Graphics.DrawRepeatable((float)Block->Start.X, (float)Block->Start.Y, (float)Block->MinZ + MAP_LAYEROFFSET * i, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f, Block->MinZ + MAP_LAYEROFFSET * i, Block->Texture, Block->Rotation, Block->ScaleX);
-	}
-	Graphics.SetDepthMask(true);
+	RenderMesh(MAPMESH_BASE, RENDERPASS_BASE);
 
 	// Draw floor layers 0-2
-	for(int i = MAPLAYER_FLOOR0; i <= MAPLAYER_FLOOR2; i++) {
-
-		for(int j = 0; j < static_cast<int>(Blocks[i].size()); j++) {
-			_Block *Block = &Blocks[i][j];
-
-			if(Block->MinZ == Block->MaxZ) {
-
-				bool Draw = true;
-				if(Block->MinZ >= 0) {
-					float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
-					Draw = Camera->IsAABBInView(Bounds);
-				}
-
-				if(Draw)
-					Graphics.DrawRepeatable((float)Block->Start.X, (float)Block->Start.Y, (float)Block->MinZ + MAP_LAYEROFFSET * i, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f, Block->MinZ + MAP_LAYEROFFSET * i, Block->Texture, Block->Rotation, Block->ScaleX);
-			}
-			else {
-				Graphics.EnableVBO(VBO_CUBE);
-				Graphics.DrawCube(
-					(float)Block->Start.X,
-					(float)Block->Start.Y,
-					(float)Block->MinZ,
-					(float)Block->End.X - Block->Start.X + 1.0f,
-					(float)Block->End.Y - Block->Start.Y + 1.0f,
-					(float)Block->MaxZ - Block->MinZ,
-					Block->Texture);
-				Graphics.DisableVBO(VBO_CUBE);
-			}
-		}
-	}
+	RenderMesh(MAPMESH_FLOOR, RENDERPASS_FLOOR);
 }
 
 // Renders the walls
 void _Map::RenderWalls() {
+	_ProfilerScope Zone("Map::RenderWalls");
+
 	if(!Camera)
 		return;
 
-	Graphics.EnableVBO(VBO_CUBE);
-
 	// Draw walls
-	for(int i = 0; i < static_cast<int>(Blocks[5].size()); i++) {
-		_Block *Block = &Blocks[5][i];
-
-		bool Draw = true;
-		if(Block->MinZ >= 0) {
-			float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
-			Draw = Camera->IsAABBInView(Bounds);
-		}
-		if(Draw)
-			Graphics.DrawCube((float)Block->Start.X, (float)Block->Start.Y, (float)Block->MinZ, (float)Block->End.X - Block->Start.X + 1.0f, (float)Block->End.Y - Block->Start.Y + 1.0f, Block->MaxZ - Block->MinZ, Block->Texture);
-	}
+	RenderMesh(MAPMESH_WALL, RENDERPASS_WALL);
 
 	// Draw flat walls
-	Graphics.SetDepthMask(false);
-	for(int i = 0; i < static_cast<int>(Blocks[4].size()); i++) {
-		_Block *Block = &Blocks[4][i];
-		bool Draw = true;
-		if(Block->MinZ >= 0) {
-			float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y + 0.0f, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
-			Draw = Camera->IsAABBInView(Bounds);
-		}
-
-		if(Draw)
-			Graphics.DrawWall((float)Block->Start.X, (float)Block->Start.Y, (float)Block->MinZ, (float)Block->End.X - Block->Start.X + 1.0f, (float)Block->End.Y - Block->Start.Y + 1.0f, Block->MaxZ - Block->MinZ, Block->Rotation, Block->Texture);
-	}
-	Graphics.SetDepthMask(true);
-
-	Graphics.DisableVBO(VBO_CUBE);
+	RenderMesh(MAPMESH_FLAT, RENDERPASS_FLAT);
 }
 
 // Draws the events
@@ -1388,42 +1836,31 @@ void _Map::RenderForeground() {
 		return;
 
 	// Draw foreground
-	for(int i = 0; i < static_cast<int>(Blocks[6].size()); i++) {
-		_Block *Block = &Blocks[6][i];
-		bool Draw = true;
-		if(Block->MinZ >= 0) {
-			float Bounds[4] = { (float)Block->Start.X, (float)Block->Start.Y, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f };
-			Draw = Camera->IsAABBInView(Bounds);
-		}
-
-		if(Draw)
-			Graphics.DrawRepeatable((float)Block->Start.X, (float)Block->Start.Y, (float)Block->MaxZ + 0.01f * i, (float)Block->End.X + 1.0f, (float)Block->End.Y + 1.0f, Block->MaxZ + 0.01f * i, Block->Texture, Block->Rotation, Block->ScaleX);
-	}
+	RenderMesh(MAPMESH_FORE, RENDERPASS_FORE);
 }
 
 // Renders the lights
-void _Map::RenderLights(const Vector2 &PlayerPosition) {
-	Graphics.DisableDepthTest();
+void _Map::RenderLights(const Vector2 &PlayerPosition, _Lights *Lights) {
+	RenderQueue.SetPass(RENDERPASS_LIGHTS);
+
+	_Color RenderAmbientLight = AmbientLight * AmbientLightBlendFactor + OldAmbientLight * (1.0 - AmbientLightBlendFactor);
+	RenderAmbientLight.Alpha = 1.0f - RenderAmbientLight.Alpha;
+
+	// Accumulate the ambient and point lights together when render targets are available
+	if(Lights) {
+		Lights->Render(Camera, AmbientLightTexture, RenderAmbientLight, PlayerPosition, AmbientLightRadius);
+		return;
+	}
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	if(AmbientLightTexture) {
-		_Color RenderAmbientLight = AmbientLight * AmbientLightBlendFactor + OldAmbientLight * (1.0 - AmbientLightBlendFactor);
-		RenderAmbientLight.Alpha = 1.0f - RenderAmbientLight.Alpha;
-		Graphics.DrawLight(PlayerPosition, AmbientLightTexture, RenderAmbientLight, AmbientLightRadius);
-	}
-	/*if(IsFiring) {
-		glBlendFunc(GL_DST_COLOR, GL_ONE);
-		Graphics.DrawLight(PlayerPosition, Assets.GetTexture("light1"),  _Color(0.922, 0.792, 0.337, 1), 50.0f);
-		//glBlendFunc(GL_DST_COLOR, GL_ONE);
-		//Graphics.DrawLight(5, 5, 0.0f, Assets.GetTexture("light1"),  _Color(1.0, 1, 1, 1), 5.0f);
-	}*/
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	Graphics.EnableDepthTest();
+		_StreamVertex *Vertices = RenderQueue.AddVertices(AmbientLightTexture->GetID(), 6);
+		Graphics.BuildQuad(Vertices, PlayerPosition.X - AmbientLightRadius, PlayerPosition.Y - AmbientLightRadius, PlayerPosition.X + AmbientLightRadius, PlayerPosition.Y + AmbientLightRadius, AmbientLightTexture->GetLeft(), AmbientLightTexture->GetTop(), AmbientLightTexture->GetRight(), AmbientLightTexture->GetBottom(), RenderAmbientLight);
+	}
 }
 
 // Update map
 void _Map::Update(double FrameTime) {
+	Pathfinder.BeginTick();
 	ObjectManager->Update(FrameTime, Camera);
 	if(AmbientLightPeriod > 0 && AmbientLightTimer <= AmbientLightPeriod) {
 		AmbientLightBlendFactor = AmbientLightTimer / AmbientLightPeriod;
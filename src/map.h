@@ -21,10 +21,18 @@
 #include <vector2.h>
 #include <coord.h>
 #include <color.h>
+#include <grid.h>
+#include <blockindex.h>
+#include <mapmesh.h>
+#include <pathfinder.h>
+#include <flowfield.h>
 #include <string>
+#include <fstream>
 #include <list>
 #include <vector>
 #include <memory>
+#include <stdexcept>
+#include <stdint.h>
 
 // Types of map layers
 enum MapLayerTypes {
@@ -38,14 +46,6 @@ enum MapLayerTypes {
 	MAPLAYER_COUNT
 };
 
-// Types of objects in the collision grid
-enum CollisionGridType {
-	GRID_PLAYER,
-	GRID_MONSTER,
-	GRID_ITEM,
-	GRID_COUNT
-};
-
 // Types of maps
 enum MapType {
 	MAPTYPE_SINGLE,
@@ -67,23 +67,25 @@ class _Item;
 class _Camera;
 class _Texture;
 class _ObjectManager;
+class _Lights;
 struct _ObjectSpawn;
 
-// Holds data for a single tile
-struct _Tile {
-	enum CollisionFlagType {
-		ENTITY = 1,
-		BULLET = 2,
-	};
+// Collision flags stored for each tile
+enum TileCollisionType {
+	TILE_ENTITY = 1,
+	TILE_BULLET = 2,
+};
 
-	_Tile() : Collision(0) { }
+// Events that overlap a tile
+struct _TileEvents {
+	_TileEvents(_Event *const *First, _Event *const *Last) : First(First), Last(Last) { }
 
-	bool CanWalk() { return !(Collision & ENTITY); }
-	bool CanShoot() { return !(Collision & BULLET); }
+	_Event *const *begin() const { return First; }
+	_Event *const *end() const { return Last; }
+	size_t size() const { return Last - First; }
 
-	std::list<_Object *> Objects[GRID_COUNT];
-	std::list<_Event *> Events;
-	int Collision;
+	_Event *const *First;
+	_Event *const *Last;
 };
 
 // Holds data for a tile bound
@@ -121,6 +123,8 @@ class _Map {
 		void Update(double FrameTime);
 
 		bool SaveLevel(const std::string &String);
+		void SetBinary(bool Value) { Binary = Value; }
+		bool IsBinary() const { return Binary; }
 		bool LoadMonsterSet(const std::string &String);
 		bool CheckCollisions(const Vector2 &TargetPosition, float Radius, Vector2 &NewPosition);
 		void CheckEntityCollisionsInGrid(const Vector2 &Position, float Radius, const _Object *SkipObject, std::list<_Entity *> &Entities) const;
@@ -132,6 +136,7 @@ class _Map {
 		bool IsVisibleWithBounds(const Vector2 &Start, const Vector2 &End, float BoundSize) const;
 		void AddObjectToGrid(_Object *Object, int Type);
 		void RemoveObjectFromGrid(_Object *Object, int Type);
+		void MoveObjectInGrid(_Object *Object, int Type, const Vector2 &OldPosition);
 
 		void ChangeMapState(const _Event *Event);
 		bool CanChangeMapState(const _Event *Event);
@@ -146,12 +151,14 @@ class _Map {
 		void RenderFloors();
 		void RenderWalls();
 		void RenderForeground();
-		void RenderLights(const Vector2 &PlayerPosition);
+		void RenderLights(const Vector2 &PlayerPosition, _Lights *Lights);
 		void RenderEvents(std::vector<_Texture *> &Textures);
 		void RenderGrid(int Mode);
 		void HighlightBlocks(int Layer);
 
-		void AddBlock(int Layer, _Block Block) { Blocks[Layer].push_back(Block); }
+		void AddBlock(int Layer, _Block Block);
+		void InvalidateLayer(int Layer);
+		void InvalidateBlock(int Layer, const _Coord &Start, const _Coord &End);
 		void AddEvent(_Event *Event) { Events.push_back(Event); }
 		void AddObject(_ObjectSpawn *Object) { ObjectSpawns.push_back(Object); }
 		const std::vector<_ObjectSpawn *> &GetObjectsList() { return ObjectSpawns; }
@@ -164,7 +171,7 @@ class _Map {
 		int GetLayerSize(int Index);
 		void ChangeLayer(int OldLayer, int NewLayer, int Index);
 		void DeleteBlockIDFromTiles(int Layer, int Index);
-		void RemoveLastBlock(int Layer) { if(Blocks[Layer].size() > 0) Blocks[Layer].pop_back(); }
+		void RemoveLastBlock(int Layer) { if(Blocks[Layer].size() > 0) { Blocks[Layer].pop_back(); InvalidateLayer(Layer); } }
 		void RemoveBlock(int Layer, int Index);
 		void RemoveEvent(int Index);
 		void RemoveObjects(std::list<std::size_t> &SelectedObjectIndices);
@@ -173,7 +180,7 @@ class _Map {
 
 		const std::string &GetFilename() const { return Filename; }
 		_Event *GetEvent(int Index) const;
-		std::list<_Event *> &GetEventList(const _Coord &Coord);
+		_TileEvents GetEventList(const _Coord &Coord) const;
 		Vector2 GetStartingPositionByCheckpoint(int Level);
 		int GetTotalBlockSize() const;
 		int GetMapType() const { return MapType; }
@@ -183,6 +190,11 @@ class _Map {
 		void GetAdjacentTile(const Vector2 &Position, float Direction, _Coord &Coord) const;
 		_Coord GetValidCoord(const _Coord &Coord) const;
 		bool CanShootThrough(int IndexX, int IndexY) const;
+		void SetFlowFieldTarget(const Vector2 &Position) { FlowField.SetTarget(GetValidCoord(Position)); }
+		void UpdateFlowField() { FlowField.Update(); }
+		bool GetFlowDirection(const Vector2 &Position, Vector2 &Direction) const { return FlowField.GetDirection(Position, Direction); }
+		int FindPath(const Vector2 &Start, const Vector2 &Goal, const std::vector<_Coord> **Waypoints) { return Pathfinder.FindPath(GetValidCoord(Start), GetValidCoord(Goal), Waypoints); }
+		bool CanWalkThrough(int IndexX, int IndexY) const { return !(TileCollision[IndexY * Width + IndexX] & TILE_ENTITY); }
 		void GetTileBounds(const Vector2 &Position, float Radius, _TileBounds &TileBounds) const;
 		const _Block *GetBlock(int Layer, const size_t Index) const;
 		Vector2 GetValidPosition(const Vector2 &Position) const;
@@ -198,6 +210,21 @@ class _Map {
 
 	private:
 
+		void LoadText(std::ifstream &InputFile);
+		void LoadBinary(const char *Data, size_t Size);
+		void CheckObjectIdentifier(int Type, const std::string &Identifier);
+		void CheckEventIdentifiers(const std::string &MonsterIdentifier, const std::string &ParticleIdentifier);
+		void SaveText(const std::string &Path);
+		void SaveBinary(const std::string &Path);
+
+		_BlockIndex &GetBlockIndex(int Layer);
+		bool IsBlockAlwaysVisible(int Layer, const _Block &Block) const;
+
+		int GetMeshPass(int Layer) const;
+		void UpdateMesh(int Pass);
+		void BuildMeshChunk(int Pass, int Chunk);
+		void RenderMesh(int Pass, int RenderPass);
+
 		bool CheckTileCollision(const Vector2 &Position, float Radius, float X, float Y, bool Resolve, Vector2 &Push, bool &DiagonalPush);
 
 		// Map
@@ -205,14 +232,25 @@ class _Map {
 		int Width;
 		int Height;
 		std::string Filename;
+		bool Binary;
+
+		// Tiles stored row-major
+		std::vector<uint8_t> TileCollision;
+		std::vector<int> TileEventStart;
+		std::vector<_Event *> TileEvents;
 
 		// Blocks
-		_Tile **Data;
 		std::vector<_Block> Blocks[MAPLAYER_COUNT];
+		_BlockIndex BlockIndex[MAPLAYER_COUNT];
+		std::vector<int> MeshBlocks;
+		_MapMesh Mesh;
 		std::vector<_Event *> Events;
 		std::vector<_Event *> CheckpointEvents;
 
 		// Objects
+		_Grid Grid;
+		_Pathfinder Pathfinder;
+		_FlowField FlowField;
 		std::unique_ptr<_ObjectManager> ObjectManager;
 		std::list<_Object *> Objects;
 		std::vector<_ObjectSpawn *> ObjectSpawns;
@@ -242,10 +280,10 @@ inline _Coord _Map::GetValidCoord(const _Coord &Coord) const {
 
 // Determines if a tile can be shot through
 inline bool _Map::CanShootThrough(int IndexX, int IndexY) const {
-	if(!Data)
+	if(TileCollision.empty())
 		throw std::runtime_error("Tile data uninitialized!");
 
-	return Data[IndexX][IndexY].CanShoot();
+	return !(TileCollision[IndexY * Width + IndexX] & TILE_BULLET);
 }
 
 // Returns a bounding rectangle
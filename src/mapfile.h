@@ -0,0 +1,103 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <map.h>
+#include <stdint.h>
+
+// Binary map file layout. All records are fixed size and referenced by offset from the start of the file.
+// Strings are stored once in a table and referenced by index, with -1 meaning empty.
+
+// Section in the file
+struct _MapFileSection {
+	uint32_t Offset;
+	uint32_t Count;
+};
+
+// File header and index
+struct _MapFileHeader {
+	char Magic[4];
+	int32_t Version;
+	int32_t MapType;
+	int32_t Width;
+	int32_t Height;
+	int32_t MonsterSet;
+	_MapFileSection Strings;
+	_MapFileSection Objects;
+	_MapFileSection Events;
+	_MapFileSection EventTiles;
+	_MapFileSection Blocks;
+	_MapFileSection Layers[MAPLAYER_COUNT];
+};
+
+// String table entry pointing into the string data
+struct _MapFileString {
+	uint32_t Offset;
+	uint32_t Length;
+};
+
+// Object spawn
+struct _MapFileObject {
+	int32_t Type;
+	int32_t Identifier;
+	float PositionX;
+	float PositionY;
+};
+
+// Event with a range of tiles
+struct _MapFileEvent {
+	double ActivationPeriod;
+	int32_t Type;
+	int32_t Active;
+	int32_t StartX;
+	int32_t StartY;
+	int32_t EndX;
+	int32_t EndY;
+	int32_t Level;
+	int32_t ItemIdentifier;
+	int32_t MonsterIdentifier;
+	int32_t ParticleIdentifier;
+	uint32_t FirstTile;
+	uint32_t TileCount;
+};
+
+// Tile affected by an event
+struct _MapFileEventTile {
+	int32_t X;
+	int32_t Y;
+	int32_t Layer;
+	int32_t BlockID;
+};
+
+// Block, stored in layer order
+struct _MapFileBlock {
+	int32_t StartX;
+	int32_t StartY;
+	int32_t EndX;
+	int32_t EndY;
+	float MinZ;
+	float MaxZ;
+	float Rotation;
+	float ScaleX;
+	int32_t Texture;
+	int32_t AltTexture;
+	uint8_t Wall;
+	uint8_t Walkable;
+	uint8_t Padding[2];
+};
@@ -0,0 +1,186 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <mapmesh.h>
+#include <graphics.h>
+#include <renderqueue.h>
+#include <camera.h>
+#include <constants.h>
+#include <algorithm>
+
+// Free vertex buffers
+_MapMesh::~_MapMesh() {
+	Clear();
+}
+
+// Delete all chunks
+void _MapMesh::Clear() {
+	for(int i = 0; i < MAPMESH_COUNT; i++) {
+		for(size_t j = 0; j < Chunks[i].size(); j++) {
+			if(Chunks[i][j].VertexBuffer)
+				Graphics.DeleteVBO(Chunks[i][j].VertexBuffer);
+		}
+
+		Chunks[i].clear();
+		DirtyChunks[i].clear();
+	}
+
+	BuildChunk = nullptr;
+}
+
+// Create empty chunks covering a map
+void _MapMesh::Init(int Width, int Height) {
+	Clear();
+
+	this->Width = Width;
+	this->Height = Height;
+	ChunksX = (Width + MAP_CHUNKSIZE - 1) / MAP_CHUNKSIZE;
+	ChunksY = (Height + MAP_CHUNKSIZE - 1) / MAP_CHUNKSIZE;
+
+	for(int i = 0; i < MAPMESH_COUNT; i++) {
+		Chunks[i].resize(ChunksX * ChunksY);
+		for(size_t j = 0; j < Chunks[i].size(); j++) {
+			Chunks[i][j].VertexBuffer = 0;
+			Chunks[i][j].AlwaysVisible = false;
+			Chunks[i][j].Dirty = false;
+		}
+
+		Invalidate(i);
+	}
+}
+
+// Mark every chunk in a pass for rebuilding
+void _MapMesh::Invalidate(int Pass) {
+	Invalidate(Pass, 0, 0, Width - 1, Height - 1);
+}
+
+// Mark chunks touching a tile range for rebuilding
+void _MapMesh::Invalidate(int Pass, int StartX, int StartY, int EndX, int EndY) {
+	if(!ChunksX)
+		return;
+
+	StartX = std::max(StartX / MAP_CHUNKSIZE, 0);
+	StartY = std::max(StartY / MAP_CHUNKSIZE, 0);
+	EndX = std::min(EndX / MAP_CHUNKSIZE, ChunksX - 1);
+	EndY = std::min(EndY / MAP_CHUNKSIZE, ChunksY - 1);
+	for(int j = StartY; j <= EndY; j++) {
+		for(int i = StartX; i <= EndX; i++) {
+			int Index = j * ChunksX + i;
+			if(!Chunks[Pass][Index].Dirty) {
+				Chunks[Pass][Index].Dirty = true;
+				DirtyChunks[Pass].push_back(Index);
+			}
+		}
+	}
+}
+
+// Get the tile area covered by a chunk
+void _MapMesh::GetChunkBounds(int Chunk, float *Bounds) const {
+	Bounds[0] = (float)(Chunk % ChunksX * MAP_CHUNKSIZE);
+	Bounds[1] = (float)(Chunk / ChunksX * MAP_CHUNKSIZE);
+	Bounds[2] = std::min(Bounds[0] + MAP_CHUNKSIZE, (float)Width);
+	Bounds[3] = std::min(Bounds[1] + MAP_CHUNKSIZE, (float)Height);
+}
+
+// Start rebuilding a chunk
+void _MapMesh::BeginChunk(int Pass, int Chunk) {
+	BuildChunk = &Chunks[Pass][Chunk];
+	BuildChunk->Batches.clear();
+	BuildChunk->AlwaysVisible = false;
+	BuildChunk->Dirty = false;
+	GetChunkBounds(Chunk, BuildChunk->Bounds);
+}
+
+// Get the vertex list for the next piece of geometry, keeping draw order wherever pieces overlap
+std::vector<float> &_MapMesh::AddPiece(const _Texture *Texture, bool Cull, bool AlwaysVisible, const float *Bounds) {
+	std::vector<_MapMeshBatch> &Batches = BuildChunk->Batches;
+
+	// Find the last batch with the same state
+	int Index = -1;
+	for(int i = (int)Batches.size() - 1; i >= 0; i--) {
+		if(Batches[i].Texture == Texture && Batches[i].Cull == Cull) {
+			Index = i;
+			break;
+		}
+	}
+
+	// Joining it must not move the piece in front of anything it overlaps
+	for(int i = Index + 1; Index != -1 && i < (int)Batches.size(); i++) {
+		const std::vector<float> &Rects = Batches[i].Rects;
+		for(size_t j = 0; j < Rects.size(); j += 4) {
+			if(Bounds[0] < Rects[j + 2] && Bounds[2] > Rects[j] && Bounds[1] < Rects[j + 3] && Bounds[3] > Rects[j + 1]) {
+				Index = -1;
+				break;
+			}
+		}
+	}
+
+	if(Index == -1) {
+		Batches.resize(Batches.size() + 1);
+		Index = (int)Batches.size() - 1;
+		Batches[Index].Texture = Texture;
+		Batches[Index].Cull = Cull;
+	}
+
+	// Grow chunk bounds for geometry extending past it
+	BuildChunk->Bounds[0] = std::min(BuildChunk->Bounds[0], Bounds[0]);
+	BuildChunk->Bounds[1] = std::min(BuildChunk->Bounds[1], Bounds[1]);
+	BuildChunk->Bounds[2] = std::max(BuildChunk->Bounds[2], Bounds[2]);
+	BuildChunk->Bounds[3] = std::max(BuildChunk->Bounds[3], Bounds[3]);
+	if(AlwaysVisible)
+		BuildChunk->AlwaysVisible = true;
+
+	Batches[Index].Rects.insert(Batches[Index].Rects.end(), Bounds, Bounds + 4);
+
+	return Batches[Index].Vertices;
+}
+
+// Upload the chunk's batches into one vertex buffer
+void _MapMesh::EndChunk() {
+	if(BuildChunk->VertexBuffer) {
+		Graphics.DeleteVBO(BuildChunk->VertexBuffer);
+		BuildChunk->VertexBuffer = 0;
+	}
+
+	std::vector<float> Vertices;
+	for(size_t i = 0; i < BuildChunk->Batches.size(); i++) {
+		_MapMeshBatch &Batch = BuildChunk->Batches[i];
+		Batch.First = (GLint)(Vertices.size() / GRAPHICS_VERTEXSIZE);
+		Batch.Count = (GLsizei)(Batch.Vertices.size() / GRAPHICS_VERTEXSIZE);
+		Vertices.insert(Vertices.end(), Batch.Vertices.begin(), Batch.Vertices.end());
+
+		std::vector<float>().swap(Batch.Vertices);
+		std::vector<float>().swap(Batch.Rects);
+	}
+
+	if(Vertices.size())
+		BuildChunk->VertexBuffer = Graphics.CreateVBO(Vertices.data(), Vertices.size() * sizeof(float));
+
+	BuildChunk = nullptr;
+}
+
+// Queue the chunks of a pass that are in view
+void _MapMesh::Render(int Pass, const _Camera *Camera) {
+	for(size_t i = 0; i < Chunks[Pass].size(); i++) {
+		const _MapMeshChunk &Chunk = Chunks[Pass][i];
+		if(!Chunk.VertexBuffer || (!Chunk.AlwaysVisible && !Camera->IsAABBInView(Chunk.Bounds)))
+			continue;
+
+		for(size_t j = 0; j < Chunk.Batches.size(); j++)
+			RenderQueue.AddMesh(Chunk.VertexBuffer, Chunk.Batches[j].Texture, Chunk.Batches[j].First, Chunk.Batches[j].Count, Chunk.Batches[j].Cull);
+	}
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <SDL_opengl.h>
+#include <vector>
+
+// Forward Declarations
+class _Texture;
+class _Camera;
+
+// Groups of map layers baked together
+enum MapMeshPassType {
+	MAPMESH_BASE,
+	MAPMESH_FLOOR,
+	MAPMESH_WALL,
+	MAPMESH_FLAT,
+	MAPMESH_FORE,
+	MAPMESH_COUNT
+};
+
+// Range of vertices drawn with one texture
+struct _MapMeshBatch {
+	const _Texture *Texture;
+	bool Cull;
+	GLint First;
+	GLsizei Count;
+	std::vector<float> Vertices;
+	std::vector<float> Rects;
+};
+
+// Baked geometry for a square of tiles
+struct _MapMeshChunk {
+	GLuint VertexBuffer;
+	std::vector<_MapMeshBatch> Batches;
+	float Bounds[4];
+	bool AlwaysVisible;
+	bool Dirty;
+};
+
+// Static map geometry baked into per-chunk vertex buffers
+class _MapMesh {
+
+	public:
+
+		_MapMesh() : Width(0), Height(0), ChunksX(0), ChunksY(0), BuildChunk(nullptr) { }
+		~_MapMesh();
+
+		void Init(int Width, int Height);
+		bool IsInitialized(int Width, int Height) const { return ChunksX > 0 && this->Width == Width && this->Height == Height; }
+
+		void Invalidate(int Pass);
+		void Invalidate(int Pass, int StartX, int StartY, int EndX, int EndY);
+		const std::vector<int> &GetDirtyChunks(int Pass) const { return DirtyChunks[Pass]; }
+		void ClearDirtyChunks(int Pass) { DirtyChunks[Pass].clear(); }
+		void GetChunkBounds(int Chunk, float *Bounds) const;
+
+		void BeginChunk(int Pass, int Chunk);
+		std::vector<float> &AddPiece(const _Texture *Texture, bool Cull, bool AlwaysVisible, const float *Bounds);
+		void EndChunk();
+
+		void Render(int Pass, const _Camera *Camera);
+
+	private:
+
+		void Clear();
+
+		int Width, Height;
+		int ChunksX, ChunksY;
+		std::vector<_MapMeshChunk> Chunks[MAPMESH_COUNT];
+		std::vector<int> DirtyChunks[MAPMESH_COUNT];
+		_MapMeshChunk *BuildChunk;
+};
@@ -0,0 +1,131 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <vector2.h>
+#include <cstring>
+
+// Column-major 4x4 matrix matching OpenGL's layout
+class _Matrix {
+
+	public:
+
+		_Matrix();
+
+		// Utility functions
+		void SetIdentity();
+		void Translate(float X, float Y, float Z);
+		void Scale(float X, float Y, float Z);
+		void Rotate(float Degrees);
+		const float *GetData() const { return Data; }
+
+		// Projections
+		static _Matrix Ortho(float Left, float Right, float Bottom, float Top, float Near, float Far);
+		static _Matrix Frustum(float Left, float Right, float Bottom, float Top, float Near, float Far);
+
+		// Operators
+		_Matrix operator*(const _Matrix &Matrix) const;
+		float &operator[](int Index) { return Data[Index]; }
+		float operator[](int Index) const { return Data[Index]; }
+
+	private:
+
+		float Data[16];
+};
+
+// Constructor
+inline _Matrix::_Matrix() {
+	SetIdentity();
+}
+
+// Reset to the identity matrix
+inline void _Matrix::SetIdentity() {
+	memset(Data, 0, sizeof(Data));
+	Data[0] = Data[5] = Data[10] = Data[15] = 1.0f;
+}
+
+// Multiply by a translation, like glTranslatef
+inline void _Matrix::Translate(float X, float Y, float Z) {
+	for(int i = 0; i < 4; i++)
+		Data[12 + i] += Data[i] * X + Data[4 + i] * Y + Data[8 + i] * Z;
+}
+
+// Multiply by a scale, like glScalef
+inline void _Matrix::Scale(float X, float Y, float Z) {
+	for(int i = 0; i < 4; i++) {
+		Data[i] *= X;
+		Data[4 + i] *= Y;
+		Data[8 + i] *= Z;
+	}
+}
+
+// Multiply by a rotation around the z axis, like glRotatef(Degrees, 0, 0, 1)
+inline void _Matrix::Rotate(float Degrees) {
+	float Cos = std::cos(Degrees / DEGREES_IN_RADIAN);
+	float Sin = std::sin(Degrees / DEGREES_IN_RADIAN);
+	for(int i = 0; i < 4; i++) {
+		float Column0 = Data[i];
+		float Column1 = Data[4 + i];
+		Data[i] = Column0 * Cos + Column1 * Sin;
+		Data[4 + i] = Column1 * Cos - Column0 * Sin;
+	}
+}
+
+// Orthographic projection, like glOrtho
+inline _Matrix _Matrix::Ortho(float Left, float Right, float Bottom, float Top, float Near, float Far) {
+	_Matrix Matrix;
+	Matrix[0] = 2.0f / (Right - Left);
+	Matrix[5] = 2.0f / (Top - Bottom);
+	Matrix[10] = -2.0f / (Far - Near);
+	Matrix[12] = -(Right + Left) / (Right - Left);
+	Matrix[13] = -(Top + Bottom) / (Top - Bottom);
+	Matrix[14] = -(Far + Near) / (Far - Near);
+
+	return Matrix;
+}
+
+// Perspective projection, like glFrustum
+inline _Matrix _Matrix::Frustum(float Left, float Right, float Bottom, float Top, float Near, float Far) {
+	_Matrix Matrix;
+	Matrix[0] = 2.0f * Near / (Right - Left);
+	Matrix[5] = 2.0f * Near / (Top - Bottom);
+	Matrix[8] = (Right + Left) / (Right - Left);
+	Matrix[9] = (Top + Bottom) / (Top - Bottom);
+	Matrix[10] = -(Far + Near) / (Far - Near);
+	Matrix[11] = -1.0f;
+	Matrix[14] = -2.0f * Far * Near / (Far - Near);
+	Matrix[15] = 0.0f;
+
+	return Matrix;
+}
+
+// Matrix product
+inline _Matrix _Matrix::operator*(const _Matrix &Matrix) const {
+	_Matrix Result;
+	for(int Column = 0; Column < 4; Column++) {
+		for(int Row = 0; Row < 4; Row++) {
+			float Sum = 0.0f;
+			for(int k = 0; k < 4; k++)
+				Sum += Data[k * 4 + Row] * Matrix.Data[Column * 4 + k];
+			Result.Data[Column * 4 + Row] = Sum;
+		}
+	}
+
+	return Result;
+}
@@ -18,6 +18,7 @@
 #include <objectmanager.h>
 #include <objects/object.h>
 #include <camera.h>
+#include <renderqueue.h>
 
 // Constructor
 _ObjectManager::_ObjectManager() {
@@ -74,14 +75,17 @@ void _ObjectManager::Update(double FrameTime, const _Camera *Camera) {
 void _ObjectManager::Render(double BlendFactor) {
 
 	// Draw items
+	RenderQueue.SetPass(RENDERPASS_OBJECTS, 0);
 	for(auto Iterator : ItemRenderList[0])
 		Iterator->Render(BlendFactor);
 
 	// Draw player
+	RenderQueue.SetPass(RENDERPASS_OBJECTS, 1);
 	for(auto Iterator : ItemRenderList[1])
 		Iterator->Render(BlendFactor);
 
 	// Draw monsters
+	RenderQueue.SetPass(RENDERPASS_OBJECTS, 2);
 	for(auto Iterator : ItemRenderList[2])
 		Iterator->Render(BlendFactor);
 }
@@ -16,7 +16,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <objects/entity.h>
-#include <graphics.h>
+#include <renderqueue.h>
 #include <audio.h>
 #include <map.h>
 #include <animation.h>
@@ -293,7 +293,9 @@ void _Entity::Move() {
 					NewDirection = Delta;
 				}
 				else {
+					Vector2 OldPosition = Position;
 					Position = Goal;
+					Map->MoveObjectInGrid(this, (Type == _Object::PLAYER) ? GRID_PLAYER : GRID_MONSTER, OldPosition);
 				}
 			break;
 			case MOVE_FORWARD:
@@ -374,18 +376,16 @@ void _Entity::Move() {
 
 			int AltGridType = (Type == _Object::PLAYER) ? GRID_PLAYER : GRID_MONSTER;
 
-			// Update grid and position
-			Map->RemoveObjectFromGrid(this, AltGridType);
-
 			// Check for updated tile position
 			_Coord LastTilePosition = Map->GetValidCoord(Position);
 			_Coord TilePosition = Map->GetValidCoord(NewPosition);
 			if(TilePosition != LastTilePosition)
 				TileChanged = true;
 
+			// Update grid and position
+			Vector2 OldPosition = Position;
 			Position = NewPosition;
-
-			Map->AddObjectToGrid(this, AltGridType);
+			Map->MoveObjectInGrid(this, AltGridType, OldPosition);
 
 			PositionChanged = true;
 		}
@@ -403,7 +403,7 @@ void _Entity::Move() {
 void _Entity::Render(double BlendFactor) {
 	Vector2 DrawPosition(Position * BlendFactor + LastPosition * (1.0f - BlendFactor));
 
-	Graphics.DrawTexture(DrawPosition[0], DrawPosition[1], PositionZ, Animation->GetCurrentFrame(), Color, Rotation, Scale, Scale);
+	RenderQueue.AddSprite(DrawPosition[0], DrawPosition[1], PositionZ, Animation->GetCurrentFrame(), Color, Rotation, Scale, Scale);
 }
 
 // Updates the Entity's maximum health
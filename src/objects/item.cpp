@@ -16,7 +16,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <objects/item.h>
-#include <graphics.h>
+#include <renderqueue.h>
 #include <constants.h>
 #include <buffer.h>
 
@@ -41,5 +41,5 @@ void _Item::Serialize(_Buffer &Buffer) {
 // Draws the object
 void _Item::Render(double BlendFactor) {
 
-	Graphics.DrawTexture(Position[0], Position[1], PositionZ, Texture, Color, Rotation, ITEM_SCALE, ITEM_SCALE);
+	RenderQueue.AddSprite(Position[0], Position[1], PositionZ, Texture, Color, Rotation, ITEM_SCALE, ITEM_SCALE);
 }
@@ -98,20 +98,32 @@ _Monster::_Monster(_MonsterTemplate *Monster, _Animation *Animation, const Vecto
 	// Temp
 	AITimer = 0;
 	WaitTime = 0;
+	IdleTicks = 0;
+	PlayerVisible = PlayerVisibleWithBounds = false;
 	BaseBehavior = PersonalityBaseBehaviors[PersonalityType];
 	CurrentActions = 0;
 
 	MoveDirection = Vector2(0, 0);
 
 	ReturnPosition = Vector2(-1.0f, -1.0f);
+	LastSeenPosition = Vector2(-1.0f, -1.0f);
 }
 
-// Updates the entity's states
-void _Monster::Update(double FrameTime, _Player *Player) {
+// Check if the player can be seen, only reading shared state so monsters can perceive in parallel
+void _Monster::Perceive(const _Player *Player) {
+	PlayerVisible = IsVisible(Player->GetPosition());
+	PlayerVisibleWithBounds = false;
+	if(PlayerVisible)
+		PlayerVisibleWithBounds = Map->IsVisibleWithBounds(Position, Player->GetPosition(), Radius);
+}
+
+// Updates the entity's states, acting on the last perception when thinking
+void _Monster::Update(double FrameTime, _Player *Player, bool Think) {
 	_Entity::Update(FrameTime);
 
 	BehaviorTime += FrameTime;
 	AITimer += FrameTime;
+	IdleTicks = Think ? 0 : IdleTicks + 1;
 
 	if(Player->IsDying())
 		return;
@@ -126,10 +138,24 @@ void _Monster::Update(double FrameTime, _Player *Player) {
 	// Update animation
 	UpdateAnimation(FrameTime);
 
-	bool PlayerVisible = IsVisible(Player->GetPosition());
-	bool PlayerVisibleWithBounds = false;
-	if(PlayerVisible)
-		PlayerVisibleWithBounds = Map->IsVisibleWithBounds(Position, Player->GetPosition(), Radius);
+	// Keep moving on the last decision
+	if(!Think) {
+		if(IsDying())
+			return;
+
+		if(!(CurrentActions & AI_LOOKING) && PersonalityType != PERSONALITY_TREASURE) {
+			if(GetMoveState() == MOVE_DIRECTION)
+				FacePosition(MoveDirection+Position);
+			else if(MoveState == MOVE_GOAL)
+				FacePosition(GetGoal());
+		}
+
+		CheckGoal();
+		if(!(CurrentActions & AI_ATTACKING))
+			Move();
+
+		return;
+	}
 
 	if(Player->IsDying()) {
 		PlayerVisible = PlayerVisibleWithBounds = false;
@@ -186,6 +212,11 @@ void _Monster::Update(double FrameTime, _Player *Player) {
 							BehaviorList.push_front(MONSTER_EXPLORE | MONSTER_INVESTIGATE | MONSTER_ATTACK);
 							break;
 
+						case PERSONALITY_GUARD:
+							// Return to post
+							BehaviorList.push_front(MONSTER_MOVE | MONSTER_INVESTIGATE | MONSTER_ATTACK);
+							break;
+
 					}
 
 					BehaviorTime = 0;
@@ -315,6 +346,36 @@ void _Monster::Update(double FrameTime, _Player *Player) {
 	}
 }
 
+// Plans a route around walls to a goal
+bool _Monster::CalcPath(const Vector2 &Goal) {
+	const std::vector<_Coord> *Waypoints;
+	if(Map->FindPath(Position, Goal, &Waypoints) != PATH_FOUND)
+		return false;
+
+	// Goals are a stack, so push the last waypoint first
+	Goals.clear();
+	AddGoal(Goal);
+	for(int i = (int)Waypoints->size() - 2; i >= 0; i--)
+		AddGoal(Vector2((*Waypoints)[i].X + 0.5f, (*Waypoints)[i].Y + 0.5f));
+
+	SetMoveState(MOVE_GOAL);
+
+	return true;
+}
+
+// Steers along the shared flow field toward the player
+bool _Monster::FollowFlowField() {
+	Vector2 Direction;
+	if(!Map->GetFlowDirection(Position, Direction))
+		return false;
+
+	Goals.clear();
+	MoveDirection = Direction;
+	SetMoveState(MOVE_DIRECTION);
+
+	return true;
+}
+
 bool _Monster::VisiblePath(const Vector2 &Goal) {
 	bool Visible = IsVisible(Goal);
 	if(Visible) {
@@ -345,7 +406,7 @@ bool _Monster::InRange(const Vector2 &Pos) {
 	return ((Position - Pos).MagnitudeSquared() <= AttackRange);
 }
 
-bool _Monster::IsVisible(const Vector2 &TargetPosition) {
+bool _Monster::IsVisible(const Vector2 &TargetPosition) const {
 	float PlayerDirection = atan2(TargetPosition[1] - Position[1], TargetPosition[0] - Position[0]) * DEGREES_IN_RADIAN + 90;
 	if(PlayerDirection < 0) PlayerDirection += 360;
 
@@ -383,13 +444,22 @@ bool _Monster::Investigate(_Player *Player, bool PlayerVisible) {
 		VisiblePath(Player->GetPosition());
 		if(ReturnPosition[0] < 0)
 			ReturnPosition = Position;
+		LastSeenPosition = Player->GetPosition();
 		CurrentActions |= AI_INVESTIGATING | AI_FOLLOWING_PLAYER | AI_FOLLOWING_PATH;
 	}
 	else if(VisiblePath(Player->GetPosition()))
 		CurrentActions |= AI_INVESTIGATING | AI_FOLLOWING_PLAYER;
-	else
+	else {
 		CurrentActions &= ~AI_FOLLOWING_PLAYER;
 
+		// Hunters track the player, others head to where the player was last seen
+		if(CurrentActions & AI_INVESTIGATING) {
+			bool Hunting = (PersonalityType == PERSONALITY_AGGRESSOR || PersonalityType == PERSONALITY_KAMIKAZE) && FollowFlowField();
+			if(!Hunting && GetMoveState() != MOVE_GOAL && LastSeenPosition[0] >= 0)
+				CalcPath(LastSeenPosition);
+		}
+	}
+
 	if(CurrentActions & AI_INVESTIGATING) {
 		if(GetMoveState() == MOVE_GOAL) {
 			// Keep moving along the path...
@@ -486,7 +556,8 @@ void _Monster::Explore() {
 bool _Monster::MovePath() {
 	if(!(CurrentActions & AI_INVESTIGATING)) {
 		if(Goals.empty() && ReturnPosition[0] >= 0) {
-			VisiblePath(ReturnPosition);
+			if(!CalcPath(ReturnPosition))
+				VisiblePath(ReturnPosition);
 			CurrentActions |= AI_MOVING | AI_FOLLOWING_PATH;
 		}
 
@@ -538,6 +609,8 @@ void _Monster::Follow(_Player *Player, bool PlayerVisible) {
 		VisiblePath(Player->GetPosition());
 		CurrentActions |= AI_FOLLOWING_PLAYER;
 	}
+	else if(!FollowFlowField() && Goals.empty())
+		CalcPath(Player->GetPosition());
 	CheckGoal();
 }
 
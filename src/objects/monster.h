@@ -79,12 +79,14 @@ class _Monster : public _Entity {
 		~_Monster();
 
 		bool CalcPath(const Vector2 &Goal);
+		bool FollowFlowField();
 		bool VisiblePath(const Vector2 &Goal);
 
 		void UpdateDirection();
 		bool Passed(const Vector2 &Pos);
-		void Update(double FrameTime, _Player *Player);
-		bool IsVisible(const Vector2 &TargetPosition);
+		void Perceive(const _Player *Player);
+		void Update(double FrameTime, _Player *Player, bool Think=true);
+		bool IsVisible(const Vector2 &TargetPosition) const;
 		bool InRange(const Vector2 &Pos);
 
 		bool Investigate(_Player *Player, bool PlayerVisible);
@@ -101,14 +103,20 @@ class _Monster : public _Entity {
 		const _ParticleTemplate *GetWeaponParticle(int Index) const;
 		std::string GetItemGroupIdentifier() const { return ItemGroupIdentifier; }
 		int64_t GetExperienceGiven() const { return ExperienceGiven; }
+		int GetIdleTicks() const { return IdleTicks; }
+		float GetViewRangeSquared() const { return ViewRangeFront; }
 		int GetBehavior() { if(BehaviorList.empty()) BehaviorList.push_front(BaseBehavior); return BehaviorList.front(); }
 
 		Vector2 ReturnPosition;
 
 	private:
 
+		Vector2 LastSeenPosition;
+		bool PlayerVisible, PlayerVisibleWithBounds;
+
 		float AITimer;
 		float WaitTime;
+		int IdleTicks;
 
 		int64_t ExperienceGiven;
 		std::string ItemGroupIdentifier;
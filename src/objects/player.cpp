@@ -17,6 +17,7 @@
 *******************************************************************************/
 #include <objects/player.h>
 #include <graphics.h>
+#include <renderqueue.h>
 #include <audio.h>
 #include <assets.h>
 #include <animation.h>
@@ -540,8 +541,8 @@ void _Player::AdjustLegDirection(float Destination) {
 void _Player::Render(double BlendFactor) {
 	Vector2 DrawPosition(Position * BlendFactor + LastPosition * (1.0 - BlendFactor));
 
-	Graphics.DrawTexture(DrawPosition[0], DrawPosition[1], PositionZ, LegAnimation->GetCurrentFrame(), Color, LegDirection, Scale, Scale);
-	Graphics.DrawTexture(DrawPosition[0], DrawPosition[1], PositionZ + 0.01f, Animation->GetCurrentFrame(), COLOR_WHITE, Rotation, Scale, Scale);
+	RenderQueue.AddSprite(DrawPosition[0], DrawPosition[1], PositionZ, LegAnimation->GetCurrentFrame(), Color, LegDirection, Scale, Scale);
+	RenderQueue.AddSprite(DrawPosition[0], DrawPosition[1], PositionZ + 0.01f, Animation->GetCurrentFrame(), COLOR_WHITE, Rotation, Scale, Scale);
 }
 
 // Draws the player in screen space
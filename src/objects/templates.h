@@ -151,6 +151,10 @@ struct _ParticleTemplate {
 	double Lifetime;
 	float ScaleAspect;
 	int Type;
+	int Priority;
+	_Color LightColor;
+	float LightRadius;
+	float LightDuration;
 };
 
 struct _WeaponParticleTemplate {
@@ -17,7 +17,6 @@
 *******************************************************************************/
 #include <objects/weapon.h>
 #include <objects/upgrade.h>
-#include <objects/particle.h>
 #include <random.h>
 #include <buffer.h>
 
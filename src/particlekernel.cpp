@@ -0,0 +1,138 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <particlekernel.h>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE__
+	#include <xmmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define PARTICLEKERNEL_HAS_AVX2
+#endif
+
+const char *ParticleKernelNames[PARTICLEKERNEL_COUNT] = {
+	"scalar",
+	"sse",
+	"avx2",
+};
+
+// Clear the expired bits that a kernel will fill
+static void ClearExpired(int Count, uint32_t *Expired) {
+	std::memset(Expired, 0, ((Count + 31) / 32) * sizeof(uint32_t));
+}
+
+// Reference implementation
+static void IntegrateScalar(const _ParticleArrays &Arrays, int Count, float FrameTime, uint32_t *Expired) {
+	ClearExpired(Count, Expired);
+	for(int i = 0; i < Count; i++) {
+		Arrays.PositionX[i] += Arrays.VelocityX[i];
+		Arrays.PositionY[i] += Arrays.VelocityY[i];
+		Arrays.VelocityX[i] += Arrays.AccelerationX[i];
+		Arrays.VelocityY[i] += Arrays.AccelerationY[i];
+		Arrays.Rotation[i] += Arrays.TurnSpeed[i];
+		Arrays.Alpha[i] = std::max(Arrays.Alpha[i] + Arrays.AlphaSpeed[i], 0.0f);
+		Arrays.Lifetime[i] -= FrameTime;
+
+		if(Arrays.Lifetime[i] < 0.0f)
+			Expired[i >> 5] |= 1u << (i & 31);
+	}
+}
+
+#ifdef __SSE__
+
+// Four particles at a time
+static void IntegrateSSE(const _ParticleArrays &Arrays, int Count, float FrameTime, uint32_t *Expired) {
+	ClearExpired(Count, Expired);
+
+	__m128 Time = _mm_set1_ps(FrameTime);
+	__m128 Zero = _mm_setzero_ps();
+	for(int i = 0; i < Count; i += 4) {
+		__m128 VelocityX = _mm_loadu_ps(Arrays.VelocityX + i);
+		__m128 VelocityY = _mm_loadu_ps(Arrays.VelocityY + i);
+		_mm_storeu_ps(Arrays.PositionX + i, _mm_add_ps(_mm_loadu_ps(Arrays.PositionX + i), VelocityX));
+		_mm_storeu_ps(Arrays.PositionY + i, _mm_add_ps(_mm_loadu_ps(Arrays.PositionY + i), VelocityY));
+		_mm_storeu_ps(Arrays.VelocityX + i, _mm_add_ps(VelocityX, _mm_loadu_ps(Arrays.AccelerationX + i)));
+		_mm_storeu_ps(Arrays.VelocityY + i, _mm_add_ps(VelocityY, _mm_loadu_ps(Arrays.AccelerationY + i)));
+		_mm_storeu_ps(Arrays.Rotation + i, _mm_add_ps(_mm_loadu_ps(Arrays.Rotation + i), _mm_loadu_ps(Arrays.TurnSpeed + i)));
+		_mm_storeu_ps(Arrays.Alpha + i, _mm_max_ps(_mm_add_ps(_mm_loadu_ps(Arrays.Alpha + i), _mm_loadu_ps(Arrays.AlphaSpeed + i)), Zero));
+
+		__m128 Lifetime = _mm_sub_ps(_mm_loadu_ps(Arrays.Lifetime + i), Time);
+		_mm_storeu_ps(Arrays.Lifetime + i, Lifetime);
+		Expired[i >> 5] |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(Lifetime, Zero)) << (i & 31);
+	}
+}
+
+#endif
+
+#ifdef PARTICLEKERNEL_HAS_AVX2
+
+// Eight particles at a time
+__attribute__((target("avx2")))
+static void IntegrateAVX2(const _ParticleArrays &Arrays, int Count, float FrameTime, uint32_t *Expired) {
+	ClearExpired(Count, Expired);
+
+	__m256 Time = _mm256_set1_ps(FrameTime);
+	__m256 Zero = _mm256_setzero_ps();
+	for(int i = 0; i < Count; i += 8) {
+		__m256 VelocityX = _mm256_loadu_ps(Arrays.VelocityX + i);
+		__m256 VelocityY = _mm256_loadu_ps(Arrays.VelocityY + i);
+		_mm256_storeu_ps(Arrays.PositionX + i, _mm256_add_ps(_mm256_loadu_ps(Arrays.PositionX + i), VelocityX));
+		_mm256_storeu_ps(Arrays.PositionY + i, _mm256_add_ps(_mm256_loadu_ps(Arrays.PositionY + i), VelocityY));
+		_mm256_storeu_ps(Arrays.VelocityX + i, _mm256_add_ps(VelocityX, _mm256_loadu_ps(Arrays.AccelerationX + i)));
+		_mm256_storeu_ps(Arrays.VelocityY + i, _mm256_add_ps(VelocityY, _mm256_loadu_ps(Arrays.AccelerationY + i)));
+		_mm256_storeu_ps(Arrays.Rotation + i, _mm256_add_ps(_mm256_loadu_ps(Arrays.Rotation + i), _mm256_loadu_ps(Arrays.TurnSpeed + i)));
+		_mm256_storeu_ps(Arrays.Alpha + i, _mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(Arrays.Alpha + i), _mm256_loadu_ps(Arrays.AlphaSpeed + i)), Zero));
+
+		__m256 Lifetime = _mm256_sub_ps(_mm256_loadu_ps(Arrays.Lifetime + i), Time);
+		_mm256_storeu_ps(Arrays.Lifetime + i, Lifetime);
+		Expired[i >> 5] |= (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(Lifetime, Zero, _CMP_LT_OQ)) << (i & 31);
+	}
+}
+
+#endif
+
+// Get a kernel, or nullptr if it isn't available on this build or CPU
+_ParticleKernel GetParticleKernel(int Type) {
+	switch(Type) {
+		case PARTICLEKERNEL_SCALAR:
+			return IntegrateScalar;
+#ifdef __SSE__
+		case PARTICLEKERNEL_SSE:
+			return IntegrateSSE;
+#endif
+#ifdef PARTICLEKERNEL_HAS_AVX2
+		case PARTICLEKERNEL_AVX2:
+			if(__builtin_cpu_supports("avx2"))
+				return IntegrateAVX2;
+		break;
+#endif
+	}
+
+	return nullptr;
+}
+
+// Get the widest kernel the CPU supports
+int GetBestParticleKernel() {
+	for(int i = PARTICLEKERNEL_COUNT - 1; i > 0; i--) {
+		if(GetParticleKernel(i))
+			return i;
+	}
+
+	return PARTICLEKERNEL_SCALAR;
+}
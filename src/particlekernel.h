@@ -0,0 +1,50 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <stdint.h>
+
+// Particle arrays integrated by the kernels, padded to a multiple of PARTICLEKERNEL_WIDTH
+struct _ParticleArrays {
+	float *PositionX, *PositionY;
+	float *VelocityX, *VelocityY;
+	float *AccelerationX, *AccelerationY;
+	float *Rotation, *TurnSpeed;
+	float *Alpha, *AlphaSpeed;
+	float *Lifetime;
+};
+
+// Kernel implementations
+enum ParticleKernelType {
+	PARTICLEKERNEL_SCALAR,
+	PARTICLEKERNEL_SSE,
+	PARTICLEKERNEL_AVX2,
+	PARTICLEKERNEL_COUNT
+};
+
+// Widest group of particles a kernel handles at once
+const int PARTICLEKERNEL_WIDTH = 8;
+
+// Integrates Count particles and sets a bit in Expired for each one whose lifetime ran out
+typedef void (*_ParticleKernel)(const _ParticleArrays &Arrays, int Count, float FrameTime, uint32_t *Expired);
+
+extern const char *ParticleKernelNames[PARTICLEKERNEL_COUNT];
+
+_ParticleKernel GetParticleKernel(int Type);
+int GetBestParticleKernel();
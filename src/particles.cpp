@@ -16,80 +16,386 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <particles.h>
+#include <decals.h>
+#include <lights.h>
+#include <profiler.h>
 #include <objects/templates.h>
-#include <objects/particle.h>
+#include <graphics.h>
+#include <renderqueue.h>
+#include <texture.h>
 #include <camera.h>
+#include <constants.h>
+#include <random.h>
+#include <algorithm>
+#include <cmath>
+
+static_assert(PARTICLES_CAPACITY % PARTICLEKERNEL_WIDTH == 0, "Particle capacity must be a multiple of the kernel width");
 
 // Constructor
 _Particles::_Particles()
-:	Camera(nullptr) {
-}
+:	Count(0),
+	PositionX(PARTICLES_CAPACITY), PositionY(PARTICLES_CAPACITY),
+	VelocityX(PARTICLES_CAPACITY), VelocityY(PARTICLES_CAPACITY),
+	AccelerationX(PARTICLES_CAPACITY), AccelerationY(PARTICLES_CAPACITY),
+	Rotation(PARTICLES_CAPACITY), TurnSpeed(PARTICLES_CAPACITY),
+	Alpha(PARTICLES_CAPACITY), AlphaSpeed(PARTICLES_CAPACITY),
+	Lifetime(PARTICLES_CAPACITY),
+	Styles(PARTICLES_CAPACITY),
+	Expired(PARTICLES_CAPACITY / 32),
+	Kernel(nullptr),
+	ParticleRandom(Random.Generate(0xffffffff)),
+	Budget(PARTICLES_CAPACITY),
+	DroppedCount(0),
+	EvictedCount(0),
+	Camera(nullptr),
+	Decals(nullptr),
+	Lights(nullptr) {
+
+	Arrays.PositionX = PositionX.data();
+	Arrays.PositionY = PositionY.data();
+	Arrays.VelocityX = VelocityX.data();
+	Arrays.VelocityY = VelocityY.data();
+	Arrays.AccelerationX = AccelerationX.data();
+	Arrays.AccelerationY = AccelerationY.data();
+	Arrays.Rotation = Rotation.data();
+	Arrays.TurnSpeed = TurnSpeed.data();
+	Arrays.Alpha = Alpha.data();
+	Arrays.AlphaSpeed = AlphaSpeed.data();
+	Arrays.Lifetime = Lifetime.data();
+	SetKernel(GetBestParticleKernel());
+
+	for(int i = 0; i < COUNT; i++)
+		RenderList[i].reserve(PARTICLES_CAPACITY);
 
-// Destructor
-_Particles::~_Particles() {
 	Clear();
 }
 
+// Remove all particles
+void _Particles::Clear() {
+	Count = 0;
+	Settled.clear();
+	for(int i = 0; i < PARTICLES_PRIORITIES; i++)
+		PriorityCounts[i] = 0;
+}
+
+// Set the most particles kept after each update
+void _Particles::SetBudget(int Budget) {
+	this->Budget = std::min(std::max(Budget, 0), PARTICLES_CAPACITY);
+}
+
 // Update all particles
 void _Particles::Update(double FrameTime) {
+	_ProfilerScope Zone("Particles::Update");
 
-	// Clear render list
-	for(int i = 0; i < COUNT; i++)
-		RenderList[i].clear();
+	// Integrate
+	Kernel(Arrays, Count, (float)FrameTime, Expired.data());
 
-	// Update all particles
-	for(auto Iterator = Particles.begin(); Iterator != Particles.end(); ) {
-		_Particle *Particle = *Iterator;
+	// Remove expired particles, carrying the moved particle's bit along
+	for(int i = 0; i < Count; ) {
 
-		// Update
-		Particle->Update(FrameTime);
+		// Skip groups with nothing to remove
+		if(!(i & 31) && !Expired[i >> 5]) {
+			i += 32;
+			continue;
+		}
 
-		// Delete
-		if(Particle->IsDeleted()) {
-			delete Particle;
-			Iterator = Particles.erase(Iterator);
+		uint32_t Bit = 1u << (i & 31);
+		if(Expired[i >> 5] & Bit) {
+			int Last = Count - 1;
+			bool LastExpired = Expired[Last >> 5] & (1u << (Last & 31));
+			Remove(i);
+			if(!LastExpired)
+				Expired[i >> 5] &= ~Bit;
 		}
-		else {
+		else
+			i++;
+	}
 
-			if(Camera->IsCircleInView(Particle->GetPosition(), Particle->GetRadius())) {
-				RenderList[Particle->GetType()].push_back(Particle);
-			}
+	EnforceBudget();
+	BuildRenderLists();
+
+	Profiler.SetCounter("Particles", Count);
+	Profiler.SetCounter("Particles dropped", DroppedCount);
+	Profiler.SetCounter("Particles evicted", EvictedCount);
+}
+
+// Evict the lowest priority particles, soonest to expire first, until within budget
+void _Particles::EnforceBudget() {
+	int Excess = Count - Budget;
+	if(Excess <= 0)
+		return;
+
+	Victims.clear();
+	for(int Priority = 0; Priority < PARTICLES_PRIORITIES && Excess > 0; Priority++) {
+		if(!PriorityCounts[Priority])
+			continue;
 
-			++Iterator;
+		Candidates.clear();
+		for(int i = 0; i < Count; i++) {
+			if(Styles[i].Priority == Priority)
+				Candidates.push_back(std::make_pair(Lifetime[i], i));
 		}
+
+		if((int)Candidates.size() > Excess) {
+			std::nth_element(Candidates.begin(), Candidates.begin() + Excess, Candidates.end());
+			Candidates.resize(Excess);
+		}
+
+		for(const auto &Candidate : Candidates)
+			Victims.push_back(Candidate.second);
+		Excess -= (int)Candidates.size();
 	}
+
+	// Remove from the back so moved particles are never victims
+	std::sort(Victims.begin(), Victims.end());
+	for(auto Iterator = Victims.rbegin(); Iterator != Victims.rend(); ++Iterator)
+		Remove(*Iterator);
+
+	EvictedCount += (int)Victims.size();
 }
 
-// Render
-void _Particles::Render(int Type) {
-	for(auto Iterator : RenderList[Type])
-		Iterator->Render();
+// Build render lists and find decals ready for baking
+void _Particles::BuildRenderLists() {
+	for(int i = 0; i < COUNT; i++)
+		RenderList[i].clear();
+
+	Settled.clear();
+	for(int i = 0; i < Count; i++) {
+		const _ParticleStyle &Style = Styles[i];
+		if(IsSettled(i))
+			Settled.push_back(i);
+		else if(Camera->IsCircleInView(Vector2(PositionX[i], PositionY[i]), std::max(Style.Scale.X, Style.Scale.Y)))
+			RenderList[Style.Type].push_back(i);
+	}
 }
 
-// Deletes all
-void _Particles::Clear() {
-	for(auto Iterator : Particles)
-		delete Iterator;
+// Decals that no longer move and will outlive the bake threshold
+bool _Particles::IsSettled(int Index) const {
+	if(!Decals || Styles[Index].Type == NORMAL || !Styles[Index].Texture)
+		return false;
+
+	return VelocityX[Index] == 0.0f && VelocityY[Index] == 0.0f
+		&& AccelerationX[Index] == 0.0f && AccelerationY[Index] == 0.0f
+		&& TurnSpeed[Index] == 0.0f
+		&& Lifetime[Index] >= DECALS_BAKELIFETIME;
+}
+
+// Move settled decals into the decal textures and free their slots, then re-bake chunks that faded
+void _Particles::BakeDecals() {
+	if(!Decals)
+		return;
+
+	_ProfilerScope Zone("Particles::BakeDecals");
+
+	if(Settled.empty()) {
+		Decals->Refresh(Camera);
+		return;
+	}
+
+	for(int Type = FLOOR_DECALS; Type <= WALL_DECALS; Type++) {
+		BakeQuads.clear();
+		for(auto Index : Settled) {
+			if(Styles[Index].Type != Type)
+				continue;
 
-	Particles.clear();
+			// Alpha speed is applied once per tick
+			_DecalQuad Quad;
+			BuildQuad(Index, Quad.Vertices);
+			Quad.Texture = Styles[Index].Texture->GetID();
+			Quad.AlphaRate = AlphaSpeed[Index] / (float)GAME_TIMESTEP;
+			Quad.Lifetime = Lifetime[Index];
+			BakeQuads.push_back(Quad);
+		}
+
+		if(!BakeQuads.empty())
+			Decals->Bake(Type == FLOOR_DECALS ? DECAL_FLOOR : DECAL_WALL, BakeQuads);
+	}
+	Decals->Refresh(Camera);
+
+	// Remove from the back so moved particles are never settled ones
+	for(auto Iterator = Settled.rbegin(); Iterator != Settled.rend(); ++Iterator)
+		Remove(*Iterator);
+
+	BuildRenderLists();
 }
 
-// Add an existing particle
-void _Particles::Add(_Particle *Particle) {
-	if(!Particle)
+// Queue all visible particles of a type, one packet per texture
+void _Particles::Render(int Type) {
+	_ProfilerScope Zone("Particles::Render");
+
+	static const int Passes[COUNT] = { RENDERPASS_PARTICLES, RENDERPASS_FLOORDECALS, RENDERPASS_WALLDECALS };
+	RenderQueue.SetPass(Passes[Type]);
+
+	// Draw baked decals underneath
+	if(Decals && Type != NORMAL)
+		Decals->Render(Type == FLOOR_DECALS ? DECAL_FLOOR : DECAL_WALL, Camera);
+
+	// Sort by texture
+	DrawOrder.clear();
+	for(auto Index : RenderList[Type]) {
+		if(Styles[Index].Texture)
+			DrawOrder.push_back(std::make_pair(Styles[Index].Texture->GetID(), Index));
+	}
+	if(DrawOrder.empty())
 		return;
 
-	Particles.push_back(Particle);
+	std::sort(DrawOrder.begin(), DrawOrder.end());
+
+	// Build pre-transformed quads for each run of the same texture
+	int Blend = Type == NORMAL ? RENDERBLEND_ADDITIVE : RENDERBLEND_ALPHA;
+	size_t Start = 0;
+	for(size_t i = 1; i <= DrawOrder.size(); i++) {
+		if(i == DrawOrder.size() || DrawOrder[i].first != DrawOrder[Start].first) {
+			_StreamVertex *Vertex = RenderQueue.AddVertices(DrawOrder[Start].first, (int)((i - Start) * 6), Blend);
+			for(size_t j = Start; j < i; j++) {
+				BuildQuad(DrawOrder[j].second, Vertex);
+				Vertex += 6;
+			}
+			Start = i;
+		}
+	}
+}
+
+// Write the six vertices of a particle's quad
+void _Particles::BuildQuad(int Index, _StreamVertex *Vertex) const {
+	static const float Corners[4][4] = {
+		{ -0.5f,  0.5f, 0.0f, 1.0f },
+		{  0.5f,  0.5f, 1.0f, 1.0f },
+		{ -0.5f, -0.5f, 0.0f, 0.0f },
+		{  0.5f, -0.5f, 1.0f, 0.0f },
+	};
+	static const int Triangles[6] = { 0, 1, 2, 2, 1, 3 };
+
+	const _ParticleStyle &Style = Styles[Index];
+	float Radians = Rotation[Index] / DEGREES_IN_RADIAN;
+	float Cos = std::cos(Radians);
+	float Sin = std::sin(Radians);
+	uint8_t Red = GetColorByte(Style.Color.Red);
+	uint8_t Green = GetColorByte(Style.Color.Green);
+	uint8_t Blue = GetColorByte(Style.Color.Blue);
+	uint8_t AlphaByte = GetColorByte(Alpha[Index]);
+
+	for(int i = 0; i < 6; i++) {
+		const float *Corner = Corners[Triangles[i]];
+		float X = Corner[0] * Style.Scale.X;
+		float Y = Corner[1] * Style.Scale.Y;
+		Vertex->X = PositionX[Index] + X * Cos - Y * Sin;
+		Vertex->Y = PositionY[Index] + X * Sin + Y * Cos;
+		Vertex->Z = Style.PositionZ;
+		Vertex->U = Style.Texture ? Style.Texture->GetU(Corner[2]) : Corner[2];
+		Vertex->V = Style.Texture ? Style.Texture->GetV(Corner[3]) : Corner[3];
+		Vertex->Red = Red;
+		Vertex->Green = Green;
+		Vertex->Blue = Blue;
+		Vertex->Alpha = AlphaByte;
+		Vertex++;
+	}
+}
+
+// Choose the integration kernel, falling back to scalar if unsupported
+void _Particles::SetKernel(int Type) {
+	Kernel = GetParticleKernel(Type);
+	if(!Kernel)
+		Kernel = GetParticleKernel(PARTICLEKERNEL_SCALAR);
 }
 
-// Spawn a particle
+// Spawn particles from a template
 void _Particles::Create(const _ParticleSpawn &Spawn) {
 	if(!Spawn.Template)
 		return;
 
-	// Add particles
-	for(int i = 0; i < Spawn.Template->Count; i++) {
-		_Particle *Particle = new _Particle(Spawn);
-		Particles.push_back(Particle);
+	const _ParticleTemplate *Template = Spawn.Template;
+	if(Lights && Template->LightRadius > 0.0f)
+		Lights->Add(Spawn.Position, Template->LightRadius, Template->LightColor, Template->LightDuration);
+
+	int SpawnCount = GetSpawnCount(Spawn);
+	DroppedCount += Template->Count - SpawnCount;
+	for(int i = 0; i < SpawnCount; i++) {
+
+		// Over budget spawns must be able to displace something less important
+		if(Count >= PARTICLES_CAPACITY || (Count >= Budget && !HasLowerPriority(Template->Priority))) {
+			DroppedCount += SpawnCount - i;
+			break;
+		}
+
+		int Index = Count++;
+		PriorityCounts[Template->Priority]++;
+
+		// Random
+		float Direction = Spawn.RotationAdjust + static_cast<float>(ParticleRandom.GenerateRange(Template->StartDirection[0], Template->StartDirection[1]));
+		Vector2 Velocity = Vector2(Direction) * ParticleRandom.GenerateRange(Template->VelocityScale[0], Template->VelocityScale[1]);
+		Vector2 Acceleration = Velocity * Template->AccelerationScale;
+		float Turn = ParticleRandom.GenerateRange(Template->TurnSpeed[0], Template->TurnSpeed[1]);
+		float Size = ParticleRandom.GenerateRange(Template->Size[0], Template->Size[1]);
+
+		PositionX[Index] = Spawn.Position.X;
+		PositionY[Index] = Spawn.Position.Y;
+		VelocityX[Index] = Velocity.X;
+		VelocityY[Index] = Velocity.Y;
+		AccelerationX[Index] = Acceleration.X;
+		AccelerationY[Index] = Acceleration.Y;
+		Rotation[Index] = Direction;
+		TurnSpeed[Index] = Turn;
+		Alpha[Index] = Template->Color.Alpha;
+		AlphaSpeed[Index] = Template->AlphaSpeed;
+		Lifetime[Index] = (float)(Spawn.Lifetime >= 0.0 ? Spawn.Lifetime : Template->Lifetime);
+
+		_ParticleStyle &Style = Styles[Index];
+		Style.Texture = Template->Texture;
+		Style.Color = Template->Color;
+		Style.PositionZ = Spawn.PositionZ;
+		Style.Type = Template->Type;
+		Style.Priority = Template->Priority;
+		if(Template->ScaleAspect >= 1.0f)
+			Style.Scale = Vector2(Size, Size / Template->ScaleAspect);
+		else
+			Style.Scale = Vector2(Size * Template->ScaleAspect, Size);
+	}
+}
+
+// Scale down the number spawned outside the view, fading to none at PARTICLES_LODRANGE
+int _Particles::GetSpawnCount(const _ParticleSpawn &Spawn) const {
+	const _ParticleTemplate *Template = Spawn.Template;
+	if(Template->Type != NORMAL || !Camera)
+		return Template->Count;
+
+	const float *AABB = Camera->GetAABB();
+	float DeltaX = std::max(std::max(AABB[0] - Spawn.Position.X, Spawn.Position.X - AABB[2]), 0.0f);
+	float DeltaY = std::max(std::max(AABB[1] - Spawn.Position.Y, Spawn.Position.Y - AABB[3]), 0.0f);
+	float Distance = std::sqrt(DeltaX * DeltaX + DeltaY * DeltaY);
+	if(Distance >= PARTICLES_LODRANGE)
+		return 0;
+
+	return (int)std::ceil(Template->Count * (1.0f - Distance / PARTICLES_LODRANGE));
+}
+
+// Determine if any particle has a lower priority
+bool _Particles::HasLowerPriority(int Priority) const {
+	for(int i = 0; i < Priority; i++) {
+		if(PriorityCounts[i])
+			return true;
 	}
+
+	return false;
+}
+
+// Remove a particle by moving the last one into its place
+void _Particles::Remove(int Index) {
+	PriorityCounts[Styles[Index].Priority]--;
+	int Last = --Count;
+	if(Index == Last)
+		return;
+
+	PositionX[Index] = PositionX[Last];
+	PositionY[Index] = PositionY[Last];
+	VelocityX[Index] = VelocityX[Last];
+	VelocityY[Index] = VelocityY[Last];
+	AccelerationX[Index] = AccelerationX[Last];
+	AccelerationY[Index] = AccelerationY[Last];
+	Rotation[Index] = Rotation[Last];
+	TurnSpeed[Index] = TurnSpeed[Last];
+	Alpha[Index] = Alpha[Last];
+	AlphaSpeed[Index] = AlphaSpeed[Last];
+	Lifetime[Index] = Lifetime[Last];
+	Styles[Index] = Styles[Last];
 }
@@ -19,27 +19,46 @@
 
 // Libraries
 #include <vector2.h>
-#include <list>
+#include <color.h>
+#include <particlekernel.h>
+#include <graphics.h>
+#include <decals.h>
+#include <random.h>
+#include <constants.h>
+#include <vector>
 
 // Forward Declarations
 class _Camera;
-class _Particle;
+class _Texture;
+class _Lights;
 struct _ParticleTemplate;
 
 struct _ParticleSpawn {
-	_ParticleSpawn(const _ParticleTemplate *Template, const Vector2 &Position, float PositionZ, float RotationAdjust)
+	_ParticleSpawn(const _ParticleTemplate *Template, const Vector2 &Position, float PositionZ, float RotationAdjust, double Lifetime=-1.0)
 		:	Template(Template),
 			Position(Position),
 			PositionZ(PositionZ),
-			RotationAdjust(RotationAdjust) { }
+			RotationAdjust(RotationAdjust),
+			Lifetime(Lifetime) { }
 
 	const _ParticleTemplate *Template;
 	Vector2 Position;
 	float PositionZ;
 	float RotationAdjust;
+	double Lifetime;
 };
 
-// Manages all the objects
+// Attributes only needed for drawing
+struct _ParticleStyle {
+	const _Texture *Texture;
+	_Color Color;
+	Vector2 Scale;
+	float PositionZ;
+	int Type;
+	int Priority;
+};
+
+// Manages all particles in fixed size arrays
 class _Particles {
 
 	public:
@@ -52,28 +71,70 @@ class _Particles {
 		};
 
 		_Particles();
-		~_Particles();
 
 		// Updates
 		void Update(double FrameTime);
 		void Render(int Type);
+		void BakeDecals();
 
 		// Management
-		void Add(_Particle *Particle);
 		void Create(const _ParticleSpawn &Spawn);
 		void Clear();
 
+		int GetCount() const { return Count; }
+		int GetDroppedCount() const { return DroppedCount; }
+		int GetEvictedCount() const { return EvictedCount; }
+		void SetBudget(int Budget);
+		int GetBudget() const { return Budget; }
+		void SetKernel(int Type);
 		void SetCamera(const _Camera *Camera) { this->Camera = Camera; }
 		const _Camera *GetCamera() const { return Camera; }
+		void SetDecals(_Decals *Decals) { this->Decals = Decals; }
+		void SetLights(_Lights *Lights) { this->Lights = Lights; }
 
 	private:
 
-		// Objects
-		std::list<_Particle *> Particles;
+		void Remove(int Index);
+		void EnforceBudget();
+		int GetSpawnCount(const _ParticleSpawn &Spawn) const;
+		bool HasLowerPriority(int Priority) const;
+		void BuildRenderLists();
+		void BuildQuad(int Index, _StreamVertex *Vertex) const;
+		bool IsSettled(int Index) const;
+
+		// Simulation
+		int Count;
+		std::vector<float> PositionX, PositionY;
+		std::vector<float> VelocityX, VelocityY;
+		std::vector<float> AccelerationX, AccelerationY;
+		std::vector<float> Rotation, TurnSpeed;
+		std::vector<float> Alpha, AlphaSpeed;
+		std::vector<float> Lifetime;
+		std::vector<_ParticleStyle> Styles;
+		std::vector<uint32_t> Expired;
+		_ParticleArrays Arrays;
+		_ParticleKernel Kernel;
+		_Random ParticleRandom;
+
+		// Budget
+		int Budget;
+		int PriorityCounts[PARTICLES_PRIORITIES];
+		int DroppedCount;
+		int EvictedCount;
+		std::vector<std::pair<float, int>> Candidates;
+		std::vector<int> Victims;
 
 		// Rendering
-		std::list<_Particle *> RenderList[COUNT];
+		std::vector<int> RenderList[COUNT];
+		std::vector<std::pair<GLuint, int>> DrawOrder;
+		std::vector<_StreamVertex> Vertices;
+
+		// Decals waiting to be baked
+		std::vector<int> Settled;
+		std::vector<_DecalQuad> BakeQuads;
 
 		// Graphics
 		const _Camera *Camera;
+		_Decals *Decals;
+		_Lights *Lights;
 };
@@ -0,0 +1,159 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <pathfinder.h>
+#include <constants.h>
+#include <algorithm>
+#include <cmath>
+
+// Allocate node pools for a map
+void _Pathfinder::Init(const _Map *Map, int Width, int Height) {
+	Grid.Init(Map, Width, Height);
+
+	G.assign(Width * Height, 0.0f);
+	Parent.assign(Width * Height, -1);
+	OpenGeneration.assign(Width * Height, 0);
+	ClosedGeneration.assign(Width * Height, 0);
+	Open.clear();
+	Open.reserve(PATH_MAXNODES);
+	Generation = 0;
+	Budget = PATH_TICKBUDGET;
+	Cache.clear();
+}
+
+// Refill the search budget
+void _Pathfinder::BeginTick() {
+	Budget = PATH_TICKBUDGET;
+}
+
+// Find waypoints between two tiles, using the cache when possible
+int _Pathfinder::FindPath(const _Coord &Start, const _Coord &Goal, const std::vector<_Coord> **Waypoints) {
+	*Waypoints = nullptr;
+	if(!Grid.GetMap() || !Grid.IsWalkable(Start.X, Start.Y) || !Grid.IsWalkable(Goal.X, Goal.Y))
+		return PATH_NONE;
+
+	int Width = Grid.GetWidth();
+	int Height = Grid.GetHeight();
+	int StartIndex = Start.Y * Width + Start.X;
+	int GoalIndex = Goal.Y * Width + Goal.X;
+	uint64_t Key = (uint64_t)StartIndex * (uint64_t)(Width * Height) + (uint64_t)GoalIndex;
+
+	auto Iterator = Cache.find(Key);
+	if(Iterator == Cache.end()) {
+		if(Budget <= 0)
+			return PATH_DEFERRED;
+
+		if(Cache.size() >= PATH_CACHESIZE)
+			Cache.clear();
+
+		_PathCacheEntry &Entry = Cache[Key];
+		Entry.Found = Search(StartIndex, GoalIndex, Entry.Waypoints);
+		Iterator = Cache.find(Key);
+	}
+
+	if(!Iterator->second.Found)
+		return PATH_NONE;
+
+	*Waypoints = &Iterator->second.Waypoints;
+	return PATH_FOUND;
+}
+
+// Run A* and store the turning points of the path, excluding the start tile
+bool _Pathfinder::Search(int Start, int Goal, std::vector<_Coord> &Waypoints) {
+	Waypoints.clear();
+
+	// Reset pools on wrap
+	if(++Generation == 0) {
+		std::fill(OpenGeneration.begin(), OpenGeneration.end(), 0);
+		std::fill(ClosedGeneration.begin(), ClosedGeneration.end(), 0);
+		Generation = 1;
+	}
+
+	Open.clear();
+	G[Start] = 0.0f;
+	Parent[Start] = -1;
+	OpenGeneration[Start] = Generation;
+	Open.push_back({ GetHeuristic(Start, Goal), Start });
+
+	int Width = Grid.GetWidth();
+	_PathNeighbor Neighbors[8];
+	int Expanded = 0;
+	bool Found = false;
+	while(!Open.empty()) {
+		std::pop_heap(Open.begin(), Open.end(), ComparePathNodes);
+		int Index = Open.back().Index;
+		Open.pop_back();
+
+		// Skip stale entries
+		if(ClosedGeneration[Index] == Generation)
+			continue;
+
+		ClosedGeneration[Index] = Generation;
+		if(Index == Goal) {
+			Found = true;
+			break;
+		}
+
+		if(++Expanded > PATH_MAXNODES)
+			break;
+
+		int NeighborCount = Grid.GetNeighbors(Index, Neighbors);
+		for(int i = 0; i < NeighborCount; i++) {
+			int Neighbor = Neighbors[i].Index;
+			if(ClosedGeneration[Neighbor] == Generation)
+				continue;
+
+			float Cost = G[Index] + Neighbors[i].Cost;
+			if(OpenGeneration[Neighbor] != Generation || Cost < G[Neighbor]) {
+				OpenGeneration[Neighbor] = Generation;
+				G[Neighbor] = Cost;
+				Parent[Neighbor] = Index;
+				Open.push_back({ Cost + GetHeuristic(Neighbor, Goal), Neighbor });
+				std::push_heap(Open.begin(), Open.end(), ComparePathNodes);
+			}
+		}
+	}
+
+	Budget -= Expanded;
+	if(!Found)
+		return false;
+
+	// Walk back from the goal, keeping tiles where the direction changes
+	int LastDeltaX = 0, LastDeltaY = 0;
+	for(int Index = Goal; Parent[Index] != -1; Index = Parent[Index]) {
+		int Previous = Parent[Index];
+		int DeltaX = Index % Width - Previous % Width;
+		int DeltaY = Index / Width - Previous / Width;
+		if(Index == Goal || DeltaX != LastDeltaX || DeltaY != LastDeltaY)
+			Waypoints.push_back(_Coord(Index % Width, Index / Width));
+
+		LastDeltaX = DeltaX;
+		LastDeltaY = DeltaY;
+	}
+	std::reverse(Waypoints.begin(), Waypoints.end());
+
+	return true;
+}
+
+// Octile distance to the goal
+float _Pathfinder::GetHeuristic(int Index, int Goal) const {
+	int Width = Grid.GetWidth();
+	int DeltaX = std::abs(Index % Width - Goal % Width);
+	int DeltaY = std::abs(Index / Width - Goal / Width);
+
+	return (float)(DeltaX + DeltaY) + ((float)M_SQRT2 - 2.0f) * (float)std::min(DeltaX, DeltaY);
+}
@@ -0,0 +1,73 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <pathgrid.h>
+#include <vector2.h>
+#include <coord.h>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+// Outcomes of a path query
+enum PathResultType {
+	PATH_FOUND,
+	PATH_NONE,
+	PATH_DEFERRED,
+};
+
+// Cached result between two tiles
+struct _PathCacheEntry {
+	bool Found;
+	std::vector<_Coord> Waypoints;
+};
+
+// A* search over walkable map tiles
+class _Pathfinder {
+
+	public:
+
+		_Pathfinder() : Generation(0), Budget(0) { }
+
+		void Init(const _Map *Map, int Width, int Height);
+		void BeginTick();
+		void ClearCache() { Cache.clear(); }
+
+		int FindPath(const _Coord &Start, const _Coord &Goal, const std::vector<_Coord> **Waypoints);
+
+	private:
+
+		bool Search(int Start, int Goal, std::vector<_Coord> &Waypoints);
+		float GetHeuristic(int Index, int Goal) const;
+
+		_PathGrid Grid;
+
+		// Node pools reused between searches
+		std::vector<float> G;
+		std::vector<int> Parent;
+		std::vector<uint32_t> OpenGeneration;
+		std::vector<uint32_t> ClosedGeneration;
+		std::vector<_PathNode> Open;
+		uint32_t Generation;
+
+		// Nodes that can still be expanded this tick
+		int Budget;
+
+		std::unordered_map<uint64_t, _PathCacheEntry> Cache;
+};
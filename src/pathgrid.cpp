@@ -0,0 +1,60 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <pathgrid.h>
+#include <map.h>
+#include <cmath>
+
+// Steps to the eight neighbors, straight ones first
+static const int OffsetX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+static const int OffsetY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+// Set the map being searched
+void _PathGrid::Init(const _Map *Map, int Width, int Height) {
+	this->Map = Map;
+	this->Width = Width;
+	this->Height = Height;
+}
+
+// Determines if a tile can be walked on
+bool _PathGrid::IsWalkable(int X, int Y) const {
+	return X >= 0 && Y >= 0 && X < Width && Y < Height && Map->CanWalkThrough(X, Y);
+}
+
+// Get the walkable neighbors of a tile without cutting corners, returning the count
+int _PathGrid::GetNeighbors(int Index, _PathNeighbor *Neighbors) const {
+	int X = Index % Width;
+	int Y = Index / Width;
+	int Count = 0;
+	for(int i = 0; i < 8; i++) {
+		int NeighborX = X + OffsetX[i];
+		int NeighborY = Y + OffsetY[i];
+		if(!IsWalkable(NeighborX, NeighborY))
+			continue;
+
+		// Don't cut corners
+		bool Diagonal = i >= 4;
+		if(Diagonal && (!IsWalkable(NeighborX, Y) || !IsWalkable(X, NeighborY)))
+			continue;
+
+		Neighbors[Count].Index = NeighborY * Width + NeighborX;
+		Neighbors[Count].Cost = Diagonal ? (float)M_SQRT2 : 1.0f;
+		Count++;
+	}
+
+	return Count;
+}
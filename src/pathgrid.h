@@ -0,0 +1,63 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <stdint.h>
+
+// Forward Declarations
+class _Map;
+
+// Entry in a search's open list
+struct _PathNode {
+	float F;
+	int Index;
+};
+
+// Tile reachable in one step and the cost to get there
+struct _PathNeighbor {
+	int Index;
+	float Cost;
+};
+
+// Orders an open list as a min-heap on F
+inline bool ComparePathNodes(const _PathNode &Left, const _PathNode &Right) {
+	return Left.F > Right.F;
+}
+
+// Walkable tiles and the steps between them, shared by the path searches
+class _PathGrid {
+
+	public:
+
+		_PathGrid() : Map(nullptr), Width(0), Height(0) { }
+
+		void Init(const _Map *Map, int Width, int Height);
+
+		bool IsWalkable(int X, int Y) const;
+		int GetNeighbors(int Index, _PathNeighbor *Neighbors) const;
+
+		const _Map *GetMap() const { return Map; }
+		int GetWidth() const { return Width; }
+		int GetHeight() const { return Height; }
+
+	private:
+
+		const _Map *Map;
+		int Width, Height;
+};
@@ -0,0 +1,251 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <profiler.h>
+#include <graphics.h>
+#include <assets.h>
+#include <font.h>
+#include <constants.h>
+#include <ui/label.h>
+#include <SDL_timer.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+
+_Profiler Profiler;
+
+// Accumulated timing for one zone in the overlay
+struct _ProfilerStat {
+	const char *Name;
+	int Depth;
+	double Last;
+	double Total;
+	double Max;
+	int Count;
+};
+
+// Initialize
+void _Profiler::Init(int FrameCount) {
+	Frames.Init(FrameCount);
+	Frame.Zones.clear();
+	Frame.Zones.reserve(PROFILER_ZONES);
+	Frame.Counters.clear();
+	MainThread = std::this_thread::get_id();
+	StartTime = SDL_GetPerformanceCounter();
+	Frequency = (double)SDL_GetPerformanceFrequency();
+	Depth = 0;
+	InFrame = false;
+
+	// Create overlay label
+	if(Graphics.IsEnabled())
+		Label = new _Label("profiler", nullptr, _Point(0, 0), _Point(0, 0), LEFT_BASELINE, Assets.GetFont(PROFILER_FONT), COLOR_WHITE, "");
+}
+
+// Shutdown
+void _Profiler::Close() {
+	Frames.Close();
+
+	delete Label;
+	Label = nullptr;
+}
+
+// Finish the previous frame and start a new one
+void _Profiler::BeginFrame() {
+	uint64_t Time = SDL_GetPerformanceCounter();
+
+	if(InFrame) {
+		Frame.End = Time;
+		Frames.PushBack(Frame);
+	}
+
+	Frame.Start = Time;
+	Frame.Zones.clear();
+	Frame.Counters.clear();
+	Depth = 0;
+	InFrame = true;
+}
+
+// Start a zone and return its index in the current frame, ignoring other threads
+int _Profiler::BeginZone(const char *Name) {
+	if(!IsRecording())
+		return -1;
+
+	_ProfilerZone Zone;
+	Zone.Name = Name;
+	Zone.Depth = Depth++;
+	Zone.Start = SDL_GetPerformanceCounter();
+	Zone.End = Zone.Start;
+	Frame.Zones.push_back(Zone);
+
+	return (int)Frame.Zones.size() - 1;
+}
+
+// Close a zone
+void _Profiler::EndZone(int Index) {
+	if(Index < 0 || Index >= (int)Frame.Zones.size())
+		return;
+
+	Frame.Zones[Index].End = SDL_GetPerformanceCounter();
+	Depth--;
+}
+
+// Record a value for the current frame, replacing any earlier value of the same name
+void _Profiler::SetCounter(const char *Name, double Value) {
+	if(!IsRecording())
+		return;
+
+	for(auto &Counter : Frame.Counters) {
+		if(!strcmp(Counter.Name, Name)) {
+			Counter.Value = Value;
+			return;
+		}
+	}
+
+	Frame.Counters.push_back(_ProfilerCounter{ Name, Value });
+}
+
+// Draw last, average and max times of each zone
+void _Profiler::Render() {
+	if(!OverlayEnabled || !Label || Frames.IsEmpty())
+		return;
+
+	_ProfilerScope Zone("Profiler::Render");
+
+	// Gather stats in the order zones appear in the last frame
+	std::vector<_ProfilerStat> Stats;
+	double FrameLast = 0.0, FrameTotal = 0.0, FrameMax = 0.0;
+	for(int i = Frames.Size() - 1; i >= 0; i--) {
+		const _ProfilerFrame &RecordedFrame = Frames.Front(i);
+		bool Last = (i == Frames.Size() - 1);
+
+		double FrameTime = GetMilliseconds(RecordedFrame.End - RecordedFrame.Start);
+		if(Last)
+			FrameLast = FrameTime;
+		FrameTotal += FrameTime;
+		if(FrameTime > FrameMax)
+			FrameMax = FrameTime;
+
+		for(const auto &RecordedZone : RecordedFrame.Zones) {
+			double Time = GetMilliseconds(RecordedZone.End - RecordedZone.Start);
+
+			// Find matching zone
+			_ProfilerStat *Stat = nullptr;
+			for(auto &Existing : Stats) {
+				if(Existing.Name == RecordedZone.Name && Existing.Depth == RecordedZone.Depth) {
+					Stat = &Existing;
+					break;
+				}
+			}
+
+			if(!Stat) {
+				Stats.push_back(_ProfilerStat{ RecordedZone.Name, RecordedZone.Depth, 0.0, 0.0, 0.0, 0 });
+				Stat = &Stats.back();
+			}
+
+			if(Last)
+				Stat->Last += Time;
+			Stat->Total += Time;
+			if(Time > Stat->Max)
+				Stat->Max = Time;
+			Stat->Count++;
+		}
+	}
+
+	// Draw lines
+	float LineHeight = Assets.GetFont(PROFILER_FONT)->GetMaxHeight() + 2;
+	int Y = PROFILER_Y;
+	std::ostringstream Buffer;
+	Buffer << std::fixed << std::setprecision(2);
+	Buffer << "frame  " << FrameLast << "  avg " << FrameTotal / Frames.Size() << "  max " << FrameMax << " ms";
+	Label->SetOffset(_Point(PROFILER_X, Y));
+	Label->SetText(Buffer.str());
+	Label->Render();
+
+	for(const auto &Stat : Stats) {
+		Y += LineHeight;
+		Buffer.str("");
+		Buffer << std::string((Stat.Depth + 1) * 2, ' ') << Stat.Name << "  " << Stat.Last << "  avg " << Stat.Total / Frames.Size() << "  max " << Stat.Max << " ms";
+		Label->SetOffset(_Point(PROFILER_X, Y));
+		Label->SetText(Buffer.str());
+		Label->Render();
+	}
+
+	// Counters from the last frame
+	const _ProfilerFrame &LastFrame = Frames.Front(Frames.Size() - 1);
+	for(const auto &Counter : LastFrame.Counters) {
+		Y += LineHeight;
+		Buffer.str("");
+		Buffer << "  " << Counter.Name << "  " << Counter.Value;
+		Label->SetOffset(_Point(PROFILER_X, Y));
+		Label->SetText(Buffer.str());
+		Label->Render();
+	}
+}
+
+// Write recorded frames as CSV
+bool _Profiler::DumpCSV(const std::string &Path) const {
+	std::ofstream File(Path.c_str(), std::ios::out);
+	if(!File)
+		return false;
+
+	File << "frame,zone,depth,start_ms,duration_ms\n";
+	File << std::fixed << std::setprecision(4);
+	for(int i = 0; i < Frames.Size(); i++) {
+		const _ProfilerFrame &RecordedFrame = Frames.Front(i);
+		File << i << ",frame,-1," << GetMilliseconds(RecordedFrame.Start - StartTime) << "," << GetMilliseconds(RecordedFrame.End - RecordedFrame.Start) << "\n";
+		for(const auto &Zone : RecordedFrame.Zones)
+			File << i << "," << Zone.Name << "," << Zone.Depth << "," << GetMilliseconds(Zone.Start - StartTime) << "," << GetMilliseconds(Zone.End - Zone.Start) << "\n";
+	}
+
+	return true;
+}
+
+// Write recorded frames in the Chrome trace event format
+bool _Profiler::DumpTrace(const std::string &Path) const {
+	std::ofstream File(Path.c_str(), std::ios::out);
+	if(!File)
+		return false;
+
+	File << "{\"traceEvents\":[\n";
+	File << std::fixed << std::setprecision(3);
+	bool First = true;
+	for(int i = 0; i < Frames.Size(); i++) {
+		const _ProfilerFrame &RecordedFrame = Frames.Front(i);
+		if(!First)
+			File << ",\n";
+		First = false;
+
+		File << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << GetMilliseconds(RecordedFrame.Start - StartTime) * 1000.0 << ",\"dur\":" << GetMilliseconds(RecordedFrame.End - RecordedFrame.Start) * 1000.0 << "}";
+		for(const auto &Zone : RecordedFrame.Zones)
+			File << ",\n{\"name\":\"" << Zone.Name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << GetMilliseconds(Zone.Start - StartTime) * 1000.0 << ",\"dur\":" << GetMilliseconds(Zone.End - Zone.Start) * 1000.0 << "}";
+		for(const auto &Counter : RecordedFrame.Counters)
+			File << ",\n{\"name\":\"" << Counter.Name << "\",\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":" << GetMilliseconds(RecordedFrame.Start - StartTime) * 1000.0 << ",\"args\":{\"value\":" << Counter.Value << "}}";
+	}
+	File << "\n]}\n";
+
+	return true;
+}
+
+// Write both export formats with a common path prefix
+void _Profiler::Dump(const std::string &Path) const {
+	if(DumpCSV(Path + ".csv") && DumpTrace(Path + ".json"))
+		std::cout << "Wrote " << Frames.Size() << " profiler frames to " << Path << ".csv/.json" << std::endl;
+	else
+		std::cerr << "Cannot write profiler data to " << Path << std::endl;
+}
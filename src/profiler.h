@@ -0,0 +1,112 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <circular_buffer.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+// Forward Declarations
+class _Label;
+
+// Timed zone inside a frame
+struct _ProfilerZone {
+	const char *Name;
+	int Depth;
+	uint64_t Start;
+	uint64_t End;
+};
+
+// Value sampled once during a frame
+struct _ProfilerCounter {
+	const char *Name;
+	double Value;
+};
+
+// Zones recorded during one frame
+struct _ProfilerFrame {
+	uint64_t Start;
+	uint64_t End;
+	std::vector<_ProfilerZone> Zones;
+	std::vector<_ProfilerCounter> Counters;
+};
+
+// Hierarchical frame profiler
+class _Profiler {
+
+	public:
+
+		_Profiler() : Label(nullptr), Depth(0), InFrame(false), OverlayEnabled(false) { }
+
+		void Init(int FrameCount);
+		void Close();
+
+		// Recording
+		void BeginFrame();
+		int BeginZone(const char *Name);
+		void EndZone(int Index);
+		void SetCounter(const char *Name, double Value);
+
+		// Overlay
+		void ToggleOverlay() { OverlayEnabled = !OverlayEnabled; }
+		bool GetOverlayEnabled() const { return OverlayEnabled; }
+		void Render();
+
+		// Export
+		bool DumpCSV(const std::string &Path) const;
+		bool DumpTrace(const std::string &Path) const;
+		void Dump(const std::string &Path) const;
+
+	private:
+
+		double GetMilliseconds(uint64_t Ticks) const { return Ticks * 1000.0 / Frequency; }
+		bool IsRecording() const { return InFrame && std::this_thread::get_id() == MainThread; }
+
+		// Frames
+		_CircularBuffer<_ProfilerFrame> Frames;
+		_ProfilerFrame Frame;
+
+		// Overlay
+		_Label *Label;
+
+		// State
+		std::thread::id MainThread;
+		uint64_t StartTime;
+		double Frequency;
+		int Depth;
+		bool InFrame;
+		bool OverlayEnabled;
+};
+
+extern _Profiler Profiler;
+
+// Times the enclosing scope
+class _ProfilerScope {
+
+	public:
+
+		_ProfilerScope(const char *Name) { Index = Profiler.BeginZone(Name); }
+		~_ProfilerScope() { Profiler.EndZone(Index); }
+
+	private:
+
+		int Index;
+};
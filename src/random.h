@@ -43,6 +43,8 @@ class _Random {
 
 		// Seeds
 		uint32_t Q[1024];
+		uint32_t Carry;
+		uint32_t Index;
 };
 
 // Constructor
@@ -66,24 +68,26 @@ inline void _Random::SetSeed(uint32_t Seed) {
 		Seed ^= Seed << 5;
 		Q[i] = Seed;
 	}
+
+	Carry = 8471623;
+	Index = 1023;
 }
 
 // Generates a random integer
 inline uint32_t _Random::GenerateRandomInteger() {
-	static uint32_t c = 8471623, i = 1023;
 	uint64_t t, a = 123471786LL;
 	uint32_t x, r = 0xfffffffe;
 
-	i = (i + 1) & 1023;
-	t = a * Q[i] + c;
-	c = t >> 32;
-	x = (uint32_t)(t + c);
-	if(x < c) {
+	Index = (Index + 1) & 1023;
+	t = a * Q[Index] + Carry;
+	Carry = t >> 32;
+	x = (uint32_t)(t + Carry);
+	if(x < Carry) {
 		x++;
-		c++;
+		Carry++;
 	}
 
-	return Q[i] = r - x;
+	return Q[Index] = r - x;
 }
 
 // Generates a random number [0, 1)
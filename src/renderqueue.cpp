@@ -0,0 +1,234 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <renderqueue.h>
+#include <texture.h>
+#include <profiler.h>
+#include <constants.h>
+#include <algorithm>
+
+_RenderQueue RenderQueue;
+
+// Depth state of each pass, in RenderPassType order
+struct _RenderPassState {
+	bool DepthTest;
+	bool DepthMask;
+};
+
+static const _RenderPassState PassStates[RENDERPASS_COUNT] = {
+	{ true,  false },
+	{ true,  true  },
+	{ false, false },
+	{ false, false },
+	{ true,  true  },
+	{ true,  false },
+	{ true,  false },
+	{ true,  false },
+	{ true,  true  },
+	{ false, true  },
+};
+
+// Set the pass and layer for following draws
+void _RenderQueue::SetPass(int Pass, int Layer) {
+	this->Pass = Pass;
+	this->Layer = Layer;
+}
+
+// Queue a range of a baked mesh
+void _RenderQueue::AddMesh(GLuint BufferID, const _Texture *Texture, GLint First, GLsizei Count, bool Cull) {
+	_RenderPacket Packet;
+	Packet.Type = RENDERPACKET_MESH;
+	Packet.TextureID = Texture->GetID();
+	Packet.BufferID = BufferID;
+	Packet.First = First;
+	Packet.Count = Count;
+	Packet.Cull = Cull;
+
+	// Map batches keep their baked order since overlapping pieces depend on it
+	AddPacket(GetKey(Pass, RENDERBLEND_ALPHA, 0, 0, 0), Packet);
+}
+
+// Queue pre-transformed vertices, returning where the caller writes them
+_StreamVertex *_RenderQueue::AddVertices(GLuint TextureID, int Count, int Blend) {
+	_RenderPacket Packet;
+	Packet.Type = RENDERPACKET_STREAM;
+	Packet.TextureID = TextureID;
+	Packet.BufferID = 0;
+	Packet.First = (GLint)Vertices.size();
+	Packet.Count = Count;
+	Packet.Cull = false;
+	AddPacket(GetKey(Pass, Blend, 0, TextureID, VBO_STREAM), Packet);
+
+	Vertices.resize(Vertices.size() + Count);
+	return &Vertices[Packet.First];
+}
+
+// Queue a sprite, ordered by layer and height before texture
+void _RenderQueue::AddSprite(float X, float Y, float Z, const _Texture *Texture, const _Color &Color, float Rotation, float ScaleX, float ScaleY) {
+	_RenderPacket Packet;
+	Packet.Type = RENDERPACKET_SPRITE;
+	Packet.TextureID = Texture->GetID();
+	Packet.BufferID = 0;
+	Packet.First = 0;
+	Packet.Count = 4;
+	Packet.Cull = false;
+	Packet.Texture = Texture;
+	Packet.X = X;
+	Packet.Y = Y;
+	Packet.Z = Z;
+	Packet.Rotation = Rotation;
+	Packet.ScaleX = ScaleX;
+	Packet.ScaleY = ScaleY;
+	Packet.Color = Color;
+	AddPacket(GetKey(Pass, RENDERBLEND_ALPHA, (Layer << 12) | GetDepthBucket(Z), Packet.TextureID, VBO_QUAD), Packet);
+}
+
+// Sort and draw the queued packets, skipping state that's already set
+void _RenderQueue::Execute() {
+	_ProfilerScope Zone("RenderQueue::Execute");
+
+	std::sort(Order.begin(), Order.end());
+	if(!Vertices.empty())
+		Graphics.UploadStream(Vertices);
+
+	// Current state, -1 when unknown
+	int DepthTest = -1;
+	int DepthMask = -1;
+	int Blend = -1;
+	int Layout = -1;
+	GLuint Buffer = 0;
+	GLuint TextureID = 0;
+	int Cull = -1;
+	bool First = true;
+	AvoidedCount = 0;
+	for(const auto &Entry : Order) {
+		const _RenderPacket &Packet = Packets[Entry.second];
+		const _RenderPassState &State = PassStates[Entry.first >> 56];
+		int PacketBlend = (int)((Entry.first >> 48) & 0xFF);
+
+		if(State.DepthTest != DepthTest) {
+			if(State.DepthTest)
+				Graphics.EnableDepthTest();
+			else
+				Graphics.DisableDepthTest();
+			DepthTest = State.DepthTest;
+		}
+
+		if(State.DepthMask != DepthMask) {
+			Graphics.SetDepthMask(State.DepthMask);
+			DepthMask = State.DepthMask;
+		}
+
+		if(PacketBlend != Blend) {
+			switch(PacketBlend) {
+				case RENDERBLEND_PREMULTIPLIED:
+					Graphics.EnablePremultipliedBlending();
+				break;
+				case RENDERBLEND_ALPHA:
+					Graphics.DisableParticleBlending();
+				break;
+				case RENDERBLEND_ADDITIVE:
+					Graphics.EnableParticleBlending();
+				break;
+				case RENDERBLEND_MODULATE:
+					Graphics.EnableModulateBlending();
+				break;
+			}
+			Blend = PacketBlend;
+		}
+		else
+			AvoidedCount++;
+
+		// Switch vertex layout or mesh buffer
+		int PacketLayout = Packet.Type == RENDERPACKET_MESH ? VBO_COUNT : (Packet.Type == RENDERPACKET_STREAM ? VBO_STREAM : VBO_QUAD);
+		if(PacketLayout != Layout || (Packet.Type == RENDERPACKET_MESH && Packet.BufferID != Buffer)) {
+			if(Layout == VBO_COUNT && PacketLayout != VBO_COUNT)
+				Graphics.DisableMeshVBO();
+			else if(Layout != -1 && Layout != VBO_COUNT)
+				Graphics.DisableVBO(Layout);
+
+			if(PacketLayout == VBO_COUNT)
+				Graphics.EnableMeshVBO(Packet.BufferID);
+			else
+				Graphics.EnableVBO(PacketLayout);
+
+			Layout = PacketLayout;
+			Buffer = Packet.BufferID;
+		}
+
+		if((int)Packet.Cull != Cull) {
+			if(Packet.Cull)
+				Graphics.EnableCullFace();
+			else
+				Graphics.DisableCullFace();
+			Cull = Packet.Cull;
+		}
+		else
+			AvoidedCount++;
+
+		// Graphics skips the bind when the texture matches the last one drawn
+		if(First || Packet.TextureID != TextureID)
+			TextureID = Packet.TextureID;
+		else
+			AvoidedCount++;
+		First = false;
+
+		if(Packet.Type == RENDERPACKET_SPRITE)
+			Graphics.DrawTexture(Packet.X, Packet.Y, Packet.Z, Packet.Texture, Packet.Color, Packet.Rotation, Packet.ScaleX, Packet.ScaleY);
+		else
+			Graphics.DrawMesh(Packet.TextureID, Packet.First, Packet.Count, false);
+	}
+
+	// Leave the default world state
+	if(Layout == VBO_COUNT)
+		Graphics.DisableMeshVBO();
+	else if(Layout != -1)
+		Graphics.DisableVBO(Layout);
+	if(Cull == 1)
+		Graphics.DisableCullFace();
+	if(Blend != -1 && Blend != RENDERBLEND_ALPHA)
+		Graphics.DisableParticleBlending();
+	if(DepthTest != -1) {
+		Graphics.EnableDepthTest();
+		Graphics.SetDepthMask(true);
+	}
+
+	Profiler.SetCounter("Render packets", (double)Order.size());
+	Profiler.SetCounter("State changes avoided", AvoidedCount);
+
+	Packets.clear();
+	Order.clear();
+	Vertices.clear();
+}
+
+// Pack pass, blend, depth bucket, texture and vertex buffer from most to least significant
+uint64_t _RenderQueue::GetKey(int Pass, int Blend, int Depth, GLuint TextureID, int Buffer) {
+	return ((uint64_t)Pass << 56) | ((uint64_t)(Blend & 0xFF) << 48) | ((uint64_t)(Depth & 0xFFFF) << 32) | ((uint64_t)(TextureID & 0xFFFF) << 16) | (uint64_t)(Buffer & 0xFFFF);
+}
+
+// Quantize height so lower sprites sort first
+int _RenderQueue::GetDepthBucket(float Z) {
+	float Fraction = (Z - RENDERQUEUE_DEPTHMIN) / (RENDERQUEUE_DEPTHMAX - RENDERQUEUE_DEPTHMIN);
+
+	return std::min(std::max((int)(Fraction * 4095.0f), 0), 4095);
+}
+
+// Store a packet with its sort key
+void _RenderQueue::AddPacket(uint64_t Key, const _RenderPacket &Packet) {
+	Order.push_back(std::make_pair(Key, (uint32_t)Packets.size()));
+	Packets.push_back(Packet);
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <graphics.h>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+// Forward Declarations
+class _Texture;
+
+// Passes of the world, drawn in this order
+enum RenderPassType {
+	RENDERPASS_BASE,
+	RENDERPASS_FLOOR,
+	RENDERPASS_FLOORDECALS,
+	RENDERPASS_OBJECTS,
+	RENDERPASS_WALL,
+	RENDERPASS_FLAT,
+	RENDERPASS_WALLDECALS,
+	RENDERPASS_PARTICLES,
+	RENDERPASS_FORE,
+	RENDERPASS_LIGHTS,
+	RENDERPASS_COUNT
+};
+
+// Blend modes, drawn in this order within a pass
+enum RenderBlendType {
+	RENDERBLEND_PREMULTIPLIED,
+	RENDERBLEND_ALPHA,
+	RENDERBLEND_ADDITIVE,
+	RENDERBLEND_MODULATE,
+};
+
+// Kinds of draw packets
+enum RenderPacketType {
+	RENDERPACKET_MESH,
+	RENDERPACKET_STREAM,
+	RENDERPACKET_SPRITE,
+};
+
+// One queued draw
+struct _RenderPacket {
+	int Type;
+	GLuint TextureID;
+	GLuint BufferID;
+	GLint First;
+	GLsizei Count;
+	bool Cull;
+
+	// Sprites
+	const _Texture *Texture;
+	float X, Y, Z;
+	float Rotation, ScaleX, ScaleY;
+	_Color Color;
+};
+
+// Collects world draws with sort keys and submits them with as few state changes as possible
+class _RenderQueue {
+
+	public:
+
+		_RenderQueue() : Pass(0), Layer(0), AvoidedCount(0) { }
+
+		void SetPass(int Pass, int Layer=0);
+		void AddMesh(GLuint BufferID, const _Texture *Texture, GLint First, GLsizei Count, bool Cull);
+		_StreamVertex *AddVertices(GLuint TextureID, int Count, int Blend=RENDERBLEND_ALPHA);
+		void AddSprite(float X, float Y, float Z, const _Texture *Texture, const _Color &Color, float Rotation, float ScaleX, float ScaleY);
+		void Execute();
+
+		int GetAvoidedCount() const { return AvoidedCount; }
+
+	private:
+
+		static uint64_t GetKey(int Pass, int Blend, int Depth, GLuint TextureID, int Buffer);
+		static int GetDepthBucket(float Z);
+		void AddPacket(uint64_t Key, const _RenderPacket &Packet);
+
+		// Submission state
+		int Pass;
+		int Layer;
+
+		// Packets and their sort keys paired with submission order
+		std::vector<_RenderPacket> Packets;
+		std::vector<std::pair<uint64_t, uint32_t>> Order;
+		std::vector<_StreamVertex> Vertices;
+
+		// Texture, blend and cull changes skipped because the previous packet already set them
+		int AvoidedCount;
+};
+
+extern _RenderQueue RenderQueue;
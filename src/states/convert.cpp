@@ -21,9 +21,13 @@
 
 _ConvertState ConvertState;
 
+// Convert a map between text and binary formats
 void _ConvertState::Init() {
 	_Map *Map = new _Map(Param1);
+	Map->SetBinary(!Map->IsBinary());
 	Map->SaveLevel(Param1);
+	delete Map;
+
 	Framework.SetDone(true);
 }
 
@@ -18,6 +18,7 @@
 #include <states/editor.h>
 #include <framework.h>
 #include <graphics.h>
+#include <renderqueue.h>
 #include <camera.h>
 #include <input.h>
 #include <font.h>
@@ -779,9 +780,12 @@ void _EditorState::Update(double FrameTime) {
 				FinishDrawing = IsDrawing = false;
 			}
 
-			if(IsMoving) {
+			// Rebuild only the chunks under the old and new bounds
+			if(IsMoving && (SelectedBlock->Start != DrawStart || SelectedBlock->End != DrawEnd-1)) {
+				Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 				SelectedBlock->Start = DrawStart;
 				SelectedBlock->End = DrawEnd-1;
+				Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 			}
 		break;
 		case EDITMODE_EVENTS:
@@ -813,6 +817,7 @@ void _EditorState::Render(double BlendFactor) {
 
 	// Draw floors
 	Map->RenderFloors();
+	RenderQueue.Execute();
 
 	// Draw tentative block
 	if(IsDrawing) {
@@ -874,6 +879,7 @@ void _EditorState::Render(double BlendFactor) {
 
 	// Draw the foreground tiles
 	Map->RenderForeground();
+	RenderQueue.Execute();
 
 	// Draw the events
 	Map->RenderEvents(EventTextures);
@@ -1637,6 +1643,7 @@ void _EditorState::ExecuteRotate() {
 		SelectedBlock->Rotation += 90;
 		if(SelectedBlock->Rotation > 359)
 			SelectedBlock->Rotation = 0;
+		Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 	}
 	else {
 		Rotation += 90;
@@ -1647,8 +1654,10 @@ void _EditorState::ExecuteRotate() {
 
 // Executes the mirror texture command
 void _EditorState::ExecuteMirror() {
-	if(BlockSelected())
+	if(BlockSelected()) {
 		SelectedBlock->ScaleX = -SelectedBlock->ScaleX;
+		Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
+	}
 	else
 		ScaleX = -ScaleX;
 }
@@ -1686,14 +1695,18 @@ void _EditorState::ExecuteToggleTile() {
 // Executes the undo command
 void _EditorState::ExecuteChangeZ(float Change, int Type) {
 	if(Type == 0) {
-		if(BlockSelected())
+		if(BlockSelected()) {
 			SelectedBlock->MinZ += Change;
+			Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
+		}
 		else
 			MinZ += Change;
 	}
 	else {
-		if(BlockSelected())
+		if(BlockSelected()) {
 			SelectedBlock->MaxZ += Change;
+			Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
+		}
 		else
 			MaxZ += Change;
 	}
@@ -1953,6 +1966,7 @@ void _EditorState::ExecuteSelectPalette(_Button *Button, int ClickType) {
 				if(BlockSelected()) {
 					SelectedBlock->TextureIdentifier = Button->GetIdentifier();
 					SelectedBlock->Texture = Button->GetStyle()->GetTexture();
+					Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 				}
 			}
 		break;
@@ -2149,8 +2163,10 @@ void _EditorState::ExecuteUpdateBlockLimits(int Direction, bool Expand) {
 			End.Y = Start.Y;
 
 		if(CurrentPalette == EDITMODE_BLOCKS && BlockSelected()) {
+			Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 			SelectedBlock->Start = Map->GetValidCoord(Start);
 			SelectedBlock->End = Map->GetValidCoord(End);
+			Map->InvalidateBlock(CurrentLayer, SelectedBlock->Start, SelectedBlock->End);
 		}
 		else if(CurrentPalette == EDITMODE_EVENTS && EventSelected()) {
 			SelectedEvent->SetStart(Map->GetValidCoord(Start));
@@ -16,7 +16,9 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <states/play.h>
+#include <profiler.h>
 #include <graphics.h>
+#include <renderqueue.h>
 #include <framework.h>
 #include <menu.h>
 #include <camera.h>
@@ -30,10 +32,11 @@
 #include <actions.h>
 #include <utils.h>
 #include <particles.h>
+#include <decals.h>
+#include <lights.h>
 #include <objects/entity.h>
 #include <objects/player.h>
 #include <objects/monster.h>
-#include <objects/particle.h>
 #include <objects/misc.h>
 #include <objects/ammo.h>
 #include <objects/upgrade.h>
@@ -44,6 +47,7 @@
 #include <stdexcept>
 #include <fstream>
 #include <iostream>
+#include <SDL_timer.h>
 
 _PlayState PlayState;
 
@@ -89,6 +93,7 @@ void _PlayState::Init() {
 	Player->SetPosition(Map->GetStartingPositionByCheckpoint(Player->GetCheckpointIndex()));
 	Player->SetTileChanged(true);
 	Map->AddObjectToGrid(Player, GRID_PLAYER);
+	Map->SetFlowFieldTarget(Player->GetPosition());
 
 	// Get monster and item list
 	std::vector<_ObjectSpawn *> Objects = Map->GetObjectsList();
@@ -107,6 +112,21 @@ void _PlayState::Init() {
 
 	Particles = new _Particles();
 	Particles->SetCamera(Camera);
+	Particles->SetBudget(Config.ParticleBudget);
+
+	// Bake long lived decals when render targets are available
+	Decals = nullptr;
+	if(Graphics.HasRenderTargets()) {
+		Decals = new _Decals(Map->GetWidth(), Map->GetHeight());
+		Particles->SetDecals(Decals);
+	}
+
+	// Accumulate lights in a buffer drawn over the world
+	Lights = nullptr;
+	if(Graphics.HasRenderTargets()) {
+		Lights = new _Lights();
+		Particles->SetLights(Lights);
+	}
 
 	Graphics.ChangeViewport(Graphics.GetScreenWidth(), Graphics.GetScreenHeight());
 	Camera->CalculateFrustum(Graphics.GetAspectRatio());
@@ -124,6 +144,8 @@ void _PlayState::Close() {
 	Player->StopAudio();
 
 	delete Particles;
+	delete Decals;
+	delete Lights;
 	delete Camera;
 	delete Map;
 	delete HUD;
@@ -232,6 +254,8 @@ void _PlayState::MouseEvent(const _MouseEvent &MouseEvent) {
 
 // Update
 void _PlayState::Update(double FrameTime) {
+	_ProfilerScope Zone("PlayState::Update");
+
 	if(IsPaused()) {
 		Menu.Update(FrameTime);
 		Graphics.ShowCursor(true);
@@ -292,11 +316,13 @@ void _PlayState::Update(double FrameTime) {
 	}
 
 	// Update the player's states
+	uint64_t Timer = SDL_GetPerformanceCounter();
 	Player->Update(FrameTime);
 
 	// Check for events
 	if(Player->GetTileChanged()) {
 		CheckEvents(Player);
+		Map->SetFlowFieldTarget(Player->GetPosition());
 	}
 	Player->SetTileChanged(false);
 
@@ -306,15 +332,25 @@ void _PlayState::Update(double FrameTime) {
 
 		Player->SetUseRequested(false);
 	}
+	UpdateTimes[UPDATETIME_PLAYER] = GetElapsedTime(Timer);
 
 	// Update objects
 	Map->Update(FrameTime);
+	Map->UpdateFlowField();
+	UpdateTimes[UPDATETIME_MAP] = GetElapsedTime(Timer);
 	UpdateMonsters(FrameTime);
+	UpdateTimes[UPDATETIME_MONSTERS] = GetElapsedTime(Timer);
 	Particles->Update(FrameTime);
+	if(Decals)
+		Decals->Update(FrameTime);
+	if(Lights)
+		Lights->Update(FrameTime);
+	UpdateTimes[UPDATETIME_PARTICLES] = GetElapsedTime(Timer);
 	Map->AddRenderList(Player, 1);
 
 	// Update events
 	UpdateEvents(FrameTime);
+	UpdateTimes[UPDATETIME_EVENTS] = GetElapsedTime(Timer);
 
 	// Apply the damage
 	IsFiring = false;
@@ -367,55 +403,31 @@ void _PlayState::Update(double FrameTime) {
 
 // Render the state
 void _PlayState::Render(double BlendFactor) {
+	_ProfilerScope Zone("PlayState::Render");
+
 	if(IsPaused())
 		BlendFactor = 0;
 
+	// Move settled decals into their chunk textures
+	Particles->BakeDecals();
+
 	// Setup the viewing matrix
 	Graphics.Setup3DViewport();
 	Camera->Set3DProjection(BlendFactor);
 	Graphics.EnableDepthTest();
 
-	// Draw the floor
+	// Queue the world, passes being ordered by the render queue
 	Map->RenderFloors();
-
-	Graphics.SetDepthMask(false);
-
-	// Enable VBOs
-	Graphics.EnableVBO(VBO_QUAD);
-	Graphics.DisableDepthTest();
-
-	// Draw floor decals
 	Particles->Render(_Particles::FLOOR_DECALS);
-
-	// Draw objects
 	Map->RenderObjects(BlendFactor);
-
-	// Disable VBOs
-	Graphics.EnableDepthTest();
-	Graphics.DisableVBO(VBO_QUAD);
-	Graphics.SetDepthMask(true);
-
-	// Draw the walls
 	Map->RenderWalls();
-
-	Graphics.SetDepthMask(false);
-
-	Graphics.EnableVBO(VBO_QUAD);
-
-	// Draw wall decals
 	Particles->Render(_Particles::WALL_DECALS);
-
-	// Draw particles
-	Graphics.EnableParticleBlending();
 	Particles->Render(_Particles::NORMAL);
-	Graphics.DisableParticleBlending();
-	Graphics.DisableVBO(VBO_QUAD);
-
-	Graphics.SetDepthMask(true);
-
-	// Draw the foreground tiles
 	Map->RenderForeground();
-	Map->RenderLights(Player->GetPosition());
+	Map->RenderLights(Player->GetPosition(), Lights);
+
+	// Draw the world with redundant state changes removed
+	RenderQueue.Execute();
 
 	// Draw the crosshair
 	if(!Player->IsDying()) {
@@ -456,7 +468,7 @@ void _PlayState::Render(double BlendFactor) {
 				Camera->ConvertWorldToScreen(Vector2(X-0.5f, Y-0.5f), P);
 				std::ostringstream Buffer;
 				size_t Count = 0;
-				std::list<_Event *> &Events = Map->GetEventList(_Coord(X, Y));
+				_TileEvents Events = Map->GetEventList(_Coord(X, Y));
 				for(auto Event : Events) {
 					if(Event->GetActive())
 						Count++;
@@ -550,9 +562,7 @@ void _PlayState::EntityAttack(_Entity *Attacker, int GridType) {
 
 			float Distance = (HitInformation.Position - Attacker->GetPosition()).Magnitude() - Template->Size[1];
 
-			_Particle *Tracer = new _Particle(_ParticleSpawn(Template, ParticleStart, OBJECT_Z, ShotDirection));
-			Tracer->SetLifetime(Distance * Template->VelocityScale.Y * GAME_FPS);
-			Particles->Add(Tracer);
+			Particles->Create(_ParticleSpawn(Template, ParticleStart, OBJECT_Z, ShotDirection, Distance * Template->VelocityScale.Y * GAME_FPS));
 		}
 
 		// Generate particle effects and reduce health
@@ -639,7 +649,7 @@ void _PlayState::UseObject() {
 		Map->GetAdjacentTile(Player->GetPosition(), Player->GetDirection(), Position);
 
 		// Check for events
-		std::list<_Event *> &Events = Map->GetEventList(Position);
+		_TileEvents Events = Map->GetEventList(Position);
 		for(auto Event : Events) {
 
 			// Check for doors or switches
@@ -697,8 +707,9 @@ void _PlayState::CreateItemDrop(const _Entity *Entity) {
 
 // Updates the monsters
 void _PlayState::UpdateMonsters(double FrameTime) {
+	_ProfilerScope Zone("PlayState::UpdateMonsters");
 
-	// Loop through monsters
+	// Remove dead monsters
 	for(auto MonsterIterator = Monsters.begin(); MonsterIterator != Monsters.end();) {
 		_Monster *Monster = (_Monster *)*MonsterIterator;
 
@@ -707,18 +718,23 @@ void _PlayState::UpdateMonsters(double FrameTime) {
 			delete Monster;
 			MonsterIterator = Monsters.erase(MonsterIterator);
 		}
-		else {
-			Monster->Update(FrameTime, Player);
+		else
+			++MonsterIterator;
+	}
 
-			if(Monster->GetAttackMade()) {
-				EntityAttack(Monster, GRID_PLAYER);
-			}
+	// Run AI
+	AIScheduler.Update(Monsters, Player, Camera, FrameTime);
 
-			if(Camera->IsCircleInView(Monster->GetPosition(), Monster->GetScale())) {
-				Map->AddRenderList(Monster, 2);
-			}
+	// Resolve attacks
+	for(auto Iterator : Monsters) {
+		_Monster *Monster = (_Monster *)Iterator;
 
-			++MonsterIterator;
+		if(Monster->GetAttackMade()) {
+			EntityAttack(Monster, GRID_PLAYER);
+		}
+
+		if(Camera->IsCircleInView(Monster->GetPosition(), Monster->GetScale())) {
+			Map->AddRenderList(Monster, 2);
 		}
 	}
 }
@@ -728,7 +744,7 @@ void _PlayState::CheckEvents(const _Entity *Entity) {
 	_Coord Position = Map->GetValidCoord(Entity->GetPosition());
 
 	// Check for events triggered by walking
-	std::list<_Event *> &Events = Map->GetEventList(Position);
+	_TileEvents Events = Map->GetEventList(Position);
 	for(auto Event : Events) {
 
 		// Perform action
@@ -842,6 +858,7 @@ void _PlayState::CheckEvents(const _Entity *Entity) {
 
 // Update the active events
 void _PlayState::UpdateEvents(double FrameTime) {
+	_ProfilerScope Zone("PlayState::UpdateEvents");
 
 	// Activate events
 	for(auto ActiveEventIterator = ActiveEvents.begin(); ActiveEventIterator != ActiveEvents.end(); ++ActiveEventIterator) {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <state.h>
+#include <aischeduler.h>
 #include <vector2.h>
 #include <color.h>
 #include <list>
@@ -32,6 +33,8 @@ class _Monster;
 class _Player;
 class _Item;
 class _Particles;
+class _Decals;
+class _Lights;
 class _Camera;
 struct _ObjectSpawn;
 struct _ParticleTemplate;
@@ -44,6 +47,16 @@ enum CollisionType {
 	HIT_OBJECT
 };
 
+// Subsystems timed during an update
+enum UpdateTimeType {
+	UPDATETIME_PLAYER,
+	UPDATETIME_MONSTERS,
+	UPDATETIME_PARTICLES,
+	UPDATETIME_EVENTS,
+	UPDATETIME_MAP,
+	UPDATETIME_COUNT
+};
+
 // Holds information about a hit entity
 struct HitStruct {
 	HitStruct() { }
@@ -87,6 +100,10 @@ class _PlayState : public _State {
 		void SetPlayer(_Player *Player) { this->Player = Player; }
 		_Player *GetPlayer() { return Player; }
 
+		const double *GetUpdateTimes() const { return UpdateTimes; }
+		_AIScheduler &GetAIScheduler() { return AIScheduler; }
+		const _Particles *GetParticles() const { return Particles; }
+
 	protected:
 
 		bool IsPaused();
@@ -114,6 +131,7 @@ class _PlayState : public _State {
 
 		// Game
 		double CursorItemTimer, SaveGameTimer;
+		double UpdateTimes[UPDATETIME_COUNT];
 
 		// Map
 		_Map *Map;
@@ -122,6 +140,7 @@ class _PlayState : public _State {
 		// Entities
 		_Player *Player;
 		std::list<_Entity *> Monsters;
+		_AIScheduler AIScheduler;
 		std::list<_Event *> ActiveEvents;
 
 		// HUD
@@ -130,6 +149,8 @@ class _PlayState : public _State {
 
 		// Particles
 		_Particles *Particles;
+		_Decals *Decals;
+		_Lights *Lights;
 		bool IsFiring;
 
 		// Camera
@@ -0,0 +1,119 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <textcache.h>
+#include <profiler.h>
+#include <constants.h>
+#include <functional>
+#include <iterator>
+#include <cstring>
+
+_TextCache TextCache;
+
+// Get a cached layout and mark it as recently used
+const _TextLayout *_TextCache::Find(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth) {
+	auto Iterator = Index.find(GetHash(Font, Text, Alignment, WrapWidth));
+	if(Iterator == Index.end()) {
+		Misses++;
+		return nullptr;
+	}
+
+	// Different text with the same hash
+	const _TextLayout &Layout = *Iterator->second;
+	if(Layout.Font != Font || Layout.Alignment != Alignment || Layout.WrapWidth != WrapWidth || Layout.Text != Text) {
+		Misses++;
+		return nullptr;
+	}
+
+	Layouts.splice(Layouts.begin(), Layouts, Iterator->second);
+	Hits++;
+
+	return &Layouts.front();
+}
+
+// Add an empty layout for the caller to fill, evicting the least recently used when full
+_TextLayout &_TextCache::Insert(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth) {
+	uint64_t Hash = GetHash(Font, Text, Alignment, WrapWidth);
+
+	// Reuse the entry of a colliding hash or the oldest entry
+	std::list<_TextLayout>::iterator Iterator;
+	auto IndexIterator = Index.find(Hash);
+	if(IndexIterator != Index.end()) {
+		Iterator = IndexIterator->second;
+	}
+	else if((int)Layouts.size() >= TEXTCACHE_SIZE) {
+		Iterator = std::prev(Layouts.end());
+		Index.erase(Iterator->Hash);
+	}
+	else {
+		Layouts.emplace_front();
+		Iterator = Layouts.begin();
+	}
+	Layouts.splice(Layouts.begin(), Layouts, Iterator);
+	Index[Hash] = Iterator;
+
+	_TextLayout &Layout = *Iterator;
+	Layout.Font = Font;
+	Layout.Text = Text;
+	Layout.Alignment = Alignment;
+	Layout.WrapWidth = WrapWidth;
+	Layout.Hash = Hash;
+	Layout.Vertices.clear();
+	Layout.Lines.clear();
+
+	return Layout;
+}
+
+// Drop the layouts of a font
+void _TextCache::Remove(const _Font *Font) {
+	for(auto Iterator = Layouts.begin(); Iterator != Layouts.end(); ) {
+		if(Iterator->Font == Font) {
+			Index.erase(Iterator->Hash);
+			Iterator = Layouts.erase(Iterator);
+		}
+		else
+			++Iterator;
+	}
+}
+
+// Drop all layouts
+void _TextCache::Clear() {
+	Layouts.clear();
+	Index.clear();
+}
+
+// Report the hit rate since the last update
+void _TextCache::UpdateStats() {
+	int Lookups = Hits + Misses;
+	Profiler.SetCounter("Text layouts", (double)Layouts.size());
+	Profiler.SetCounter("Text cache hit rate", Lookups ? Hits * 100.0 / Lookups : 0.0);
+	Hits = 0;
+	Misses = 0;
+}
+
+// Combine the key fields into one hash
+uint64_t _TextCache::GetHash(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth) {
+	uint32_t WrapBits;
+	std::memcpy(&WrapBits, &WrapWidth, sizeof(WrapBits));
+
+	uint64_t Hash = std::hash<std::string>()(Text);
+	const uint64_t Fields[3] = { (uint64_t)(uintptr_t)Font, (uint64_t)(uint32_t)Alignment, WrapBits };
+	for(uint64_t Field : Fields)
+		Hash ^= Field + 0x9E3779B97F4A7C15ULL + (Hash << 6) + (Hash >> 2);
+
+	return Hash;
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+* Empty Clip
+* Copyright (C) 2015  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <graphics.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <stdint.h>
+
+// Forward Declarations
+class _Font;
+
+// Alignment key for layouts broken into lines instead of drawn
+const int TEXTLAYOUT_WRAPPED = -1;
+
+// Laid out text, positioned relative to the draw point
+struct _TextLayout {
+	const _Font *Font;
+	std::string Text;
+	int Alignment;
+	float WrapWidth;
+	uint64_t Hash;
+
+	// Glyph quads in white for drawing, or lines for wrapping
+	std::vector<_StreamVertex> Vertices;
+	std::vector<std::string> Lines;
+};
+
+// Least recently used cache of text layouts shared by all fonts
+class _TextCache {
+
+	public:
+
+		_TextCache() : Hits(0), Misses(0) { }
+
+		const _TextLayout *Find(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth);
+		_TextLayout &Insert(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth);
+		void Remove(const _Font *Font);
+		void Clear();
+		void UpdateStats();
+
+		int GetCount() const { return (int)Layouts.size(); }
+
+	private:
+
+		static uint64_t GetHash(const _Font *Font, const std::string &Text, int Alignment, float WrapWidth);
+
+		// Layouts with the most recently used first, indexed by hash
+		std::list<_TextLayout> Layouts;
+		std::unordered_map<uint64_t, std::list<_TextLayout>::iterator> Index;
+
+		// Stats since the last update
+		int Hits;
+		int Misses;
+};
+
+extern _TextCache TextCache;
@@ -16,6 +16,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <texture.h>
+#include <graphics.h>
 #include <SDL_image.h>
 #include <stdexcept>
 
@@ -25,7 +26,12 @@ _Texture::_Texture()
 	Group(0),
 	ID(0),
 	Width(0),
-	Height(0) {
+	Height(0),
+	Page(nullptr),
+	Left(0.0f),
+	Top(0.0f),
+	Right(1.0f),
+	Bottom(1.0f) {
 
 }
 
@@ -40,8 +46,18 @@ _Texture::_Texture(const std::string &FilePath, int Group, bool Repeat, bool Mip
 
 	this->Name = FilePath;
 	this->Group = Group;
+	this->ID = 0;
 	this->Width = Image->w;
 	this->Height = Image->h;
+	this->Page = nullptr;
+	this->Left = this->Top = 0.0f;
+	this->Right = this->Bottom = 1.0f;
+
+	// Keep metadata only when running headless
+	if(!Graphics.IsEnabled()) {
+		SDL_FreeSurface(Image);
+		return;
+	}
 
 	// Determine OpenGL format
 	GLint ColorFormat = GL_RGB;
@@ -56,13 +72,18 @@ _Texture::_Texture(const std::string &FilePath, int Group, bool Repeat, bool Mip
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	}
 	else {
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, Graphics.GetClampMode());
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, Graphics.GetClampMode());
 	}
 
 	if(Mipmaps) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		gluBuild2DMipmaps(GL_TEXTURE_2D, ColorFormat, Width, Height, ColorFormat, GL_UNSIGNED_BYTE, Image->pixels);
+		if(Graphics.IsCore()) {
+			glTexImage2D(GL_TEXTURE_2D, 0, ColorFormat, Width, Height, 0, ColorFormat, GL_UNSIGNED_BYTE, Image->pixels);
+			Graphics.GenerateMipmap();
+		}
+		else
+			gluBuild2DMipmaps(GL_TEXTURE_2D, ColorFormat, Width, Height, ColorFormat, GL_UNSIGNED_BYTE, Image->pixels);
 	}
 	else {
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -74,19 +95,55 @@ _Texture::_Texture(const std::string &FilePath, int Group, bool Repeat, bool Mip
 }
 
 // Initialize from buffer
-_Texture::_Texture(unsigned char *Data, int Width, int Height, GLint InternalFormat, int Format) {
+_Texture::_Texture(unsigned char *Data, int Width, int Height, GLint InternalFormat, int Format)
+:	Name(""),
+	Group(0),
+	ID(0),
+	Width(Width),
+	Height(Height),
+	Page(nullptr),
+	Left(0.0f),
+	Top(0.0f),
+	Right(1.0f),
+	Bottom(1.0f) {
+
+	// Keep metadata only when running headless
+	if(!Graphics.IsEnabled())
+		return;
 
 	// Create texture
 	glGenTextures(1, &ID);
 	glBindTexture(GL_TEXTURE_2D, ID);
 	glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Data);
+}
+
+// Atlas region, placed when the atlas is built
+_Texture::_Texture(const std::string &Name, int Group, int Width, int Height)
+:	Name(Name),
+	Group(Group),
+	ID(0),
+	Width(Width),
+	Height(Height),
+	Page(nullptr),
+	Left(0.0f),
+	Top(0.0f),
+	Right(1.0f),
+	Bottom(1.0f) {
 
-	this->Width = Width;
-	this->Height = Height;
 }
 
-// Constructor
+// Destructor
 _Texture::~_Texture() {
-	if(ID)
+	if(ID && !Page)
 		glDeleteTextures(1, &ID);
 }
+
+// Share an atlas page's texture and point at a region of it
+void _Texture::SetRegion(const _Texture *Page, int X, int Y) {
+	this->Page = Page;
+	ID = Page->GetID();
+	Left = X / (float)Page->GetWidth();
+	Top = Y / (float)Page->GetHeight();
+	Right = (X + Width) / (float)Page->GetWidth();
+	Bottom = (Y + Height) / (float)Page->GetHeight();
+}
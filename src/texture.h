@@ -34,14 +34,26 @@ class _Texture {
 		_Texture();
 		_Texture(const std::string &FilePath, int Group, bool Repeat, bool Mipmaps);
 		_Texture(unsigned char *Data, int Width, int Height, int InternalFormat, int Format);
+		_Texture(const std::string &Name, int Group, int Width, int Height);
 		~_Texture();
 
+		void SetRegion(const _Texture *Page, int X, int Y);
+
 		const std::string &GetName() const { return Name; }
 		int GetGroup() const { return Group; }
 		GLuint GetID() const { return ID; }
 		int GetWidth() const { return Width; }
 		int GetHeight() const { return Height; }
 
+		// Map texture coordinates into the atlas region
+		bool IsAtlased() const { return Page != nullptr; }
+		float GetU(float U) const { return Left + U * (Right - Left); }
+		float GetV(float V) const { return Top + V * (Bottom - Top); }
+		float GetLeft() const { return Left; }
+		float GetTop() const { return Top; }
+		float GetRight() const { return Right; }
+		float GetBottom() const { return Bottom; }
+
 	private:
 
 		// Info
@@ -52,4 +64,8 @@ class _Texture {
 		// Dimensions
 		int Width;
 		int Height;
+
+		// Atlas page and texture coordinates of the region
+		const _Texture *Page;
+		float Left, Top, Right, Bottom;
 };
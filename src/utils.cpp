@@ -17,6 +17,7 @@
 *******************************************************************************/
 #include <utils.h>
 #include <random.h>
+#include <SDL_timer.h>
 
 // Reads in a string that is CSV formatted
 std::string GetCSVText(std::ifstream &Stream) {
@@ -77,3 +78,12 @@ Vector2 GenerateRandomPointInCircle(float Radius) {
 
 	return Vector2(Random.Generate() * 360.0) * Radius * sqrt(Random.Generate());
 }
+
+// Returns the seconds elapsed since Timer and restarts it
+double GetElapsedTime(uint64_t &Timer) {
+	uint64_t Time = SDL_GetPerformanceCounter();
+	double Elapsed = (Time - Timer) / (double)SDL_GetPerformanceFrequency();
+	Timer = Time;
+
+	return Elapsed;
+}
@@ -21,9 +21,11 @@
 #include <vector2.h>
 #include <fstream>
 #include <string>
+#include <stdint.h>
 
 std::string GetCSVText(std::ifstream &Stream);
 std::string GetTSVText(std::ifstream &Stream, bool *EndOfLine=0);
 Vector2 GenerateRandomPointInCircle(float Radius);
+double GetElapsedTime(uint64_t &Timer);
 
 void WriteChunk(std::ofstream &File, int Type, const char *Data, size_t Size);